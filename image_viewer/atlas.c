@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pspiofilemgr.h>
+
+#include "atlas.h"
+#include "profile.h"
+
+static AtlasStats stats;
+static const Atlas* lastAtlas;  // atlas and sprite of the last draw
+static const AtlasEntry* lastEntry;
+
+/* Page files are named relative to the index, which may sit in any directory. */
+static Image* loadPage(const char* indexName, const char* pageName)
+{
+	char path[256];
+	const char* slash = strrchr(indexName, '/');
+	int directory = slash ? slash - indexName + 1 : 0;
+	if (directory + strlen(pageName) >= sizeof(path)) return NULL;
+	memcpy(path, indexName, directory);
+	strcpy(path + directory, pageName);
+	return loadTextureFile(path);
+}
+
+static int validEntry(const Atlas* atlas, const AtlasEntry* entry)
+{
+	const Image* page;
+	if (entry->page >= atlas->pageCount || entry->width == 0 || entry->height == 0) return 0;
+	page = atlas->pages[entry->page];
+	return entry->x + entry->width <= page->imageWidth && entry->y + entry->height <= page->imageHeight &&
+		memchr(entry->name, 0, ATLAS_NAME_SIZE) != NULL;
+}
+
+Atlas* loadAtlas(const char* filename)
+{
+	AtlasHeader header;
+	Atlas* atlas;
+	SceUID fd;
+	int i, size;
+
+	fd = sceIoOpen(filename, PSP_O_RDONLY, 0);
+	if (fd < 0) return NULL;
+	if (sceIoRead(fd, &header, sizeof(header)) != sizeof(header) ||
+		header.magic != ATLAS_MAGIC || header.version != ATLAS_VERSION ||
+		header.pageCount == 0 || header.pageCount > ATLAS_MAX_PAGES || header.entryCount == 0) {
+		sceIoClose(fd);
+		return NULL;
+	}
+	atlas = (Atlas*) calloc(1, sizeof(Atlas));
+	if (!atlas) {
+		sceIoClose(fd);
+		return NULL;
+	}
+	size = header.entryCount * sizeof(AtlasEntry);
+	atlas->entries = (AtlasEntry*) malloc(size);
+	atlas->entryCount = header.entryCount;
+	if (!atlas->entries || sceIoRead(fd, atlas->entries, size) != size) {
+		sceIoClose(fd);
+		freeAtlas(atlas);
+		return NULL;
+	}
+	sceIoClose(fd);
+	for (i = 0; i < (int) header.pageCount; i++) {
+		header.pages[i][ATLAS_NAME_SIZE - 1] = 0;
+		atlas->pages[i] = loadPage(filename, header.pages[i]);
+		if (!atlas->pages[i]) {
+			freeAtlas(atlas);
+			return NULL;
+		}
+		atlas->pageCount++;
+	}
+	// findAtlasEntry() binary searches, entries out of order would just not be found
+	for (i = 0; i < atlas->entryCount; i++) {
+		if (!validEntry(atlas, &atlas->entries[i]) ||
+			(i > 0 && strcmp(atlas->entries[i - 1].name, atlas->entries[i].name) >= 0)) {
+			freeAtlas(atlas);
+			return NULL;
+		}
+	}
+	return atlas;
+}
+
+void freeAtlas(Atlas* atlas)
+{
+	int i;
+	if (lastAtlas == atlas) lastAtlas = NULL;
+	for (i = 0; i < atlas->pageCount; i++) freeImage(atlas->pages[i]);
+	free(atlas->entries);
+	free(atlas);
+}
+
+const AtlasEntry* findAtlasEntry(const Atlas* atlas, const char* name)
+{
+	int low = 0;
+	int high = atlas->entryCount - 1;
+	while (low <= high) {
+		int middle = (low + high) / 2;
+		int order = strcmp(name, atlas->entries[middle].name);
+		if (order == 0) return &atlas->entries[middle];
+		if (order < 0) high = middle - 1;
+		else low = middle + 1;
+	}
+	return NULL;
+}
+
+void drawAtlasEntry(const Atlas* atlas, const AtlasEntry* entry, int dx, int dy)
+{
+	stats.draws++;
+	if (lastAtlas == atlas && lastEntry != entry && lastEntry->page == entry->page) {
+		stats.bindsSaved++;
+		profileCount(PROFILE_BINDS_SAVED, 1);
+	}
+	lastAtlas = atlas;
+	lastEntry = entry;
+	blitAlphaImageToScreen(entry->x, entry->y, entry->width, entry->height, atlas->pages[entry->page], dx, dy);
+}
+
+int drawAtlasSprite(const Atlas* atlas, const char* name, int dx, int dy)
+{
+	const AtlasEntry* entry = findAtlasEntry(atlas, name);
+	if (!entry) return 0;
+	drawAtlasEntry(atlas, entry, dx, dy);
+	return 1;
+}
+
+const AtlasStats* getAtlasStats()
+{
+	return &stats;
+}
+
+void resetAtlasStats()
+{
+	memset(&stats, 0, sizeof(stats));
+}
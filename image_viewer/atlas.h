@@ -0,0 +1,117 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "graphics.h"
+
+#define ATLAS_MAGIC 0x534c5441  // "ATLS"
+#define ATLAS_VERSION 1
+#define ATLAS_NAME_SIZE 32  // sprite and page file names, including the terminating 0
+#define ATLAS_MAX_PAGES 8
+
+/**
+ * Header of an atlas index, written by the atlaspack host tool. It is followed by
+ * entryCount AtlasEntry records sorted by name. The pages are cooked textures (texfile.h)
+ * named relative to the directory of the index. All fields are little endian.
+ */
+typedef struct
+{
+	u32 magic;  // ATLAS_MAGIC
+	u32 version;  // ATLAS_VERSION
+	u32 pageCount;
+	u32 entryCount;
+	char pages[ATLAS_MAX_PAGES][ATLAS_NAME_SIZE];  // file names of the pages
+} AtlasHeader;
+
+/** Where a sprite lies in the atlas, in pixels of its page. */
+typedef struct
+{
+	char name[ATLAS_NAME_SIZE];  // PNG file name without the .png extension
+	u16 page;
+	u16 x, y;
+	u16 width, height;
+	u16 reserved;
+} AtlasEntry;
+
+/**
+ * Sprites packed into a few textures, so drawing different sprites does not change
+ * the texture between them.
+ */
+typedef struct
+{
+	int pageCount;
+	Image* pages[ATLAS_MAX_PAGES];
+	int entryCount;
+	AtlasEntry* entries;  // sorted by name
+} Atlas;
+
+typedef struct
+{
+	int draws;  // sprites drawn from atlases
+	int bindsSaved;  // draws that followed a different sprite of the same page, a texture change with separate images
+} AtlasStats;
+
+/**
+ * Load an atlas index and its pages.
+ *
+ * @pre filename != NULL
+ * @param filename - filename of the index written by atlaspack
+ * @return pointer to a new allocated Atlas struct, or NULL on failure, also if a sprite lies
+ *         outside its page or the entries are not sorted by name without duplicates
+ */
+extern Atlas* loadAtlas(const char* filename);
+
+/**
+ * Free an atlas and its pages.
+ *
+ * @pre atlas != NULL
+ * @param atlas - the atlas
+ */
+extern void freeAtlas(Atlas* atlas);
+
+/**
+ * Look up a sprite by name, by binary search of the sorted entries.
+ *
+ * @pre atlas != NULL && name != NULL
+ * @param atlas - the atlas
+ * @param name - name of the sprite, its PNG file name without extension
+ * @return the entry, NULL if the atlas has no such sprite
+ */
+extern const AtlasEntry* findAtlasEntry(const Atlas* atlas, const char* name);
+
+/**
+ * Blit a sprite of an atlas to the screen with alpha, see blitAlphaImageToScreen().
+ *
+ * @pre atlas != NULL && entry != NULL
+ * @param atlas - the atlas
+ * @param entry - sprite of the atlas, from findAtlasEntry()
+ * @param dx - left target position on the screen
+ * @param dy - top target position on the screen
+ */
+extern void drawAtlasEntry(const Atlas* atlas, const AtlasEntry* entry, int dx, int dy);
+
+/**
+ * Look up a sprite by name and blit it to the screen with alpha.
+ *
+ * @pre atlas != NULL && name != NULL
+ * @param atlas - the atlas
+ * @param name - name of the sprite
+ * @param dx - left target position on the screen
+ * @param dy - top target position on the screen
+ * @return 1 if the sprite was drawn, 0 if the atlas has no such sprite
+ */
+extern int drawAtlasSprite(const Atlas* atlas, const char* name, int dx, int dy);
+
+/**
+ * Get the atlas statistics accumulated since the last reset. The binds saved are also
+ * counted per frame by the profiler, as PROFILE_BINDS_SAVED.
+ *
+ * @return pointer to the live statistics
+ */
+extern const AtlasStats* getAtlasStats();
+
+/**
+ * Reset the atlas statistics to zero.
+ */
+extern void resetAtlasStats();
+
+#endif
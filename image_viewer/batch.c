@@ -0,0 +1,245 @@
+#include <string.h>
+#include <stdint.h>
+#include <pspgu.h>
+
+#include "graphics.h"
+#include "batch.h"
+#include "profile.h"
+
+typedef struct
+{
+	BatchState state;
+	int mergeable;  // list primitives can share a draw call, strips can not
+	int vertexCount;
+	int x0, y0, x1, y1;  // union of the screen bounds of all primitives in the group
+	u8* vertices;  // destination in the display list while flushing
+} BatchGroup;
+
+typedef struct
+{
+	int group;
+	int offset;  // byte offset into the vertex pool
+	int count;
+} BatchPrimitive;
+
+static BatchGroup groups[BATCH_MAX_GROUPS];
+static BatchPrimitive primitives[BATCH_MAX_PRIMITIVES];
+static u8 __attribute__((aligned(16))) vertexPool[BATCH_VERTEX_POOL_SIZE];
+static int groupCount;
+static int primitiveCount;
+static int vertexPoolUsed;
+
+static BatchState bound;  // texture state last sent to the GE
+static const void* boundClut;  // palette last loaded by the GE
+static int textureEnabled;
+static int blendEnabled;
+static int textureFunction;
+static BatchStats stats;
+static const DamageSet* clipSet;
+
+static int sameTexture(const BatchState* a, const BatchState* b)
+{
+	return a->texture == b->texture &&
+		a->textureWidth == b->textureWidth &&
+		a->textureHeight == b->textureHeight &&
+		a->textureStride == b->textureStride &&
+		a->format == b->format &&
+		a->swizzle == b->swizzle;
+}
+
+static int sameState(const BatchState* a, const BatchState* b)
+{
+	return a->prim == b->prim &&
+		a->vertexType == b->vertexType &&
+		a->opaque == b->opaque &&
+		a->modulate == b->modulate &&
+		a->clut == b->clut &&
+		sameTexture(a, b);
+}
+
+static int overlaps(const BatchGroup* group, int x0, int y0, int x1, int y1)
+{
+	return group->x0 < x1 && x0 < group->x1 && group->y0 < y1 && y0 < group->y1;
+}
+
+static int isMergeable(int prim)
+{
+	return prim != GU_LINE_STRIP && prim != GU_TRIANGLE_STRIP && prim != GU_TRIANGLE_FAN;
+}
+
+static int groupSize(const BatchGroup* group)
+{
+	return (group->vertexCount * group->state.vertexSize + 15) & ~15;
+}
+
+static int findGroup(const BatchState* state, int x0, int y0, int x1, int y1)
+{
+	int g;
+	int last = groupCount - BATCH_LOOKBACK;
+	if (!isMergeable(state->prim)) return -1;
+	for (g = groupCount - 1; g >= 0 && g >= last; g--) {
+		if (groups[g].mergeable && sameState(&groups[g].state, state)) return g;
+		if (overlaps(&groups[g], x0, y0, x1, y1)) break;
+	}
+	return -1;
+}
+
+void batchBeginList()
+{
+	bound.texture = NULL;
+	boundClut = NULL;
+	textureEnabled = -1;
+	blendEnabled = -1;
+	textureFunction = -1;
+}
+
+void* batchVertices(const BatchState* state, int count, int x0, int y0, int x1, int y1)
+{
+	int g;
+	int size = count * state->vertexSize;
+	BatchPrimitive* primitive;
+	BatchGroup* group;
+
+	if (primitiveCount == BATCH_MAX_PRIMITIVES || vertexPoolUsed + size > BATCH_VERTEX_POOL_SIZE) batchFlush();
+
+	g = findGroup(state, x0, y0, x1, y1);
+	if (g < 0) {
+		if (groupCount == BATCH_MAX_GROUPS) batchFlush();
+		g = groupCount++;
+		group = &groups[g];
+		group->state = *state;
+		group->mergeable = isMergeable(state->prim);
+		group->vertexCount = 0;
+		group->x0 = x0;
+		group->y0 = y0;
+		group->x1 = x1;
+		group->y1 = y1;
+	} else {
+		group = &groups[g];
+		if (x0 < group->x0) group->x0 = x0;
+		if (y0 < group->y0) group->y0 = y0;
+		if (x1 > group->x1) group->x1 = x1;
+		if (y1 > group->y1) group->y1 = y1;
+	}
+	group->vertexCount += count;
+
+	primitive = &primitives[primitiveCount++];
+	primitive->group = g;
+	primitive->offset = vertexPoolUsed;
+	primitive->count = count;
+	vertexPoolUsed += (size + 15) & ~15;
+	stats.primitives++;
+	return &vertexPool[primitive->offset];
+}
+
+static void bindState(const BatchState* state)
+{
+	if (blendEnabled != !state->opaque) {
+		if (state->opaque) {
+			sceGuDisable(GU_BLEND);
+			sceGuDisable(GU_ALPHA_TEST);
+		} else {
+			sceGuEnable(GU_BLEND);
+			sceGuEnable(GU_ALPHA_TEST);
+		}
+		blendEnabled = !state->opaque;
+	}
+	if (state->texture) {
+		if (textureEnabled != 1) {
+			sceGuEnable(GU_TEXTURE_2D);
+			textureEnabled = 1;
+		}
+		if (textureFunction != state->modulate) {
+			sceGuTexFunc(state->modulate ? GU_TFX_MODULATE : GU_TFX_REPLACE, GU_TCC_RGBA);
+			textureFunction = state->modulate;
+		}
+		if (!sameTexture(state, &bound)) {
+			if (!bound.texture || state->format != bound.format || state->swizzle != bound.swizzle) {
+				sceGuTexMode(state->format, 0, 0, state->swizzle);
+			}
+			sceGuTexImage(0, state->textureWidth, state->textureHeight, state->textureStride, state->texture);
+			sceGuTexScale(1.0f / ((float) state->textureWidth), 1.0f / ((float) state->textureHeight));
+			bound = *state;
+			stats.textureBinds++;
+			profileCount(PROFILE_TEXTURE_BINDS, 1);
+		}
+		if (state->clut && state->clut != boundClut) {
+			// a palette swap only reloads the CLUT, the texture stays bound
+			sceGuClutMode(GU_PSM_8888, 0, 0xff, 0);
+			sceGuClutLoad(state->clutEntries / 8, state->clut);
+			boundClut = state->clut;
+			stats.clutLoads++;
+		}
+	} else if (textureEnabled != 0) {
+		sceGuDisable(GU_TEXTURE_2D);
+		textureEnabled = 0;
+	}
+}
+
+void batchSetClip(const DamageSet* clip)
+{
+	clipSet = clip;
+}
+
+static void drawGroup(BatchGroup* group)
+{
+	bindState(&group->state);
+	sceGuDrawArray(group->state.prim, group->state.vertexType, group->vertexCount, 0,
+		group->vertices - group->vertexCount * group->state.vertexSize);
+	stats.drawCalls++;
+	profileCount(PROFILE_DRAW_CALLS, 1);
+	profileCount(PROFILE_VERTICES, group->vertexCount);
+}
+
+void batchFlush()
+{
+	int i, g;
+	int total = 0;
+	u8* memory;
+
+	if (primitiveCount == 0) return;
+
+	for (g = 0; g < groupCount; g++) total += groupSize(&groups[g]);
+	memory = (u8*) sceGuGetMemory(total + 12);
+	memory = (u8*) (((uintptr_t) memory + 15) & ~15);
+	for (g = 0; g < groupCount; g++) {
+		groups[g].vertices = memory;
+		memory += groupSize(&groups[g]);
+	}
+	for (i = 0; i < primitiveCount; i++) {
+		BatchPrimitive* primitive = &primitives[i];
+		BatchGroup* group = &groups[primitive->group];
+		int size = primitive->count * group->state.vertexSize;
+		memcpy(group->vertices, &vertexPool[primitive->offset], size);
+		group->vertices += size;
+	}
+	if (clipSet) {
+		// the vertices stay in the list once, each rectangle draws the groups it overlaps
+		for (i = 0; i < clipSet->count; i++) {
+			const DamageRect* rect = &clipSet->rects[i];
+			sceGuScissor(rect->x0, rect->y0, rect->x1, rect->y1);
+			for (g = 0; g < groupCount; g++) {
+				if (overlaps(&groups[g], rect->x0, rect->y0, rect->x1, rect->y1)) drawGroup(&groups[g]);
+			}
+		}
+		sceGuScissor(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+	} else {
+		for (g = 0; g < groupCount; g++) drawGroup(&groups[g]);
+	}
+
+	stats.groups += groupCount;
+	stats.flushes++;
+	groupCount = 0;
+	primitiveCount = 0;
+	vertexPoolUsed = 0;
+}
+
+const BatchStats* batchGetStats()
+{
+	return &stats;
+}
+
+void batchResetStats()
+{
+	memset(&stats, 0, sizeof(stats));
+}
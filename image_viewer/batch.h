@@ -0,0 +1,93 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <psptypes.h>
+#include "damage.h"
+
+#define BATCH_MAX_PRIMITIVES 4096
+#define BATCH_MAX_GROUPS 512
+#define BATCH_VERTEX_POOL_SIZE (128 * 1024)
+#define BATCH_LOOKBACK 8  // how many earlier groups a primitive may be merged into
+
+/**
+ * Everything the GE needs to know to draw a group of primitives with one sceGuDrawArray.
+ */
+typedef struct
+{
+	int prim;  // GU_SPRITES, GU_LINES, ...
+	int vertexType;  // vertex declaration passed to sceGuDrawArray
+	int vertexSize;  // size of one vertex in bytes
+	const void* texture;  // texture data, NULL for untextured primitives
+	int textureWidth;  // 2^n texture width handed to the GE
+	int textureHeight;  // 2^n texture height handed to the GE
+	int textureStride;  // buffer width of the texture data in pixels
+	int format;  // GU_PSM_* pixel format of the texture
+	int swizzle;  // 1 if the texture is stored swizzled
+	const void* clut;  // 8888 palette of GU_PSM_T4 and GU_PSM_T8 textures, 16 byte aligned
+	int clutEntries;  // number of palette entries, a multiple of 8
+	int opaque;  // 1 to draw without blending and alpha test
+	int modulate;  // 1 to multiply the texture by the vertex color, 0 to draw the texture as it is
+} BatchState;
+
+typedef struct
+{
+	int primitives;  // primitives recorded
+	int groups;  // groups the primitives were sorted into
+	int drawCalls;  // sceGuDrawArray calls emitted
+	int textureBinds;  // texture changes emitted
+	int clutLoads;  // palette changes emitted
+	int flushes;  // batchFlush calls that emitted anything
+} BatchStats;
+
+/**
+ * Reset the GE state cache, to be called after a new display list was started.
+ */
+extern void batchBeginList();
+
+/**
+ * Reserve vertices for one primitive.
+ *
+ * The primitive joins an earlier group with the same state if none of the groups
+ * recorded after it overlap the given screen bounds, so drawing order is kept
+ * wherever it is visible. The vertices are copied into the display list by batchFlush.
+ *
+ * @pre state != NULL && count > 0 && a display list is open
+ * @param state - GE state the primitive is drawn with
+ * @param count - number of vertices
+ * @param x0 - left screen bound of the primitive
+ * @param y0 - top screen bound of the primitive
+ * @param x1 - right screen bound of the primitive (exclusive)
+ * @param y1 - bottom screen bound of the primitive (exclusive)
+ * @return pointer to storage for count vertices of state->vertexSize bytes
+ */
+extern void* batchVertices(const BatchState* state, int count, int x0, int y0, int x1, int y1);
+
+/**
+ * Restrict drawing to a set of screen rectangles.
+ *
+ * batchFlush emits the groups overlapping each rectangle with the scissor set to it, and
+ * resets the scissor to the whole screen afterwards. The set is read at flush time.
+ *
+ * @param clip - rectangles to draw into, NULL to draw everywhere
+ */
+extern void batchSetClip(const DamageSet* clip);
+
+/**
+ * Emit all recorded primitives into the open display list, one draw call per group
+ * (and clip rectangle).
+ */
+extern void batchFlush();
+
+/**
+ * Get the batch statistics accumulated since the last reset.
+ *
+ * @return pointer to the live statistics
+ */
+extern const BatchStats* batchGetStats();
+
+/**
+ * Reset the batch statistics to zero.
+ */
+extern void batchResetStats();
+
+#endif
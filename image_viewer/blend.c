@@ -0,0 +1,136 @@
+#include "blend.h"
+
+#if defined(HOST_BUILD) && defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(HOST_BUILD) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * The Allegrex has no packed integer instructions and the VFPU only computes in floats,
+ * so the target kernel blends red and blue, then green and alpha, as two 16-bit lanes
+ * of one register. Host builds use SSE2 or NEON with the same arithmetic.
+ */
+
+u32 blendColor(u32 destination, u32 source)
+{
+	u32 sourceAlpha = source >> 24;
+	u32 a, inverse, rb, g, alpha;
+	if (sourceAlpha == 0) return destination;
+	if (sourceAlpha == 255) return source;
+	a = sourceAlpha + (sourceAlpha >> 7);
+	inverse = 256 - a;
+	rb = (((source & 0x00ff00ff) * a + (destination & 0x00ff00ff) * inverse) >> 8) & 0x00ff00ff;
+	g = (((source & 0x0000ff00) * a + (destination & 0x0000ff00) * inverse) >> 8) & 0x0000ff00;
+	alpha = (sourceAlpha + (((destination >> 24) * inverse) >> 8)) << 24;
+	return rb | g | alpha;
+}
+
+u32 blendColorPremultiplied(u32 destination, u32 source)
+{
+	u32 sourceAlpha = source >> 24;
+	u32 inverse, rb, ag;
+	if (sourceAlpha == 255) return source;
+	inverse = 256 - (sourceAlpha + (sourceAlpha >> 7));
+	rb = (source & 0x00ff00ff) + ((((destination & 0x00ff00ff) * inverse) >> 8) & 0x00ff00ff);
+	ag = ((source >> 8) & 0x00ff00ff) + (((((destination >> 8) & 0x00ff00ff) * inverse) >> 8) & 0x00ff00ff);
+	return rb | (ag << 8);
+}
+
+#if defined(HOST_BUILD) && defined(__SSE2__)
+
+/* Blend two pixels widened to one 16-bit lane per channel. */
+static __m128i blendPixels(__m128i source, __m128i destination, int premultiplied)
+{
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(source, 0xff), 0xff);
+	__m128i a = _mm_add_epi16(alpha, _mm_srli_epi16(alpha, 7));
+	__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(256), a);
+	if (premultiplied) {
+		return _mm_add_epi16(source, _mm_srli_epi16(_mm_mullo_epi16(destination, inverse), 8));
+	}
+	// the alpha lane takes the source alpha whole, like blendColor()
+	a = _mm_or_si128(_mm_and_si128(a, _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1)),
+		_mm_set_epi16(256, 0, 0, 0, 256, 0, 0, 0));
+	return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(source, a), _mm_mullo_epi16(destination, inverse)), 8);
+}
+
+static void blendRowVector(u32* out, const u32* in, int count, int premultiplied)
+{
+	int i;
+	__m128i zero = _mm_setzero_si128();
+	for (i = 0; i + 4 <= count; i += 4) {
+		__m128i source = _mm_loadu_si128((const __m128i*) (in + i));
+		__m128i destination = _mm_loadu_si128((const __m128i*) (out + i));
+		__m128i alpha = _mm_srli_epi32(source, 24);
+		if (!premultiplied && _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xffff) continue;
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_set1_epi32(255))) != 0xffff) {
+			__m128i low = blendPixels(_mm_unpacklo_epi8(source, zero), _mm_unpacklo_epi8(destination, zero), premultiplied);
+			__m128i high = blendPixels(_mm_unpackhi_epi8(source, zero), _mm_unpackhi_epi8(destination, zero), premultiplied);
+			source = _mm_packus_epi16(low, high);
+		}
+		_mm_storeu_si128((__m128i*) (out + i), source);
+	}
+	for (; i < count; i++) {
+		out[i] = premultiplied ? blendColorPremultiplied(out[i], in[i]) : blendColor(out[i], in[i]);
+	}
+}
+
+#elif defined(HOST_BUILD) && defined(__ARM_NEON)
+
+/* Blend eight values of one channel. */
+static uint8x8_t blendChannel(uint8x8_t source, uint8x8_t destination, uint16x8_t a, uint16x8_t inverse)
+{
+	uint16x8_t sum = vmlaq_u16(vmulq_u16(vmovl_u8(source), a), vmovl_u8(destination), inverse);
+	return vshrn_n_u16(sum, 8);
+}
+
+/* Add the part of eight destination values the source lets through. */
+static uint8x8_t addBelow(uint8x8_t source, uint8x8_t destination, uint16x8_t inverse)
+{
+	return vadd_u8(source, vshrn_n_u16(vmulq_u16(vmovl_u8(destination), inverse), 8));
+}
+
+static void blendRowVector(u32* out, const u32* in, int count, int premultiplied)
+{
+	int i, c;
+	for (i = 0; i + 8 <= count; i += 8) {
+		// deinterleaved, val[3] holds the alpha of all eight pixels
+		uint8x8x4_t source = vld4_u8((const u8*) (in + i));
+		uint8x8x4_t destination = vld4_u8((const u8*) (out + i));
+		uint16x8_t alpha = vmovl_u8(source.val[3]);
+		uint16x8_t a = vaddq_u16(alpha, vshrq_n_u16(alpha, 7));
+		uint16x8_t inverse = vsubq_u16(vdupq_n_u16(256), a);
+		if (premultiplied) {
+			for (c = 0; c < 4; c++) destination.val[c] = addBelow(source.val[c], destination.val[c], inverse);
+		} else {
+			for (c = 0; c < 3; c++) destination.val[c] = blendChannel(source.val[c], destination.val[c], a, inverse);
+			destination.val[3] = addBelow(source.val[3], destination.val[3], inverse);
+		}
+		vst4_u8((u8*) (out + i), destination);
+	}
+	for (; i < count; i++) {
+		out[i] = premultiplied ? blendColorPremultiplied(out[i], in[i]) : blendColor(out[i], in[i]);
+	}
+}
+
+#endif
+
+void blendRow(u32* out, const u32* in, int count)
+{
+#if defined(HOST_BUILD) && (defined(__SSE2__) || defined(__ARM_NEON))
+	blendRowVector(out, in, count, 0);
+#else
+	int i;
+	for (i = 0; i < count; i++) out[i] = blendColor(out[i], in[i]);
+#endif
+}
+
+void blendRowPremultiplied(u32* out, const u32* in, int count)
+{
+#if defined(HOST_BUILD) && (defined(__SSE2__) || defined(__ARM_NEON))
+	blendRowVector(out, in, count, 1);
+#else
+	int i;
+	for (i = 0; i < count; i++) out[i] = blendColorPremultiplied(out[i], in[i]);
+#endif
+}
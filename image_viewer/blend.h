@@ -0,0 +1,55 @@
+#ifndef BLEND_H
+#define BLEND_H
+
+#include <psptypes.h>
+
+/*
+ * Source-over blending of 8888 colors (red in the low byte, like Color in graphics.h).
+ *
+ * All kernels compute every channel as (s * a + d * (256 - a)) >> 8 with a = alpha + (alpha >> 7),
+ * so the scalar, SSE2 and NEON versions give the same bits. Fully transparent and fully
+ * opaque source pixels leave the destination or copy the source exactly.
+ */
+
+/**
+ * Blend a straight alpha color over another.
+ *
+ * The color channels are interpolated by the source alpha, the alpha channel becomes
+ * a + d.a * (1 - a), which is exact for opaque destinations.
+ *
+ * @param destination - color below
+ * @param source - color on top, not premultiplied
+ * @return the blended color
+ */
+extern u32 blendColor(u32 destination, u32 source);
+
+/**
+ * Blend a premultiplied alpha color over another.
+ *
+ * @param destination - color below, premultiplied
+ * @param source - color on top, premultiplied (no channel larger than its alpha)
+ * @return the blended color, premultiplied
+ */
+extern u32 blendColorPremultiplied(u32 destination, u32 source);
+
+/**
+ * Blend a row of straight alpha colors over another, like blendColor().
+ *
+ * @pre out != NULL && in != NULL && count >= 0, the rows must not overlap
+ * @param out - destination row, blended in place
+ * @param in - source row
+ * @param count - number of pixels
+ */
+extern void blendRow(u32* out, const u32* in, int count);
+
+/**
+ * Blend a row of premultiplied alpha colors over another, like blendColorPremultiplied().
+ *
+ * @pre out != NULL && in != NULL && count >= 0, the rows must not overlap
+ * @param out - destination row, blended in place
+ * @param in - source row
+ * @param count - number of pixels
+ */
+extern void blendRowPremultiplied(u32* out, const u32* in, int count);
+
+#endif
@@ -0,0 +1,71 @@
+#include "clip.h"
+
+#define INSIDE 0
+#define LEFT 1
+#define RIGHT 2
+#define TOP 4
+#define BOTTOM 8
+
+static int outCode(int x, int y, int left, int top, int right, int bottom)
+{
+	int code = INSIDE;
+	if (x < left) code |= LEFT;
+	else if (x > right) code |= RIGHT;
+	if (y < top) code |= TOP;
+	else if (y > bottom) code |= BOTTOM;
+	return code;
+}
+
+/*
+ * a + (b - a) * numerator / denominator, rounded to the nearest integer. The caller keeps
+ * |numerator| <= |denominator|, the result then lies between a and b. The product is split
+ * at the quotient so any two ints work without overflowing 64 bits.
+ */
+static int interpolate(int a, int b, long long numerator, long long denominator)
+{
+	long long difference = (long long) b - a;
+	int negative = (difference < 0) != ((numerator < 0) != (denominator < 0));
+	unsigned long long d = difference < 0 ? -difference : difference;
+	unsigned long long n = numerator < 0 ? -numerator : numerator;
+	unsigned long long m = denominator < 0 ? -denominator : denominator;
+	unsigned long long step = d / m * n + (d % m * n + m / 2) / m;
+	return negative ? (int) (a - (long long) step) : (int) (a + (long long) step);
+}
+
+int clipLine(int* x0, int* y0, int* x1, int* y1, int left, int top, int right, int bottom)
+{
+	int code0 = outCode(*x0, *y0, left, top, right, bottom);
+	int code1 = outCode(*x1, *y1, left, top, right, bottom);
+	int i;
+	// rounding can leave a moved point just outside a corner, four moves per point are enough
+	for (i = 0; i < 8; i++) {
+		int x, y, code;
+		if (!(code0 | code1)) return 1;
+		if (code0 & code1) return 0;
+		// move the end point outside onto the border it crosses first
+		code = code0 ? code0 : code1;
+		if (code & TOP) {
+			x = interpolate(*x0, *x1, (long long) top - *y0, (long long) *y1 - *y0);
+			y = top;
+		} else if (code & BOTTOM) {
+			x = interpolate(*x0, *x1, (long long) bottom - *y0, (long long) *y1 - *y0);
+			y = bottom;
+		} else if (code & LEFT) {
+			y = interpolate(*y0, *y1, (long long) left - *x0, (long long) *x1 - *x0);
+			x = left;
+		} else {
+			y = interpolate(*y0, *y1, (long long) right - *x0, (long long) *x1 - *x0);
+			x = right;
+		}
+		if (code == code0) {
+			*x0 = x;
+			*y0 = y;
+			code0 = outCode(x, y, left, top, right, bottom);
+		} else {
+			*x1 = x;
+			*y1 = y;
+			code1 = outCode(x, y, left, top, right, bottom);
+		}
+	}
+	return !(code0 | code1);
+}
@@ -0,0 +1,22 @@
+#ifndef CLIP_H
+#define CLIP_H
+
+/**
+ * Clip a line to a rectangle with the Cohen-Sutherland algorithm.
+ *
+ * The end points are moved onto the rectangle border where the line leaves it,
+ * rounded to the nearest pixel.
+ *
+ * @param x0 - x line start position, updated
+ * @param y0 - y line start position, updated
+ * @param x1 - x line end position, updated
+ * @param y1 - y line end position, updated
+ * @param left - leftmost pixel column inside the rectangle
+ * @param top - topmost pixel row inside the rectangle
+ * @param right - rightmost pixel column inside the rectangle (inclusive)
+ * @param bottom - bottommost pixel row inside the rectangle (inclusive)
+ * @return 1 if part of the line is inside the rectangle, 0 if all of it is outside
+ */
+extern int clipLine(int* x0, int* y0, int* x1, int* y1, int left, int top, int right, int bottom);
+
+#endif
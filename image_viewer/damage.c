@@ -0,0 +1,91 @@
+#include "damage.h"
+
+#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
+#define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
+
+static int area(const DamageRect* rect)
+{
+	return (rect->x1 - rect->x0) * (rect->y1 - rect->y0);
+}
+
+static void unite(DamageRect* rect, const DamageRect* other)
+{
+	rect->x0 = MIN(rect->x0, other->x0);
+	rect->y0 = MIN(rect->y0, other->y0);
+	rect->x1 = MAX(rect->x1, other->x1);
+	rect->y1 = MAX(rect->y1, other->y1);
+}
+
+/* Overlapping or touching rectangles are merged, their union covers little extra. */
+static int touches(const DamageRect* a, const DamageRect* b)
+{
+	return a->x0 <= b->x1 && b->x0 <= a->x1 && a->y0 <= b->y1 && b->y0 <= a->y1;
+}
+
+static void removeRect(DamageSet* set, int i)
+{
+	set->rects[i] = set->rects[--set->count];
+}
+
+void damageClear(DamageSet* set)
+{
+	set->count = 0;
+}
+
+void damageAdd(DamageSet* set, int x0, int y0, int x1, int y1)
+{
+	DamageRect rect;
+	int i, best, bestGrowth;
+	if (x0 >= x1 || y0 >= y1) return;
+	rect.x0 = x0;
+	rect.y0 = y0;
+	rect.x1 = x1;
+	rect.y1 = y1;
+
+	// a merge can make the rectangle touch others, so keep merging until none is left
+	for (i = 0; i < set->count; i++) {
+		if (!touches(&set->rects[i], &rect)) continue;
+		unite(&rect, &set->rects[i]);
+		removeRect(set, i);
+		i = -1;
+	}
+	if (set->count < DAMAGE_MAX_RECTS) {
+		set->rects[set->count++] = rect;
+		return;
+	}
+
+	best = 0;
+	bestGrowth = -1;
+	for (i = 0; i < set->count; i++) {
+		DamageRect merged = set->rects[i];
+		int growth;
+		unite(&merged, &rect);
+		growth = area(&merged) - area(&set->rects[i]) - area(&rect);
+		if (bestGrowth < 0 || growth < bestGrowth) {
+			best = i;
+			bestGrowth = growth;
+		}
+	}
+	unite(&rect, &set->rects[best]);
+	removeRect(set, best);
+	damageAdd(set, rect.x0, rect.y0, rect.x1, rect.y1);
+}
+
+void damageAddSet(DamageSet* set, const DamageSet* other)
+{
+	int i;
+	for (i = 0; i < other->count; i++) {
+		const DamageRect* rect = &other->rects[i];
+		damageAdd(set, rect->x0, rect->y0, rect->x1, rect->y1);
+	}
+}
+
+int damageIntersects(const DamageSet* set, int x0, int y0, int x1, int y1)
+{
+	int i;
+	for (i = 0; i < set->count; i++) {
+		const DamageRect* rect = &set->rects[i];
+		if (rect->x0 < x1 && x0 < rect->x1 && rect->y0 < y1 && y0 < rect->y1) return 1;
+	}
+	return 0;
+}
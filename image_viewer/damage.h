@@ -0,0 +1,61 @@
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#define DAMAGE_MAX_RECTS 8
+
+/** Screen rectangle, x1 and y1 exclusive. */
+typedef struct
+{
+	int x0, y0, x1, y1;
+} DamageRect;
+
+/**
+ * A small set of rectangles covering the changed parts of the screen. Rectangles that
+ * overlap or touch are merged, and when the set is full the two whose union grows the
+ * least are merged, so the set may cover a bit more than what was added.
+ */
+typedef struct
+{
+	DamageRect rects[DAMAGE_MAX_RECTS];
+	int count;
+} DamageSet;
+
+/**
+ * Empty a set.
+ *
+ * @param set - the set
+ */
+extern void damageClear(DamageSet* set);
+
+/**
+ * Add a rectangle to a set. Empty rectangles are ignored.
+ *
+ * @param set - the set
+ * @param x0 - left edge
+ * @param y0 - top edge
+ * @param x1 - right edge (exclusive)
+ * @param y1 - bottom edge (exclusive)
+ */
+extern void damageAdd(DamageSet* set, int x0, int y0, int x1, int y1);
+
+/**
+ * Add all rectangles of another set to a set.
+ *
+ * @param set - the set
+ * @param other - the rectangles to add
+ */
+extern void damageAddSet(DamageSet* set, const DamageSet* other);
+
+/**
+ * Check whether a rectangle overlaps the set.
+ *
+ * @param set - the set
+ * @param x0 - left edge
+ * @param y0 - top edge
+ * @param x1 - right edge (exclusive)
+ * @param y1 - bottom edge (exclusive)
+ * @return 1 if any rectangle of the set overlaps, 0 otherwise
+ */
+extern int damageIntersects(const DamageSet* set, int x0, int y0, int x1, int y1);
+
+#endif
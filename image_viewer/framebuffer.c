@@ -1,4 +1,9 @@
 #include <psptypes.h>
 #include "graphics.h"
 
+#ifdef HOST_BUILD
+#include <pspge.h>
+Color* g_vram_base = (Color*) host_vram;
+#else
 Color* g_vram_base = (Color*) (0x40000000 | 0x04000000);
+#endif
@@ -0,0 +1,43 @@
+#include <string.h>
+
+#include "framestats.h"
+
+static int bucketOf(unsigned int micros)
+{
+	unsigned int bucket = micros / FRAME_STATS_BUCKET_MICROS;
+	return bucket < FRAME_STATS_BUCKETS ? bucket : FRAME_STATS_BUCKETS - 1;
+}
+
+/* Add (sign 1) or remove (sign -1) a frame from the sums and histograms. */
+static void count(FrameStats* stats, const FrameTiming* timing, int sign)
+{
+	stats->cpuHistogram[bucketOf(timing->cpuMicros)] += sign;
+	stats->geWaitHistogram[bucketOf(timing->geWaitMicros)] += sign;
+	stats->cpuMicros += sign * timing->cpuMicros;
+	stats->geWaitMicros += sign * timing->geWaitMicros;
+	stats->missedVblanks += sign * timing->missedVblanks;
+	if (timing->missedVblanks > 0) stats->lateFrames += sign;
+}
+
+void frameStatsInit(FrameStats* stats)
+{
+	memset(stats, 0, sizeof(FrameStats));
+}
+
+void frameStatsAdd(FrameStats* stats, const FrameTiming* timing)
+{
+	if (stats->frames == FRAME_STATS_WINDOW) {
+		count(stats, &stats->timings[stats->next], -1);
+	} else {
+		stats->frames++;
+	}
+	stats->timings[stats->next] = *timing;
+	count(stats, timing, 1);
+	stats->next = (stats->next + 1) % FRAME_STATS_WINDOW;
+}
+
+const FrameTiming* frameStatsGet(const FrameStats* stats, int age)
+{
+	if (age < 0 || age >= stats->frames) return NULL;
+	return &stats->timings[(stats->next - 1 - age + FRAME_STATS_WINDOW) % FRAME_STATS_WINDOW];
+}
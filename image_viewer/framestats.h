@@ -0,0 +1,57 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#define FRAME_STATS_WINDOW 120  // frames in the rolling window, two seconds at 60 Hz
+#define FRAME_STATS_BUCKETS 8
+#define FRAME_STATS_BUCKET_MICROS 4000  // width of a histogram bucket, the last one also counts everything above
+
+/** Timing of one frame, from one flipScreen() to the next. */
+typedef struct
+{
+	unsigned int cpuMicros;  // time not spent waiting for the GE or a vblank
+	unsigned int geWaitMicros;  // time blocked until the GE finished a display list
+	int missedVblanks;  // vblanks the frame was put on screen later than the pacing allows
+} FrameTiming;
+
+/**
+ * Rolling statistics over the last FRAME_STATS_WINDOW frames. The histograms and sums
+ * are updated as frames enter and leave the window, so reading them is free.
+ */
+typedef struct
+{
+	int frames;  // frames in the window
+	int cpuHistogram[FRAME_STATS_BUCKETS];  // frames by CPU time, bucket i from i * FRAME_STATS_BUCKET_MICROS
+	int geWaitHistogram[FRAME_STATS_BUCKETS];  // frames by GE wait time
+	unsigned int cpuMicros;  // CPU time of all frames in the window
+	unsigned int geWaitMicros;  // GE wait time of all frames in the window
+	int missedVblanks;  // vblanks missed in the window
+	int lateFrames;  // frames in the window that missed at least one vblank
+	FrameTiming timings[FRAME_STATS_WINDOW];  // ring of the frames in the window
+	int next;  // ring index of the next frame
+} FrameStats;
+
+/**
+ * Empty the window.
+ *
+ * @param stats - the statistics
+ */
+extern void frameStatsInit(FrameStats* stats);
+
+/**
+ * Add a frame to the window, dropping the oldest one if the window is full.
+ *
+ * @param stats - the statistics
+ * @param timing - timing of the frame
+ */
+extern void frameStatsAdd(FrameStats* stats, const FrameTiming* timing);
+
+/**
+ * Get the timing of a frame in the window.
+ *
+ * @param stats - the statistics
+ * @param age - 0 for the last frame, 1 for the one before, ...
+ * @return the timing, NULL if age >= stats->frames
+ */
+extern const FrameTiming* frameStatsGet(const FrameStats* stats, int age);
+
+#endif
@@ -1,16 +1,45 @@
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <malloc.h>
+#include <math.h>
 #include <pspdisplay.h>
+#include <pspkernel.h>
+#include <pspiofilemgr.h>
 #include <psputils.h>
 #include <png.h>
 #include <pspgu.h>
+#include <pspge.h>
 
 #include "graphics.h"
 #include "framebuffer.h"
+#include "batch.h"
+#include "texcache.h"
+#include "swizzle.h"
+#include "pixelformat.h"
+#include "blend.h"
+#include "damage.h"
+#include "text.h"
+#include "clip.h"
+#include "framestats.h"
+#include "sprite.h"
+#include "profile.h"
+#include "texfile.h"
 
-#define IS_ALPHA(color) (((color)&0xff000000)==0xff000000?0:1)
-#define FRAMEBUFFER_SIZE (PSP_LINE_SIZE*SCREEN_HEIGHT*4)
+#define DEPTHBUFFER_SIZE (PSP_LINE_SIZE*SCREEN_HEIGHT*2)
+#define DISPLAY_LIST_SIZE 131072
+#define CAPTURE_THREAD_PRIORITY 0x30  // below the main thread, encodes while it waits for vblank or the GE
+#define CAPTURE_THREAD_STACK_SIZE 0x10000
+#define CAPTURE_FILENAME_SIZE 256
+#define PROFILE_OVERLAY_X 8
+#define PROFILE_OVERLAY_Y 8
+#define PROFILE_OVERLAY_WIDTH 220
+#define PROFILE_LINE_HEIGHT 10
+#define PROFILE_BAR_X 112  // bars start right of the numbers
+#define PROFILE_BAR_WIDTH 100  // bar length of one vblank
+#define PROFILE_VBLANK_MICROS 16683
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
+#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 
 typedef struct
 {
@@ -18,11 +47,69 @@ typedef struct
 	short x, y, z;
 } Vertex;
 
+typedef struct
+{
+	u32 color;
+	short x, y, z;
+} ColorVertex;
+
+typedef struct
+{
+	float u, v;
+	u32 color;
+	float x, y, z;
+} SpriteVertex;
+
 extern u8 msx[];
 
-unsigned int __attribute__((aligned(16))) list[262144];
-static int dispBufferNumber;
+unsigned int __attribute__((aligned(16))) list[2][DISPLAY_LIST_SIZE];
+static PspGeContext __attribute__((aligned(16))) geContext;
+static int listIndex;  // list the current frame is recorded into
+static FrameFence listFence[2];  // fence of the last submission of each list
+static int dispBufferNumber;  // buffer on screen
+static int drawBufferNumber;  // buffer the current frame draws into
+static int frameBufferNumber;  // buffer of the last flipped frame
+static int bufferCount = 2;  // frame buffers in use, 3 when triple buffering
+static int thirdBuffer = 0;  // VRAM of a third frame buffer is taken from the textures
+static int framePacing = FRAME_PACING_UNCAPPED;
+static unsigned int swapVcount;  // vblank count at the last swap
+static int swapLatching = 0;  // the last swap waits for vblank, the buffer shown before it is still scanned out
+static int scannedBufferNumber;  // buffer on screen until the last swap latches
+static FrameStats frameStats;
+static FrameTiming frameTiming;  // waits of the frame being recorded
+static unsigned int vblankWaitMicros;  // time the frame being recorded waited for vblank
+static unsigned int frameStart;  // time of the last flip
 static int initialized = 0;
+static int listOpen = 0;
+static int framePending = 0;  // a flipped frame waits to be put on screen
+static FrameFence frameFence;  // fence of the last flipped frame
+static FrameFence submittedLists;
+static FrameFence completedLists;
+static TextureCache textureCache;
+static ImageMemoryStats imageMemoryStats;
+static SceUID imageStatsLock = -1;  // guards imageMemoryStats, the loader thread counts the images it loads
+static int damageTracking = 0;
+static DamageSet frameDamage;  // marked since the last flip
+static DamageSet lastDamage;  // marked in the frame before, the third buffer misses it as well
+static Image* glyphAtlas;  // msx font as 4-bit indices, index 1 is a white glyph pixel
+static TextCache textCache;
+static DamageSet redraw;  // damage of this and the last flipped frame, the draw buffer misses both
+static int screenFormat = GU_PSM_8888;
+static int profileOverlay = 0;
+static int frameBufferSize;  // bytes of one frame buffer in VRAM
+
+/* Screen capture handed from the GE copy to the encoder thread. */
+static struct
+{
+	volatile int state;  // SCREEN_CAPTURE_*, written by the encoder thread while encoding
+	FrameFence fence;  // list that copies the screen
+	void* pixels;  // SCREEN_WIDTH x SCREEN_HEIGHT copy of the screen in screenFormat
+	char filename[CAPTURE_FILENAME_SIZE];
+	int saveAlpha;
+	SceUID thread;
+	SceUID start;  // semaphore signaled when a copy is ready to be encoded
+	ScreenCaptureStats stats;
+} capture = { SCREEN_CAPTURE_IDLE, 0, NULL, "", 0, -1, -1 };
 
 static int getNextPower2(int width)
 {
@@ -34,327 +121,1319 @@ static int getNextPower2(int width)
 	return b;
 }
 
-Color* getVramDrawBuffer()
+static int formatFromFlags(int flags)
+{
+	switch (flags & IMAGE_FORMAT_MASK) {
+		case IMAGE_FORMAT_5650: return GU_PSM_5650;
+		case IMAGE_FORMAT_5551: return GU_PSM_5551;
+		case IMAGE_FORMAT_4444: return GU_PSM_4444;
+		case IMAGE_FORMAT_T4: return GU_PSM_T4;
+		case IMAGE_FORMAT_T8: return GU_PSM_T8;
+		default: return GU_PSM_8888;
+	}
+}
+
+/*
+ * Rows are padded to 16 pixels and at least 16 bytes, so every row can be swizzled and
+ * indices can be copied as 16-bit pixels.
+ */
+static int strideFor(int width, int format)
+{
+	int align = MAX(16, 128 / pixelFormatBits(format));
+	return (width + align - 1) & ~(align - 1);
+}
+
+static int rowBytesOf(Image* image)
+{
+	return image->stride * pixelFormatBits(image->format) / 8;
+}
+
+/* Rows allocated for an image, swizzled images need whole blocks of 8 rows. */
+static int rowsOf(Image* image)
+{
+	return image->swizzled ? (image->imageHeight + 7) & ~7 : image->imageHeight;
+}
+
+/* The GE needs whole 16 byte x 8 row blocks to read a swizzled texture. */
+static int canSwizzle(int stride, int format)
+{
+	return (stride * pixelFormatBits(format) / 8) % SWIZZLE_BLOCK_WIDTH == 0;
+}
+
+/* Set the GE texture size and the storage layout, imageWidth, imageHeight and format must be set. */
+static void setImageLayout(Image* image, int flags)
+{
+	image->textureWidth = getNextPower2(image->imageWidth);
+	image->textureHeight = getNextPower2(image->imageHeight);
+	image->stride = strideFor(image->imageWidth, image->format);
+	image->swizzled = (flags & IMAGE_SWIZZLE) && canSwizzle(image->stride, image->format);
+}
+
+/* Add (count 1) or remove (count -1) an image from the memory counters. */
+static void countImage(Image* image, int count)
+{
+	int bits = pixelFormatBits(image->format);
+	int bytes = rowBytesOf(image) * rowsOf(image);
+	int paddedBytes = image->textureWidth * image->textureHeight * bits / 8;
+	if (imageStatsLock >= 0) sceKernelWaitSema(imageStatsLock, 1, NULL);
+	imageMemoryStats.images += count;
+	imageMemoryStats.bytes += count * bytes;
+	imageMemoryStats.bytesSaved += count * (paddedBytes - bytes);
+	if (imageStatsLock >= 0) sceKernelSignalSema(imageStatsLock, 1);
+}
+
+const ImageMemoryStats* getImageMemoryStats()
+{
+	return &imageMemoryStats;
+}
+
+int getImageBytes(Image* image)
+{
+	return rowBytesOf(image) * rowsOf(image) + image->paletteEntries * sizeof(Color);
+}
+
+/* Memory of an image, from an arena or the image allocator. */
+static void* allocateFrom(ImageArena* arena, int size)
+{
+	return arena ? allocArenaMemory(arena, size) : allocImageMemory(size);
+}
+
+static Image* allocateImageIn(ImageArena* arena, int width, int height, int format, int flags)
+{
+	Image* image = (Image*) allocateFrom(arena, sizeof(Image));
+	if (!image) return NULL;
+	image->imageWidth = width;
+	image->imageHeight = height;
+	image->format = format;
+	setImageLayout(image, flags);
+	image->palette = NULL;
+	image->paletteEntries = 0;
+	if (pixelFormatIndexed(image->format)) {
+		image->paletteEntries = image->format == GU_PSM_T4 ? 16 : 256;
+		image->palette = (Color*) allocateFrom(arena, image->paletteEntries * sizeof(Color));
+		if (!image->palette) {
+			freeImageMemory(image);
+			return NULL;
+		}
+	}
+	image->data = allocateFrom(arena, rowBytesOf(image) * rowsOf(image));
+	if (!image->data || (arena && !addArenaImage(arena, image))) {
+		freeImageMemory(image->data);
+		freeImageMemory(image->palette);
+		freeImageMemory(image);
+		return NULL;
+	}
+	image->dirtyTop = 0;
+	image->dirtyBottom = rowsOf(image);
+	countImage(image, 1);
+	return image;
+}
+
+/* Allocate an image with its palette and pixel storage, neither of them initialized, in the current arena while it has room, unless IMAGE_NO_ARENA is set. */
+static Image* allocateImage(int width, int height, int format, int flags)
+{
+	ImageArena* arena = (flags & IMAGE_NO_ARENA) ? NULL : getImageArena();
+	Image* image = arena ? allocateImageIn(arena, width, height, format, flags) : NULL;
+	return image ? image : allocateImageIn(NULL, width, height, format, flags);
+}
+
+/* Free an image the GE never used, it has no texture cache entry. Safe on the loader thread, unlike freeImage(). */
+static void discardImage(Image* image)
+{
+	ImageArena* arena = findImageArena(image);
+	countImage(image, -1);
+	if (arena) removeArenaImage(arena, image);
+	freeImageMemory(image->palette);
+	freeImageMemory(image->data);
+	freeImageMemory(image);
+}
+
+/* Address of a pixel, for GU_PSM_T4 of the byte holding it in the low (even x) or high nibble. */
+static void* pixelAddress(Image* image, int x, int y)
+{
+	int bits = pixelFormatBits(image->format);
+	if (image->swizzled) {
+		return (u8*) image->data + SWIZZLE_OFFSET(rowBytesOf(image), x * bits / 8, y);
+	}
+	return (u8*) image->data + y * rowBytesOf(image) + x * bits / 8;
+}
+
+static void storePixel(void* address, int bytes, u32 pixel)
+{
+	if (bytes == 4) *(u32*) address = pixel;
+	else *(u16*) address = pixel;
+}
+
+static u32 loadPixel(const void* address, int bytes)
+{
+	return bytes == 4 ? *(const u32*) address : *(const u16*) address;
+}
+
+/* Read a pixel in the image's own format, a palette index for indexed images. */
+static u32 fetchPixel(Image* image, int x, int y)
+{
+	u8* address = (u8*) pixelAddress(image, x, y);
+	switch (image->format) {
+		case GU_PSM_T4: return (x & 1) ? *address >> 4 : *address & 0xf;
+		case GU_PSM_T8: return *address;
+		default: return loadPixel(address, pixelFormatBytes(image->format));
+	}
+}
+
+/* Write a pixel in the image's own format, a palette index for indexed images. */
+static void plotPixel(Image* image, int x, int y, u32 pixel)
+{
+	u8* address = (u8*) pixelAddress(image, x, y);
+	switch (image->format) {
+		case GU_PSM_T4:
+			*address = (x & 1) ? (*address & 0x0f) | (pixel << 4) : (*address & 0xf0) | pixel;
+			break;
+		case GU_PSM_T8:
+			*address = pixel;
+			break;
+		default:
+			storePixel(address, pixelFormatBytes(image->format), pixel);
+	}
+}
+
+/* The palette entry closest to a color, there is no better way to store a color in an indexed image. */
+static u32 nearestIndex(Image* image, Color color)
+{
+	int i;
+	u32 best = 0;
+	u32 bestDistance = 0xffffffff;
+	for (i = 0; i < image->paletteEntries; i++) {
+		Color entry = image->palette[i];
+		int dr = R(entry) - R(color);
+		int dg = G(entry) - G(color);
+		int db = B(entry) - B(color);
+		int da = A(entry) - A(color);
+		u32 distance = dr * dr + dg * dg + db * db + da * da;
+		if (distance < bestDistance) {
+			best = i;
+			bestDistance = distance;
+			if (distance == 0) break;
+		}
+	}
+	return best;
+}
+
+/* Convert a color to the image's own format. */
+static u32 imagePixel(Image* image, Color color)
+{
+	if (image->palette) return nearestIndex(image, color);
+	return colorToPixel(color, image->format);
+}
+
+static Color readPixel(Image* image, int x, int y)
+{
+	u32 pixel = fetchPixel(image, x, y);
+	if (image->palette) return image->palette[pixel];
+	return pixelToColor(pixel, image->format);
+}
+
+static void writePixel(Image* image, int x, int y, Color color)
+{
+	plotPixel(image, x, y, imagePixel(image, color));
+}
+
+/* Both images store the same color in the same bits, so pixels can be copied unconverted. */
+static int sameEncoding(Image* a, Image* b)
+{
+	if (a->format != b->format) return 0;
+	if (!a->palette) return 1;
+	return a->palette == b->palette || memcmp(a->palette, b->palette, a->paletteEntries * sizeof(Color)) == 0;
+}
+
+/* Fill count pixels of a row, pixel already converted to the format of the row. */
+static void fillRow(void* row, int count, int bytes, u32 pixel)
+{
+	int i;
+	if (bytes == 4) {
+		u32* data = (u32*) row;
+		for (i = 0; i < count; i++) data[i] = pixel;
+	} else {
+		u16* data = (u16*) row;
+		for (i = 0; i < count; i++) data[i] = pixel;
+	}
+}
+
+/* Extend the range of rows the CPU changed since the GE last saw the image. */
+static void markDirty(Image* image, int top, int bottom)
+{
+	if (top < image->dirtyTop) image->dirtyTop = top;
+	if (bottom > image->dirtyBottom) image->dirtyBottom = bottom;
+}
+
+/* Write memory the GE is going to read back from the data cache. */
+static void writebackRange(const void* data, int size)
+{
+	sceKernelDcacheWritebackRange(data, size);
+	profileCount(PROFILE_DCACHE_BYTES, size);
+}
+
+/* Write the changed rows of an image back from the data cache before the GE reads it. */
+static void flushImage(Image* image)
+{
+	int rowBytes = rowBytesOf(image);
+	int top = image->dirtyTop;
+	int bottom = image->dirtyBottom;
+	if (top >= bottom) return;
+	if (image->swizzled) {
+		// a swizzled row is spread over the blocks of its whole band of 8 rows
+		top &= ~7;
+		bottom = (bottom + 7) & ~7;
+	}
+	writebackRange((u8*) image->data + top * rowBytes, (bottom - top) * rowBytes);
+	image->dirtyTop = rowsOf(image);
+	image->dirtyBottom = 0;
+}
+
+/*
+ * Find where the GE should read an image from. Images the texture cache keeps in VRAM
+ * are copied there by the GE in list order, after every draw recorded so far, so
+ * textures evicted to make room are not overwritten before those draws ran.
+ */
+static void* textureData(Image* image)
 {
-	Color* vram = (Color*) g_vram_base;
-	if (dispBufferNumber == 0) vram += FRAMEBUFFER_SIZE / sizeof(Color);
+	int upload;
+	int changed = image->dirtyTop < image->dirtyBottom;
+	int rows = rowsOf(image);
+	int offset;
+	void* vram;
+
+	flushImage(image);
+	offset = textureCacheUse(&textureCache, image, rowBytesOf(image) * rows, changed, &upload);
+	if (offset < 0) return image->data;
+	vram = (u8*) sceGeEdramGetAddr() + offset;
+	if (upload) {
+		// swizzled texels only keep their layout when whole rows of blocks are copied
+		int width = image->swizzled ? image->stride : image->imageWidth;
+		int height = rows;
+		int format = image->format;
+		int stride = image->stride;
+		if (image->palette) {
+			// the copy engine has no indexed formats, indices are moved as 16-bit pixels
+			int bits = pixelFormatBits(format);
+			width = (width * bits + 15) / 16;
+			stride = stride * bits / 16;
+			format = GU_PSM_4444;
+		}
+		batchFlush();
+		sceGuCopyImage(format, 0, 0, width, height, stride, image->data, 0, 0, stride, vram);
+		sceGuTexSync();
+		sceGuTexFlush();
+	}
 	return vram;
 }
 
+const TextureCacheStats* getTextureCacheStats()
+{
+	return &textureCache.stats;
+}
+
+/* VRAM offset of a frame buffer, the third one follows the depth buffer. */
+static int bufferOffset(int number)
+{
+	return number < 2 ? number * frameBufferSize : frameBufferSize * 2 + DEPTHBUFFER_SIZE;
+}
+
+/* First VRAM offset after the frame and depth buffers. */
+static int textureStart()
+{
+	return frameBufferSize * (thirdBuffer ? 3 : 2) + DEPTHBUFFER_SIZE;
+}
+
+static u8* drawBuffer()
+{
+	return (u8*) g_vram_base + bufferOffset(drawBufferNumber);
+}
+
+static void* screenAddress(int x, int y)
+{
+	return drawBuffer() + (x + y * PSP_LINE_SIZE) * pixelFormatBytes(screenFormat);
+}
+
+/* Open the display list of the frame, if it is not open yet. */
+static void beginDraw()
+{
+	if (listOpen) return;
+	waitFrameFence(listFence[listIndex]);
+	sceGuStart(GU_SEND, list[listIndex]);
+	sceGuDrawBufferList(screenFormat, (void*) (uintptr_t) bufferOffset(drawBufferNumber), PSP_LINE_SIZE);
+	batchBeginList();
+	listOpen = 1;
+}
+
+/*
+ * Wait until the draw buffer is off screen. A swap queued for the next vblank leaves the
+ * buffer shown before it scanned out until then, drawing into it would tear. Only triple
+ * buffering queues its swaps.
+ */
+static void waitDrawBufferHidden()
+{
+	unsigned int start;
+	if (!swapLatching) return;
+	if (drawBufferNumber != scannedBufferNumber) return;
+	if (sceDisplayGetVcount() == swapVcount) {
+		start = sceKernelGetSystemTimeLow();
+		sceDisplayWaitVblankStart();
+		vblankWaitMicros += sceKernelGetSystemTimeLow() - start;
+	}
+	swapLatching = 0;
+}
+
+/* Close the open display list and queue it on the GE without waiting for it. */
+static void submitDraw()
+{
+	int size;
+	ProfileScope scope;
+	if (!listOpen) return;
+	scope = profileBegin("submit");
+	batchFlush();
+	size = sceGuFinish();
+	writebackRange(list[listIndex], size);
+	waitDrawBufferHidden();
+	sceGuSendList(GU_TAIL, list[listIndex], &geContext);
+	listFence[listIndex] = ++submittedLists;
+	listIndex ^= 1;
+	listOpen = 0;
+	profileEnd(scope);
+}
+
+/*
+ * Wait as long as the frame pacing asks before the next swap and count the vblanks the
+ * frame came late. Returns the PSP_DISPLAY_SETBUF_* mode the swap has to use.
+ */
+static int paceFrame()
+{
+	int interval = framePacing == FRAME_PACING_VSYNC_30 ? 2 : 1;
+	// the vsync modes swap in vblank, uncapped frames are shown at once and may tear
+	int sync = framePacing == FRAME_PACING_TRIPLE ? PSP_DISPLAY_SETBUF_NEXTFRAME : PSP_DISPLAY_SETBUF_IMMEDIATE;
+	unsigned int start = sceKernelGetSystemTimeLow();
+	ProfileScope scope = profileBegin("pace");
+	int late;
+
+	if (framePacing == FRAME_PACING_VSYNC_60 || framePacing == FRAME_PACING_VSYNC_30) {
+		while ((int) (sceDisplayGetVcount() - swapVcount) < interval) sceDisplayWaitVblankStart();
+		// a late frame waits for the next vblank instead of tearing
+		if (!sceDisplayIsVblank()) sceDisplayWaitVblankStart();
+	} else if (framePacing == FRAME_PACING_TRIPLE && sceDisplayGetVcount() == swapVcount) {
+		// the buffer queued by the last swap has to be on screen before the next one is queued
+		sceDisplayWaitVblankStart();
+	}
+	late = (int) (sceDisplayGetVcount() - swapVcount) - interval;
+	if (late > 0) frameTiming.missedVblanks += late;
+	swapVcount = sceDisplayGetVcount();
+	vblankWaitMicros += sceKernelGetSystemTimeLow() - start;
+	profileEnd(scope);
+	return sync;
+}
+
+/* Show the last flipped frame once the GE is done with it. */
+static void presentFrame()
+{
+	int sync;
+	if (!framePending) return;
+	waitFrameFence(frameFence);
+	sync = paceFrame();
+	// GU_PSM_5650 to GU_PSM_8888 match the display's pixel formats
+	sceDisplaySetFrameBuf((u8*) sceGeEdramGetAddr() + bufferOffset(frameBufferNumber), PSP_LINE_SIZE, screenFormat, sync);
+	swapLatching = sync == PSP_DISPLAY_SETBUF_NEXTFRAME;
+	scannedBufferNumber = dispBufferNumber;
+	dispBufferNumber = frameBufferNumber;
+	framePending = 0;
+}
+
+/* Submit everything recorded so far and wait until the GE has drawn it. */
+static void finishDraw()
+{
+	presentFrame();
+	// the CPU may write the draw buffer once this returns
+	waitDrawBufferHidden();
+	if (!listOpen) return;
+	submitDraw();
+	waitFrameFence(submittedLists);
+}
+
+FrameFence getFrameFence()
+{
+	return frameFence;
+}
+
+FrameFence getDrawFence()
+{
+	// the open list is sent as the next fence
+	return listOpen ? submittedLists + 1 : submittedLists;
+}
+
+int isFrameFenceReached(FrameFence fence)
+{
+	unsigned int start;
+	if (fence <= completedLists) return 1;
+	start = sceKernelGetSystemTimeLow();
+	if (sceGuSync(GU_SYNC_SEND, GU_SYNC_NOWAIT) == 0) completedLists = submittedLists;
+	profileCount(PROFILE_GU_SYNC_MICROS, sceKernelGetSystemTimeLow() - start);
+	return fence <= completedLists;
+}
+
+void waitFrameFence(FrameFence fence)
+{
+	unsigned int start, micros;
+	if (fence <= completedLists) return;
+	start = sceKernelGetSystemTimeLow();
+	// lists run in order, so waiting for the last one sent covers every older fence
+	sceGuSync(GU_SYNC_SEND, GU_SYNC_WAIT);
+	completedLists = submittedLists;
+	micros = sceKernelGetSystemTimeLow() - start;
+	frameTiming.geWaitMicros += micros;
+	profileCount(PROFILE_GU_SYNC_MICROS, micros);
+}
+
+Color* getVramDrawBuffer()
+{
+	finishDraw();
+	return (Color*) drawBuffer();
+}
+
 Color* getVramDisplayBuffer()
 {
-	Color* vram = (Color*) g_vram_base;
-	if (dispBufferNumber == 1) vram += FRAMEBUFFER_SIZE / sizeof(Color);
-	return vram;
+	return (Color*) ((u8*) g_vram_base + bufferOffset(dispBufferNumber));
+}
+
+int getScreenFormat()
+{
+	return screenFormat;
+}
+
+/* Whether a screen rectangle has to be drawn, only damaged parts are when tracking damage. */
+static int needsDraw(int x0, int y0, int x1, int y1)
+{
+	return !damageTracking || damageIntersects(&redraw, x0, y0, x1, y1);
+}
+
+void setDamageTracking(int enabled)
+{
+	if (listOpen) batchFlush();
+	damageTracking = enabled;
+	damageClear(&frameDamage);
+	damageClear(&lastDamage);
+	damageClear(&redraw);
+	// nothing is known about either buffer yet, the full damage carries over to the next frame
+	if (enabled) markScreenDamage(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+	batchSetClip(enabled ? &redraw : NULL);
+}
+
+void markScreenDamage(int x, int y, int width, int height)
+{
+	int x0 = MAX(x, 0);
+	int y0 = MAX(y, 0);
+	int x1 = MIN(x + width, SCREEN_WIDTH);
+	int y1 = MIN(y + height, SCREEN_HEIGHT);
+	if (!damageTracking) return;
+	damageAdd(&frameDamage, x0, y0, x1, y1);
+	damageAdd(&redraw, x0, y0, x1, y1);
+}
+
+int isScreenRectDamaged(int x, int y, int width, int height)
+{
+	return needsDraw(x, y, x + width, y + height);
 }
 
 void user_warning_fn(png_structp png_ptr, png_const_charp warning_msg)
 {
 }
 
+/* Store a decoded row of pixels in the image's format, lineBytes bytes long. */
+static void storeRow(Image* image, int y, const u8* row, int lineBytes)
+{
+	if (image->swizzled) swizzleRow((u8*) image->data, rowBytesOf(image), y, row, lineBytes);
+	else memcpy((u8*) image->data + y * rowBytesOf(image), row, lineBytes);
+}
+
 Image* loadImage(const char* filename)
 {
-	png_structp png_ptr;
+	return loadImageEx(filename, 0);
+}
+
+/* Decode a PNG from wherever png_ptr reads, and destroy png_ptr. */
+static Image* readPng(png_structp png_ptr, int flags)
+{
 	png_infop info_ptr;
 	unsigned int sig_read = 0;
 	png_uint_32 width, height;
-	int bit_depth, color_type, interlace_type, x, y;
+	int bit_depth, color_type, interlace_type, y, x;
+	int rowBytes, lineBytes;
+	int indexed, format;
+	png_colorp colors;
+	png_bytep alphas = NULL;
+	int colorCount, alphaCount = 0, i;
 	u32* line;
+	u8* row;
+	Image* image;
+	info_ptr = png_create_info_struct(png_ptr);
+	if (info_ptr == NULL) {
+		png_destroy_read_struct(&png_ptr, (png_infopp)NULL, (png_infopp)NULL);
+		return NULL;
+	}
+	png_set_sig_bytes(png_ptr, sig_read);
+	png_read_info(png_ptr, info_ptr);
+	png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth, &color_type, &interlace_type, NULL, NULL);
+	if (width > TILE_SIZE || height > TILE_SIZE) {
+		png_destroy_read_struct(&png_ptr, NULL, NULL);
+		return NULL;
+	}
+	format = formatFromFlags(flags);
+	indexed = color_type == PNG_COLOR_TYPE_PALETTE && !(flags & IMAGE_EXPAND_PALETTE) &&
+		(format == GU_PSM_8888 || pixelFormatIndexed(format));
+	if (indexed) {
+		png_get_PLTE(png_ptr, info_ptr, &colors, &colorCount);
+		if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) png_get_tRNS(png_ptr, info_ptr, &alphas, &alphaCount, NULL);
+		format = colorCount <= 16 && format != GU_PSM_T8 ? GU_PSM_T4 : GU_PSM_T8;
+	} else if (pixelFormatIndexed(format)) {
+		format = GU_PSM_8888;
+	}
+	image = allocateImage(width, height, format, flags);
+	if (!image) {
+		png_destroy_read_struct(&png_ptr, NULL, NULL);
+		return NULL;
+	}
+	if (indexed) {
+		memset(image->palette, 0, image->paletteEntries * sizeof(Color));
+		for (i = 0; i < colorCount; i++) {
+			u32 alpha = i < alphaCount ? alphas[i] : 0xff;
+			image->palette[i] = colors[i].red | (colors[i].green << 8) | (colors[i].blue << 16) | (alpha << 24);
+		}
+	}
+	rowBytes = rowBytesOf(image);
+	lineBytes = (width * pixelFormatBits(image->format) + 7) / 8;
+	png_set_strip_16(png_ptr);
+	png_set_packing(png_ptr);
+	if (!indexed) {
+		if (color_type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png_ptr);
+		//if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) png_set_gray_1_2_4_to_8(png_ptr);
+		if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) png_set_tRNS_to_alpha(png_ptr);
+		png_set_filler(png_ptr, 0xff, PNG_FILLER_AFTER);
+	}
+	// padding is zeroed as well, cooked textures must not depend on what the memory held before
+	if (indexed || lineBytes < rowBytes || rowsOf(image) > (int) height) memset(image->data, 0, rowBytes * rowsOf(image));
+	// 8888 rows are converted in place, 16-bit pixels take the first half of the line,
+	// indices are unpacked to one byte each by libpng and packed again in place
+	line = (u32*) malloc(width * 4);
+	if (!line) {
+		discardImage(image);
+		png_destroy_read_struct(&png_ptr, NULL, NULL);
+		return NULL;
+	}
+	for (y = 0; y < height; y++) {
+		png_read_row(png_ptr, (u8*) line, NULL);
+		row = (u8*) line;
+		if (image->format == GU_PSM_T4) {
+			// the GE reads the even pixel from the low nibble
+			for (x = 0; x < width; x += 2) row[x / 2] = row[x] | (x + 1 < width ? row[x + 1] << 4 : 0);
+		} else if (!indexed && image->format != GU_PSM_8888) {
+			convertRow(row, line, width, image->format, flags & IMAGE_DITHER, y);
+		}
+		storeRow(image, y, row, lineBytes);
+	}
+	free(line);
+	png_read_end(png_ptr, info_ptr);
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	return image;
+}
+
+static png_structp createReadStruct()
+{
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (png_ptr) png_set_error_fn(png_ptr, (png_voidp) NULL, (png_error_ptr) NULL, user_warning_fn);
+	return png_ptr;
+}
+
+Image* loadImageEx(const char* filename, int flags)
+{
+	png_structp png_ptr;
+	Image* image;
 	FILE *fp;
-	Image* image = (Image*) malloc(sizeof(Image));
-	if (!image) return NULL;
+	PROFILE_SCOPE("load");
 
 	if ((fp = fopen(filename, "rb")) == NULL) return NULL;
+	png_ptr = createReadStruct();
+	if (png_ptr == NULL) {
+		fclose(fp);
+		return NULL;
+	}
+	png_init_io(png_ptr, fp);
+	image = readPng(png_ptr, flags);
+	fclose(fp);
+	return image;
+}
+
+/* A pack entry in memory, read by libpng through readEntryData(). */
+typedef struct
+{
+	const u8* data;
+	png_size_t size;
+	png_size_t position;
+} EntrySource;
+
+static void readEntryData(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	EntrySource* source = (EntrySource*) png_get_io_ptr(png_ptr);
+	if (length > source->size - source->position) png_error(png_ptr, "read past the end of the pack entry");
+	memcpy(data, source->data + source->position, length);
+	source->position += length;
+}
+
+Image* loadImageFromPack(Pack* pack, const char* name, int flags)
+{
+	png_structp png_ptr;
+	EntrySource source;
+	Image* image;
+	int size;
+	PROFILE_SCOPE("load");
+
+	// one read of the whole entry, libpng then takes its many small reads from memory
+	source.data = (const u8*) loadPackEntry(pack, name, &size);
+	if (!source.data) return NULL;
+	source.size = size;
+	source.position = 0;
+	// other entries are refused up front, libpng has no way to return its errors here
+	png_ptr = size >= 8 && png_sig_cmp((png_bytep) source.data, 0, 8) == 0 ? createReadStruct() : NULL;
+	if (png_ptr == NULL) {
+		free((void*) source.data);
+		return NULL;
+	}
+	png_set_read_fn(png_ptr, &source, readEntryData);
+	image = readPng(png_ptr, flags);
+	free((void*) source.data);
+	return image;
+}
+
+TiledImage* loadTiledImage(const char* filename)
+{
+	return loadTiledImageEx(filename, 0);
+}
+
+/* Whether a color keeps any alpha once stored in a format, formats without alpha are never transparent. */
+static int isVisible(Color color, int format)
+{
+	if (format == GU_PSM_8888) return color >> 24 != 0;
+	return pixelToColor(colorToPixel(color, format), format) >> 24 != 0;
+}
+
+TiledImage* loadTiledImageEx(const char* filename, int flags)
+{
+	png_structp png_ptr;
+	png_infop info_ptr;
+	png_uint_32 width, height;
+	int bit_depth, color_type, interlace_type;
+	int format, tileFlags, row, column, x, y;
+	int* visible;
+	u32* line;
+	FILE *fp;
+	TiledImage* tiled = (TiledImage*) malloc(sizeof(TiledImage));
+	if (!tiled) return NULL;
+
+	if ((fp = fopen(filename, "rb")) == NULL) {
+		free(tiled);
+		return NULL;
+	}
 	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (png_ptr == NULL) {
-		free(image);
+		free(tiled);
 		fclose(fp);
-		return NULL;;
+		return NULL;
 	}
 	png_set_error_fn(png_ptr, (png_voidp) NULL, (png_error_ptr) NULL, user_warning_fn);
 	info_ptr = png_create_info_struct(png_ptr);
 	if (info_ptr == NULL) {
-		free(image);
+		free(tiled);
 		fclose(fp);
 		png_destroy_read_struct(&png_ptr, (png_infopp)NULL, (png_infopp)NULL);
 		return NULL;
 	}
 	png_init_io(png_ptr, fp);
-	png_set_sig_bytes(png_ptr, sig_read);
 	png_read_info(png_ptr, info_ptr);
 	png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth, &color_type, &interlace_type, NULL, NULL);
-	if (width > 512 || height > 512) {
-		free(image);
-		fclose(fp);
-		png_destroy_read_struct(&png_ptr, NULL, NULL);
-		return NULL;
-	}
-	image->imageWidth = width;
-	image->imageHeight = height;
-	image->textureWidth = getNextPower2(width);
-	image->textureHeight = getNextPower2(height);
 	png_set_strip_16(png_ptr);
 	png_set_packing(png_ptr);
 	if (color_type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png_ptr);
-	//if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) png_set_gray_1_2_4_to_8(png_ptr);
 	if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) png_set_tRNS_to_alpha(png_ptr);
 	png_set_filler(png_ptr, 0xff, PNG_FILLER_AFTER);
-	image->data = (Color*) memalign(16, image->textureWidth * image->textureHeight * sizeof(Color));
-	if (!image->data) {
-		free(image);
-		fclose(fp);
-		png_destroy_read_struct(&png_ptr, NULL, NULL);
-		return NULL;
-	}
+
+	// tiles keep direct colors, palettes of large images are expanded
+	format = formatFromFlags(flags);
+	if (pixelFormatIndexed(format)) format = GU_PSM_8888;
+	tileFlags = (flags & IMAGE_SWIZZLE) | (format == GU_PSM_8888 ? IMAGE_FORMAT_8888 : flags & IMAGE_FORMAT_MASK);
+	tiled->imageWidth = width;
+	tiled->imageHeight = height;
+	tiled->columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tiled->rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+	tiled->tiles = (Image**) calloc(tiled->columns * tiled->rows, sizeof(Image*));
 	line = (u32*) malloc(width * 4);
-	if (!line) {
-		free(image->data);
-		free(image);
-		fclose(fp);
-		png_destroy_read_struct(&png_ptr, NULL, NULL);
-		return NULL;
-	}
-	for (y = 0; y < height; y++) {
-		png_read_row(png_ptr, (u8*) line, NULL);
-		for (x = 0; x < width; x++) {
-			u32 color = line[x];
-			image->data[x + y * image->textureWidth] =  color;
+	visible = (int*) malloc(tiled->columns * sizeof(int));
+	if (!tiled->tiles || !line || !visible) goto error;
+
+	// decode one band of tile rows at a time, tiles that stay fully transparent are freed right away
+	for (row = 0; row < tiled->rows; row++) {
+		int top = row * TILE_SIZE;
+		int bandHeight = MIN(TILE_SIZE, (int) height - top);
+		for (column = 0; column < tiled->columns; column++) {
+			int tileWidth = MIN(TILE_SIZE, (int) width - column * TILE_SIZE);
+			Image* tile = createImageEx(tileWidth, bandHeight, tileFlags);
+			if (!tile) goto error;
+			tiled->tiles[row * tiled->columns + column] = tile;
+			visible[column] = 0;
+		}
+		for (y = 0; y < bandHeight; y++) {
+			png_read_row(png_ptr, (u8*) line, NULL);
+			for (column = 0; column < tiled->columns; column++) {
+				Image* tile = tiled->tiles[row * tiled->columns + column];
+				u32* segment = line + column * TILE_SIZE;
+				if (!visible[column]) {
+					for (x = 0; x < tile->imageWidth; x++) {
+						if (isVisible(segment[x], format)) {
+							visible[column] = 1;
+							break;
+						}
+					}
+				}
+				// a converted segment only overwrites its own part of the line
+				if (format != GU_PSM_8888) convertRow(segment, segment, tile->imageWidth, format, flags & IMAGE_DITHER, y);
+				storeRow(tile, y, (u8*) segment, tile->imageWidth * pixelFormatBytes(format));
+			}
+		}
+		for (column = 0; column < tiled->columns; column++) {
+			if (visible[column]) continue;
+			freeImage(tiled->tiles[row * tiled->columns + column]);
+			tiled->tiles[row * tiled->columns + column] = NULL;
 		}
 	}
+	free(visible);
 	free(line);
 	png_read_end(png_ptr, info_ptr);
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 	fclose(fp);
-	return image;
+	return tiled;
+
+error:
+	free(visible);
+	free(line);
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	fclose(fp);
+	if (tiled->tiles) freeTiledImage(tiled);
+	else free(tiled);
+	return NULL;
+}
+
+void freeTiledImage(TiledImage* tiled)
+{
+	int i;
+	for (i = 0; i < tiled->columns * tiled->rows; i++) {
+		if (tiled->tiles[i]) freeImage(tiled->tiles[i]);
+	}
+	free(tiled->tiles);
+	free(tiled);
+}
+
+/* Open the list and describe the texture of a draw of source, the caller sets the primitive. */
+static void beginTexturedDraw(BatchState* state, Image* source, int opaque, const Color* palette)
+{
+	if (palette) writebackRange(palette, source->paletteEntries * sizeof(Color));
+	beginDraw();
+	memset(state, 0, sizeof(BatchState));
+	state->texture = textureData(source);
+	state->textureWidth = source->textureWidth;
+	state->textureHeight = source->textureHeight;
+	state->textureStride = source->stride;
+	state->format = source->format;
+	state->swizzle = source->swizzled;
+	state->clut = palette;
+	state->clutEntries = source->paletteEntries;
+	state->opaque = opaque;
+}
+
+/* Record a textured sprite of an image, sliced into 64 pixel columns for the texture cache. */
+static void drawImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, int opaque, const Color* palette)
+{
+	BatchState state;
+
+	if (!needsDraw(dx, dy, dx + width, dy + height)) return;
+	beginTexturedDraw(&state, source, opaque, palette);
+	state.prim = GU_SPRITES;
+	state.vertexType = GU_TEXTURE_16BIT | GU_VERTEX_16BIT | GU_TRANSFORM_2D;
+	state.vertexSize = sizeof(Vertex);
+
+	int j = 0;
+	while (j < width) {
+		int sliceWidth = 64;
+		if (j + sliceWidth > width) sliceWidth = width - j;
+		Vertex* vertices = (Vertex*) batchVertices(&state, 2, dx + j, dy, dx + j + sliceWidth, dy + height);
+		vertices[0].u = sx + j;
+		vertices[0].v = sy;
+		vertices[0].x = dx + j;
+		vertices[0].y = dy;
+		vertices[0].z = 0;
+		vertices[1].u = sx + j + sliceWidth;
+		vertices[1].v = sy + height;
+		vertices[1].x = dx + j + sliceWidth;
+		vertices[1].y = dy + height;
+		vertices[1].z = 0;
+		j += sliceWidth;
+	}
+}
+
+/* Clip a rectangle of a tiled image to the screen and record a sprite for each tile it covers. */
+static void drawTiledImage(int sx, int sy, int width, int height, TiledImage* source, int dx, int dy, int opaque)
+{
+	int row, column;
+	if (dx < 0) { sx -= dx; width += dx; dx = 0; }
+	if (dy < 0) { sy -= dy; height += dy; dy = 0; }
+	width = MIN(width, SCREEN_WIDTH - dx);
+	height = MIN(height, SCREEN_HEIGHT - dy);
+	if (width <= 0 || height <= 0) return;
+	for (row = sy / TILE_SIZE; row * TILE_SIZE < sy + height; row++) {
+		for (column = sx / TILE_SIZE; column * TILE_SIZE < sx + width; column++) {
+			Image* tile = source->tiles[row * source->columns + column];
+			int tileX = column * TILE_SIZE;
+			int tileY = row * TILE_SIZE;
+			int x0, y0, x1, y1;
+			if (!tile) continue;
+			x0 = MAX(sx, tileX);
+			y0 = MAX(sy, tileY);
+			x1 = MIN(sx + width, tileX + tile->imageWidth);
+			y1 = MIN(sy + height, tileY + tile->imageHeight);
+			drawImage(x0 - tileX, y0 - tileY, x1 - x0, y1 - y0, tile, dx + x0 - sx, dy + y0 - sy, opaque, NULL);
+		}
+	}
+}
+
+void blitImageToImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination)
+{
+	int x, y;
+	markDirty(destination, dy, dy + height);
+	if (!sameEncoding(source, destination)) {
+		if (source->format == GU_PSM_8888 && !destination->palette && !source->swizzled && !destination->swizzled) {
+			for (y = 0; y < height; y++) {
+				convertRow(pixelAddress(destination, dx, dy + y), (const u32*) pixelAddress(source, sx, sy + y),
+					width, destination->format, 0, 0);
+			}
+			return;
+		}
+		for (y = 0; y < height; y++) {
+			for (x = 0; x < width; x++) writePixel(destination, dx + x, dy + y, readPixel(source, sx + x, sy + y));
+		}
+		return;
+	}
+	if (source->swizzled || destination->swizzled || (source->format == GU_PSM_T4 && ((sx | dx | width) & 1))) {
+		for (y = 0; y < height; y++) {
+			for (x = 0; x < width; x++) plotPixel(destination, dx + x, dy + y, fetchPixel(source, sx + x, sy + y));
+		}
+		return;
+	}
+	int bytes = width * pixelFormatBits(source->format) / 8;
+	for (y = 0; y < height; y++) {
+		memcpy(pixelAddress(destination, dx, dy + y), pixelAddress(source, sx, sy + y), bytes);
+	}
+}
+
+void blitImageToScreen(int sx, int sy, int width, int height, Image* source, int dx, int dy)
+{
+	if (!initialized) return;
+	if (source->swizzled || source->format != screenFormat) {
+		// a copy would keep the block layout or pixel format, the texture unit has to convert it
+		drawImage(sx, sy, width, height, source, dx, dy, 1, source->palette);
+		return;
+	}
+	if (!needsDraw(dx, dy, dx + width, dy + height)) return;
+	u8* vram = drawBuffer();
+	beginDraw();
+	void* data = textureData(source);
+	batchFlush();
+	if (damageTracking) {
+		// copies ignore the scissor, only the damaged parts are copied
+		int i;
+		for (i = 0; i < redraw.count; i++) {
+			const DamageRect* rect = &redraw.rects[i];
+			int x0 = MAX(dx, rect->x0);
+			int y0 = MAX(dy, rect->y0);
+			int x1 = MIN(dx + width, rect->x1);
+			int y1 = MIN(dy + height, rect->y1);
+			if (x0 >= x1 || y0 >= y1) continue;
+			sceGuCopyImage(screenFormat, sx + x0 - dx, sy + y0 - dy, x1 - x0, y1 - y0, source->stride, data,
+				x0, y0, PSP_LINE_SIZE, vram);
+		}
+		return;
+	}
+	sceGuCopyImage(screenFormat, sx, sy, width, height, source->stride, data, dx, dy, PSP_LINE_SIZE, vram);
+}
+
+/* Blend a rectangle of an image over another, linear 8888 rows go through the row kernels. */
+static void blendImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination, int premultiplied)
+{
+	int x, y;
+	markDirty(destination, dy, dy + height);
+	if (source->swizzled || destination->swizzled || source->format != GU_PSM_8888 || destination->format != GU_PSM_8888) {
+		for (y = 0; y < height; y++) {
+			for (x = 0; x < width; x++) {
+				Color color = readPixel(source, sx + x, sy + y);
+				if (!premultiplied && A(color) == 0) continue;
+				Color below = readPixel(destination, dx + x, dy + y);
+				writePixel(destination, dx + x, dy + y, premultiplied ? blendColorPremultiplied(below, color) : blendColor(below, color));
+			}
+		}
+		return;
+	}
+	for (y = 0; y < height; y++) {
+		Color* out = (Color*) pixelAddress(destination, dx, dy + y);
+		const Color* in = (const Color*) pixelAddress(source, sx, sy + y);
+		if (premultiplied) blendRowPremultiplied(out, in, width);
+		else blendRow(out, in, width);
+	}
+}
+
+void blitAlphaImageToImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination)
+{
+	blendImage(sx, sy, width, height, source, dx, dy, destination, 0);
+}
+
+void blitPremultipliedImageToImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination)
+{
+	blendImage(sx, sy, width, height, source, dx, dy, destination, 1);
 }
 
-void blitImageToImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination)
+void blitAlphaImageToScreen(int sx, int sy, int width, int height, Image* source, int dx, int dy)
 {
-	Color* destinationData = &destination->data[destination->textureWidth * dy + dx];
-	int destinationSkipX = destination->textureWidth - width;
-	Color* sourceData = &source->data[source->textureWidth * sy + sx];
-	int sourceSkipX = source->textureWidth - width;
-	int x, y;
-	for (y = 0; y < height; y++, destinationData += destinationSkipX, sourceData += sourceSkipX) {
-		for (x = 0; x < width; x++, destinationData++, sourceData++) {
-			*destinationData = *sourceData;
-		}
-	}
+	if (!initialized) return;
+	drawImage(sx, sy, width, height, source, dx, dy, 0, source->palette);
 }
 
-void blitImageToScreen(int sx, int sy, int width, int height, Image* source, int dx, int dy)
+void blitTiledImageToScreen(int sx, int sy, int width, int height, TiledImage* source, int dx, int dy)
 {
 	if (!initialized) return;
-	Color* vram = getVramDrawBuffer();
-	sceKernelDcacheWritebackInvalidateAll();
-	guStart();
-	sceGuCopyImage(GU_PSM_8888, sx, sy, width, height, source->textureWidth, source->data, dx, dy, PSP_LINE_SIZE, vram);
-	sceGuFinish();
-	sceGuSync(0,0);
+	drawTiledImage(sx, sy, width, height, source, dx, dy, 1);
 }
 
-void blitAlphaImageToImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination)
+void blitAlphaTiledImageToScreen(int sx, int sy, int width, int height, TiledImage* source, int dx, int dy)
 {
-	// TODO Blend!
-	Color* destinationData = &destination->data[destination->textureWidth * dy + dx];
-	int destinationSkipX = destination->textureWidth - width;
-	Color* sourceData = &source->data[source->textureWidth * sy + sx];
-	int sourceSkipX = source->textureWidth - width;
-	int x, y;
-	for (y = 0; y < height; y++, destinationData += destinationSkipX, sourceData += sourceSkipX) {
-		for (x = 0; x < width; x++, destinationData++, sourceData++) {
-			Color color = *sourceData;
-			if (!IS_ALPHA(color)) *destinationData = color;
-		}
-	}
+	if (!initialized) return;
+	drawTiledImage(sx, sy, width, height, source, dx, dy, 0);
 }
 
-void blitAlphaImageToScreen(int sx, int sy, int width, int height, Image* source, int dx, int dy)
+void blitPaletteImageToScreen(int sx, int sy, int width, int height, Image* source, int dx, int dy, const Color* palette)
 {
 	if (!initialized) return;
+	drawImage(sx, sy, width, height, source, dx, dy, 0, palette);
+}
 
-	sceKernelDcacheWritebackInvalidateAll();
-	guStart();
-	sceGuTexImage(0, source->textureWidth, source->textureHeight, source->textureWidth, (void*) source->data);
-	float u = 1.0f / ((float)source->textureWidth);
-	float v = 1.0f / ((float)source->textureHeight);
-	sceGuTexScale(u, v);
-	
-	int j = 0;
-	while (j < width) {
-		Vertex* vertices = (Vertex*) sceGuGetMemory(2 * sizeof(Vertex));
-		int sliceWidth = 64;
-		if (j + sliceWidth > width) sliceWidth = width - j;
-		vertices[0].u = sx + j;
-		vertices[0].v = sy;
-		vertices[0].x = dx + j;
-		vertices[0].y = dy;
-		vertices[0].z = 0;
-		vertices[1].u = sx + j + sliceWidth;
-		vertices[1].v = sy + height;
-		vertices[1].x = dx + j + sliceWidth;
-		vertices[1].y = dy + height;
-		vertices[1].z = 0;
-		sceGuDrawArray(GU_SPRITES, GU_TEXTURE_16BIT | GU_VERTEX_16BIT | GU_TRANSFORM_2D, 2, 0, vertices);
-		j += sliceWidth;
+void drawSpriteScreen(int sx, int sy, int width, int height, Image* source, const SpriteTransform* transform)
+{
+	static const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+	float corners[16];
+	float left, top, right, bottom;
+	BatchState state;
+	SpriteVertex* vertices;
+	int i, x0, y0, x1, y1;
+
+	if (!initialized) return;
+	transformSprite(corners, transform, width, height);
+	left = right = corners[0];
+	top = bottom = corners[1];
+	for (i = 1; i < 4; i++) {
+		left = MIN(left, corners[4 * i]);
+		right = MAX(right, corners[4 * i]);
+		top = MIN(top, corners[4 * i + 1]);
+		bottom = MAX(bottom, corners[4 * i + 1]);
+	}
+	x0 = MAX((int) floorf(left), 0);
+	y0 = MAX((int) floorf(top), 0);
+	x1 = MIN((int) ceilf(right), SCREEN_WIDTH);
+	y1 = MIN((int) ceilf(bottom), SCREEN_HEIGHT);
+	if (x0 >= x1 || y0 >= y1 || !needsDraw(x0, y0, x1, y1)) return;
+
+	// two triangles through the projection set up by initGraphics(), batched like sprites
+	beginTexturedDraw(&state, source, 0, source->palette);
+	state.prim = GU_TRIANGLES;
+	state.vertexType = GU_TEXTURE_32BITF | GU_COLOR_8888 | GU_VERTEX_32BITF | GU_TRANSFORM_3D;
+	state.vertexSize = sizeof(SpriteVertex);
+	state.modulate = 1;
+	vertices = (SpriteVertex*) batchVertices(&state, 6, x0, y0, x1, y1);
+	for (i = 0; i < 6; i++) {
+		int corner = quad[i];
+		vertices[i].u = sx + ((corner == 1 || corner == 2) ? width : 0);
+		vertices[i].v = sy + (corner >= 2 ? height : 0);
+		vertices[i].color = transform->color;
+		vertices[i].x = corners[4 * corner];
+		vertices[i].y = corners[4 * corner + 1];
+		vertices[i].z = 0.0f;
 	}
-	
-	sceGuFinish();
-	sceGuSync(0, 0);
 }
 
 Image* createImage(int width, int height)
 {
-	Image* image = (Image*) malloc(sizeof(Image));
+	return createImageEx(width, height, 0);
+}
+
+Image* createImageEx(int width, int height, int flags)
+{
+	Image* image = allocateImage(width, height, formatFromFlags(flags), flags);
 	if (!image) return NULL;
-	image->imageWidth = width;
-	image->imageHeight = height;
-	image->textureWidth = getNextPower2(width);
-	image->textureHeight = getNextPower2(height);
-	image->data = (Color*) memalign(16, image->textureWidth * image->textureHeight * sizeof(Color));
-	if (!image->data) return NULL;
-	memset(image->data, 0, image->textureWidth * image->textureHeight * sizeof(Color));
+	if (image->palette) memset(image->palette, 0, image->paletteEntries * sizeof(Color));
+	memset(image->data, 0, rowBytesOf(image) * rowsOf(image));
 	return image;
 }
 
+void markImageDirty(Image* image, int y, int height)
+{
+	markDirty(image, y, y + height);
+}
+
 void freeImage(Image* image)
 {
-	free(image->data);
-	free(image);
+	textureCacheRemove(&textureCache, image);
+	discardImage(image);
 }
 
-void clearImage(Color color, Image* image)
+void resetImageArena(ImageArena* arena)
 {
 	int i;
-	int size = image->textureWidth * image->textureHeight;
-	Color* data = image->data;
-	for (i = 0; i < size; i++, data++) *data = color;
+	for (i = 0; i < arena->imageCount; i++) {
+		Image* image = (Image*) arena->images[i];
+		textureCacheRemove(&textureCache, image);
+		countImage(image, -1);
+	}
+	clearImageArena(arena);
+}
+
+void clearImage(Color color, Image* image)
+{
+	markDirty(image, 0, rowsOf(image));
+	if (image->palette) {
+		u32 index = nearestIndex(image, color);
+		memset(image->data, image->format == GU_PSM_T4 ? index | (index << 4) : index, rowBytesOf(image) * rowsOf(image));
+		return;
+	}
+	fillRow(image->data, image->stride * rowsOf(image), pixelFormatBytes(image->format), colorToPixel(color, image->format));
 }
 
 void clearScreen(Color color)
 {
 	if (!initialized) return;
-	guStart();
+	if (!needsDraw(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT)) return;
+	beginDraw();
+	batchFlush();
+	sceGuClearColor(color);
 	sceGuClearDepth(0);
+	if (damageTracking) {
+		int i;
+		for (i = 0; i < redraw.count; i++) {
+			const DamageRect* rect = &redraw.rects[i];
+			sceGuScissor(rect->x0, rect->y0, rect->x1, rect->y1);
+			sceGuClear(GU_COLOR_BUFFER_BIT|GU_DEPTH_BUFFER_BIT);
+		}
+		sceGuScissor(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+		return;
+	}
 	sceGuClear(GU_COLOR_BUFFER_BIT|GU_DEPTH_BUFFER_BIT);
-	sceGuFinish();
-	sceGuSync(0, 0);
+}
+
+/* Record an untextured sprite, written to the screen like a CPU fill without blending. */
+static void drawRect(Color color, int x0, int y0, int x1, int y1)
+{
+	BatchState state;
+	ColorVertex* vertices;
+
+	if (!needsDraw(x0, y0, x1, y1)) return;
+	beginDraw();
+	memset(&state, 0, sizeof(state));
+	state.prim = GU_SPRITES;
+	state.vertexType = GU_COLOR_8888 | GU_VERTEX_16BIT | GU_TRANSFORM_2D;
+	state.vertexSize = sizeof(ColorVertex);
+	state.opaque = 1;
+	vertices = (ColorVertex*) batchVertices(&state, 2, x0, y0, x1, y1);
+	vertices[0].color = color;
+	vertices[0].x = x0;
+	vertices[0].y = y0;
+	vertices[0].z = 0;
+	vertices[1].color = color;
+	vertices[1].x = x1;
+	vertices[1].y = y1;
+	vertices[1].z = 0;
 }
 
 void fillImageRect(Color color, int x0, int y0, int width, int height, Image* image)
 {
-	int skipX = image->textureWidth - width;
 	int x, y;
-	Color* data = image->data + x0 + y0 * image->textureWidth;
-	for (y = 0; y < height; y++, data += skipX) {
-		for (x = 0; x < width; x++, data++) *data = color;
+	int bytes = pixelFormatBytes(image->format);
+	u32 pixel = imagePixel(image, color);
+	markDirty(image, y0, y0 + height);
+	if (image->swizzled || image->palette) {
+		for (y = 0; y < height; y++) {
+			for (x = 0; x < width; x++) plotPixel(image, x0 + x, y0 + y, pixel);
+		}
+		return;
 	}
+	for (y = 0; y < height; y++) fillRow(pixelAddress(image, x0, y0 + y), width, bytes, pixel);
 }
 
 void fillScreenRect(Color color, int x0, int y0, int width, int height)
 {
 	if (!initialized) return;
-	int skipX = PSP_LINE_SIZE - width;
-	int x, y;
-	Color* data = getVramDrawBuffer() + x0 + y0 * PSP_LINE_SIZE;
-	for (y = 0; y < height; y++, data += skipX) {
-		for (x = 0; x < width; x++, data++) *data = color;
+	drawRect(color, x0, y0, x0 + width, y0 + height);
+}
+
+void drawRectScreen(Color color, int x0, int y0, int width, int height)
+{
+	if (!initialized) return;
+	if (width <= 2 || height <= 2) {
+		drawRect(color, x0, y0, x0 + width, y0 + height);
+		return;
 	}
+	drawRect(color, x0, y0, x0 + width, y0 + 1);
+	drawRect(color, x0, y0 + height - 1, x0 + width, y0 + height);
+	drawRect(color, x0, y0 + 1, x0 + 1, y0 + height - 1);
+	drawRect(color, x0 + width - 1, y0 + 1, x0 + width, y0 + height - 1);
 }
 
 void putPixelScreen(Color color, int x, int y)
 {
-	Color* vram = getVramDrawBuffer();
-	vram[PSP_LINE_SIZE * y + x] = color;
+	finishDraw();
+	storePixel(screenAddress(x, y), pixelFormatBytes(screenFormat), colorToPixel(color, screenFormat));
 }
 
 void putPixelImage(Color color, int x, int y, Image* image)
 {
-	image->data[x + y * image->textureWidth] = color;
+	markDirty(image, y, y + 1);
+	writePixel(image, x, y, color);
 }
 
 Color getPixelScreen(int x, int y)
 {
-	Color* vram = getVramDrawBuffer();
-	return vram[PSP_LINE_SIZE * y + x];
+	finishDraw();
+	return pixelToColor(loadPixel(screenAddress(x, y), pixelFormatBytes(screenFormat)), screenFormat);
 }
 
 Color getPixelImage(int x, int y, Image* image)
 {
-	return image->data[x + y * image->textureWidth];
+	return readPixel(image, x, y);
 }
 
-void printTextScreen(int x, int y, const char* text, u32 color)
+/* Draw the msx font into the glyph atlas, 16 glyphs per row. */
+static void bakeGlyphAtlas()
 {
-	int c, i, j, l;
-	u8 *font;
-	Color *vram_ptr;
-	Color *vram;
-	
-	if (!initialized) return;
-
-	for (c = 0; c < strlen(text); c++) {
-		if (x < 0 || x + 8 > SCREEN_WIDTH || y < 0 || y + 8 > SCREEN_HEIGHT) break;
-		char ch = text[c];
-		vram = getVramDrawBuffer() + x + y * PSP_LINE_SIZE;
-		
-		font = &msx[ (int)ch * 8];
-		for (i = l = 0; i < 8; i++, l += 8, font++) {
-			vram_ptr  = vram;
-			for (j = 0; j < 8; j++) {
-				if ((*font & (128 >> j))) *vram_ptr = color;
-				vram_ptr++;
-			}
-			vram += PSP_LINE_SIZE;
+	int c, i, j;
+	int size = GLYPH_ATLAS_COLUMNS * GLYPH_SIZE;
+	if (!glyphAtlas) glyphAtlas = createImageEx(size, 256 / GLYPH_ATLAS_COLUMNS * GLYPH_SIZE, IMAGE_FORMAT_T4 | IMAGE_SWIZZLE);
+	if (!glyphAtlas) return;
+	glyphAtlas->palette[1] = 0xffffffff;
+	writebackRange(glyphAtlas->palette, glyphAtlas->paletteEntries * sizeof(Color));
+	for (c = 0; c < 256; c++) {
+		int x = (c % GLYPH_ATLAS_COLUMNS) * GLYPH_SIZE;
+		int y = (c / GLYPH_ATLAS_COLUMNS) * GLYPH_SIZE;
+		const u8* font = &msx[c * 8];
+		for (i = 0; i < GLYPH_SIZE; i++) {
+			for (j = 0; j < GLYPH_SIZE; j++) plotPixel(glyphAtlas, x + j, y + i, (font[i] & (128 >> j)) ? 1 : 0);
 		}
-		x += 8;
 	}
+	markDirty(glyphAtlas, 0, rowsOf(glyphAtlas));
+	textCacheInit(&textCache);
+}
+
+const TextCacheStats* getTextCacheStats()
+{
+	return &textCache.stats;
+}
+
+void printTextScreen(int x, int y, const char* text, u32 color)
+{
+	BatchState state;
+	TextVertex* vertices;
+	const TextVertex* layout;
+	int length = strlen(text);
+
+	if (!initialized || !glyphAtlas || length == 0) return;
+	if (!needsDraw(x, y, x + length * GLYPH_SIZE, y + GLYPH_SIZE)) return;
+	beginDraw();
+	memset(&state, 0, sizeof(state));
+	state.prim = GU_SPRITES;
+	state.vertexType = GU_TEXTURE_16BIT | GU_COLOR_8888 | GU_VERTEX_16BIT | GU_TRANSFORM_2D;
+	state.vertexSize = sizeof(TextVertex);
+	state.texture = textureData(glyphAtlas);
+	state.textureWidth = glyphAtlas->textureWidth;
+	state.textureHeight = glyphAtlas->textureHeight;
+	state.textureStride = glyphAtlas->stride;
+	state.format = glyphAtlas->format;
+	state.swizzle = glyphAtlas->swizzled;
+	state.clut = glyphAtlas->palette;
+	state.clutEntries = glyphAtlas->paletteEntries;
+	state.modulate = 1;
+
+	// one primitive per string, all text of a frame usually ends up in a single draw call
+	vertices = (TextVertex*) batchVertices(&state, length * 2, x, y, x + length * GLYPH_SIZE, y + GLYPH_SIZE);
+	layout = textCacheLayout(&textCache, text, length, x, y, color);
+	if (layout) memcpy(vertices, layout, length * 2 * sizeof(TextVertex));
+	else layoutText(vertices, text, length, x, y, color);
 }
 
 void printTextImage(int x, int y, const char* text, u32 color, Image* image)
 {
 	int c, i, j, l;
 	u8 *font;
-	Color *data_ptr;
-	Color *data;
+	u32 pixel = imagePixel(image, color);
+	int length = strlen(text);
 	
 	if (!initialized) return;
 
-	for (c = 0; c < strlen(text); c++) {
+	for (c = 0; c < length; c++) {
 		if (x < 0 || x + 8 > image->imageWidth || y < 0 || y + 8 > image->imageHeight) break;
 		char ch = text[c];
-		data = image->data + x + y * image->textureWidth;
+		markDirty(image, y, y + 8);
 		
-		font = &msx[ (int)ch * 8];
+		font = &msx[(u8) ch * 8];
 		for (i = l = 0; i < 8; i++, l += 8, font++) {
-			data_ptr  = data;
 			for (j = 0; j < 8; j++) {
-				if ((*font & (128 >> j))) *data_ptr = color;
-				data_ptr++;
+				if ((*font & (128 >> j))) plotPixel(image, x + j, y + i, pixel);
 			}
-			data += image->textureWidth;
 		}
 		x += 8;
 	}
 }
 
 void saveImage(const char* filename, Color* data, int width, int height, int lineSize, int saveAlpha)
+{
+	saveImageFormat(filename, data, width, height, lineSize, GU_PSM_8888, saveAlpha);
+}
+
+/*
+ * Write pixel data as a PNG. The fast preset only uses the cheap Sub filter and the
+ * fastest zlib level, which takes a fraction of the time for slightly larger files.
+ */
+static int writePixels(const char* filename, const void* data, int width, int height, int lineSize, int format, int saveAlpha, int fast)
 {
 	png_structp png_ptr;
 	png_infop info_ptr;
 	FILE* fp;
 	int i, x, y;
 	u8* line;
+	int bytes = pixelFormatBytes(format);
 	
-	if ((fp = fopen(filename, "wb")) == NULL) return;
+	if ((fp = fopen(filename, "wb")) == NULL) return 0;
 	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if (!png_ptr) return;
+	if (!png_ptr) {
+		fclose(fp);
+		return 0;
+	}
 	info_ptr = png_create_info_struct(png_ptr);
 	if (!info_ptr) {
 		png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-		return;
+		fclose(fp);
+		return 0;
 	}
 	png_init_io(png_ptr, fp);
+	if (fast) {
+		png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+		png_set_compression_level(png_ptr, 1);
+	}
 	png_set_IHDR(png_ptr, info_ptr, width, height, 8,
 		saveAlpha ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB,
 		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
@@ -362,7 +1441,7 @@ void saveImage(const char* filename, Color* data, int width, int height, int lin
 	line = (u8*) malloc(width * (saveAlpha ? 4 : 3));
 	for (y = 0; y < height; y++) {
 		for (i = 0, x = 0; x < width; x++) {
-			Color color = data[x + y * lineSize];
+			Color color = pixelToColor(loadPixel((const u8*) data + (x + y * lineSize) * bytes, bytes), format);
 			u8 r = color & 0xff; 
 			u8 g = (color >> 8) & 0xff;
 			u8 b = (color >> 16) & 0xff;
@@ -377,17 +1456,362 @@ void saveImage(const char* filename, Color* data, int width, int height, int lin
 	free(line);
 	png_write_end(png_ptr, info_ptr);
 	png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
+	return fclose(fp) == 0;
+}
+
+void saveImageFormat(const char* filename, void* data, int width, int height, int lineSize, int format, int saveAlpha)
+{
+	writePixels(filename, data, width, height, lineSize, format, saveAlpha, 0);
+}
+
+static int captureThread(SceSize args, void* argp)
+{
+	for (;;) {
+		unsigned int start;
+		sceKernelWaitSema(capture.start, 1, NULL);
+		start = sceKernelGetSystemTimeLow();
+		if (writePixels(capture.filename, capture.pixels, SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_WIDTH,
+			screenFormat, capture.saveAlpha, 1)) {
+			capture.stats.encodeMicros = sceKernelGetSystemTimeLow() - start;
+			capture.state = SCREEN_CAPTURE_DONE;
+		} else {
+			capture.stats.failures++;
+			capture.state = SCREEN_CAPTURE_FAILED;
+		}
+	}
+	return 0;
+}
+
+/* Hand a finished screen copy to the encoder thread. */
+static void updateCapture()
+{
+	if (capture.state != SCREEN_CAPTURE_COPYING || !isFrameFenceReached(capture.fence)) return;
+	// the GE wrote around the CPU's cache, lines cached before the copy are stale
+	sceKernelDcacheInvalidateRange(capture.pixels, SCREEN_WIDTH * SCREEN_HEIGHT * pixelFormatBytes(screenFormat));
+	capture.state = SCREEN_CAPTURE_ENCODING;
+	sceKernelSignalSema(capture.start, 1);
+}
+
+int captureScreen(const char* filename, int saveAlpha)
+{
+	unsigned int start;
+	int size = SCREEN_WIDTH * SCREEN_HEIGHT * pixelFormatBytes(screenFormat);
+
+	if (!initialized) return 0;
+	if (capture.state == SCREEN_CAPTURE_COPYING || capture.state == SCREEN_CAPTURE_ENCODING) return 0;
+	if (strlen(filename) >= CAPTURE_FILENAME_SIZE) return 0;
+	start = sceKernelGetSystemTimeLow();
+	if (capture.thread < 0) {
+		capture.start = sceKernelCreateSema("capture_start", 0, 0, 1, NULL);
+		capture.thread = sceKernelCreateThread("capture_encoder", captureThread, CAPTURE_THREAD_PRIORITY,
+			CAPTURE_THREAD_STACK_SIZE, THREAD_ATTR_USER, NULL);
+		if (capture.start < 0 || capture.thread < 0 || sceKernelStartThread(capture.thread, 0, NULL) < 0) {
+			capture.thread = -1;
+			return 0;
+		}
+	}
+	if (!capture.pixels) {
+		capture.pixels = memalign(16, size);
+		if (!capture.pixels) return 0;
+	}
+	strcpy(capture.filename, filename);
+	capture.saveAlpha = saveAlpha;
+
+	// no dirty line of the buffer may be written back over the copy later
+	sceKernelDcacheWritebackInvalidateRange(capture.pixels, size);
+	profileCount(PROFILE_DCACHE_BYTES, size);
+	// the last flipped frame's buffer is not drawn into before this frame's list has run
+	beginDraw();
+	batchFlush();
+	sceGuCopyImage(screenFormat, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, PSP_LINE_SIZE,
+		(u8*) g_vram_base + bufferOffset(frameBufferNumber), 0, 0, SCREEN_WIDTH, capture.pixels);
+	capture.fence = submittedLists + 1;
+	capture.state = SCREEN_CAPTURE_COPYING;
+
+	capture.stats.captures++;
+	capture.stats.callMicros = sceKernelGetSystemTimeLow() - start;
+	if (capture.stats.callMicros > capture.stats.maxCallMicros) capture.stats.maxCallMicros = capture.stats.callMicros;
+	return 1;
+}
+
+int getScreenCaptureState()
+{
+	updateCapture();
+	return capture.state;
+}
+
+const ScreenCaptureStats* getScreenCaptureStats()
+{
+	return &capture.stats;
+}
+
+/* Check a cooked texture header against the layout this build gives such an image. */
+static int validTextureFile(const TexFileHeader* header, Image* image)
+{
+	return image->stride == (int) header->stride &&
+		rowsOf(image) == (int) header->rows &&
+		image->swizzled == (int) header->swizzled &&
+		image->paletteEntries == (int) header->paletteEntries &&
+		rowBytesOf(image) * rowsOf(image) == (int) header->dataSize;
+}
+
+static int readAt(SceUID fd, u32 offset, void* data, int size)
+{
+	if (sceIoLseek(fd, offset, PSP_SEEK_SET) != offset) return 0;
+	return sceIoRead(fd, data, size) == size;
+}
+
+Image* loadTextureFile(const char* filename)
+{
+	TexFileHeader header;
+	Image* image;
+	SceUID fd;
+	PROFILE_SCOPE("load");
+
+	fd = sceIoOpen(filename, PSP_O_RDONLY, 0);
+	if (fd < 0) return NULL;
+	if (sceIoRead(fd, &header, sizeof(header)) != sizeof(header) ||
+		header.magic != TEXFILE_MAGIC || header.version != TEXFILE_VERSION ||
+		header.imageWidth == 0 || header.imageWidth > TILE_SIZE ||
+		header.imageHeight == 0 || header.imageHeight > TILE_SIZE || header.format > GU_PSM_T8) {
+		sceIoClose(fd);
+		return NULL;
+	}
+	image = allocateImage(header.imageWidth, header.imageHeight, header.format, header.swizzled ? IMAGE_SWIZZLE : 0);
+	if (!image) {
+		sceIoClose(fd);
+		return NULL;
+	}
+	// the texels go straight from the file into the image in one read, no conversion left to do
+	if (!validTextureFile(&header, image) ||
+		(image->palette && !readAt(fd, header.paletteOffset, image->palette, image->paletteEntries * sizeof(Color))) ||
+		!readAt(fd, header.dataOffset, image->data, header.dataSize)) {
+		discardImage(image);
+		image = NULL;
+	}
+	sceIoClose(fd);
+	return image;
+}
+
+static int writeAt(SceUID fd, u32 offset, const void* data, int size)
+{
+	if (sceIoLseek(fd, offset, PSP_SEEK_SET) != offset) return 0;
+	return sceIoWrite(fd, data, size) == size;
+}
+
+int saveTextureFile(const char* filename, Image* image)
+{
+	TexFileHeader header;
+	SceUID fd;
+	int paletteBytes = image->paletteEntries * sizeof(Color);
+	int ok;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = TEXFILE_MAGIC;
+	header.version = TEXFILE_VERSION;
+	header.imageWidth = image->imageWidth;
+	header.imageHeight = image->imageHeight;
+	header.stride = image->stride;
+	header.rows = rowsOf(image);
+	header.format = image->format;
+	header.swizzled = image->swizzled;
+	header.paletteEntries = image->paletteEntries;
+	header.paletteOffset = image->palette ? sizeof(header) : 0;
+	header.dataOffset = (sizeof(header) + paletteBytes + TEXFILE_ALIGNMENT - 1) & ~(TEXFILE_ALIGNMENT - 1);
+	header.dataSize = rowBytesOf(image) * rowsOf(image);
+
+	fd = sceIoOpen(filename, PSP_O_WRONLY | PSP_O_CREAT | PSP_O_TRUNC, 0777);
+	if (fd < 0) return 0;
+	ok = writeAt(fd, 0, &header, sizeof(header)) &&
+		(!image->palette || writeAt(fd, header.paletteOffset, image->palette, paletteBytes)) &&
+		writeAt(fd, header.dataOffset, image->data, header.dataSize);
+	return sceIoClose(fd) >= 0 && ok;
+}
+
+void saveImageFile(const char* filename, Image* image, int saveAlpha)
+{
+	png_structp png_ptr;
+	png_infop info_ptr;
+	FILE* fp;
+	int i, x, y;
+	u8* line;
+	int width = image->imageWidth;
+
+	if ((fp = fopen(filename, "wb")) == NULL) return;
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (!png_ptr) return;
+	info_ptr = png_create_info_struct(png_ptr);
+	if (!info_ptr) {
+		png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
+		return;
+	}
+	png_init_io(png_ptr, fp);
+	if (image->palette) {
+		png_color colors[256];
+		png_byte alphas[256];
+		for (i = 0; i < image->paletteEntries; i++) {
+			colors[i].red = R(image->palette[i]);
+			colors[i].green = G(image->palette[i]);
+			colors[i].blue = B(image->palette[i]);
+			alphas[i] = A(image->palette[i]);
+		}
+		png_set_IHDR(png_ptr, info_ptr, width, image->imageHeight, 8, PNG_COLOR_TYPE_PALETTE,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+		png_set_PLTE(png_ptr, info_ptr, colors, image->paletteEntries);
+		if (saveAlpha) png_set_tRNS(png_ptr, info_ptr, alphas, image->paletteEntries, NULL);
+	} else {
+		png_set_IHDR(png_ptr, info_ptr, width, image->imageHeight, 8,
+			saveAlpha ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	}
+	png_write_info(png_ptr, info_ptr);
+	line = (u8*) malloc(width * 4);
+	for (y = 0; y < image->imageHeight; y++) {
+		if (image->palette) {
+			for (x = 0; x < width; x++) line[x] = fetchPixel(image, x, y);
+		} else {
+			for (i = 0, x = 0; x < width; x++) {
+				Color color = readPixel(image, x, y);
+				line[i++] = R(color);
+				line[i++] = G(color);
+				line[i++] = B(color);
+				if (saveAlpha) line[i++] = A(color);
+			}
+		}
+		png_write_row(png_ptr, line);
+	}
+	free(line);
+	png_write_end(png_ptr, info_ptr);
+	png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
 	fclose(fp);
 }
 
+/* Close the timing of the frame ending with this flip. */
+static void recordFrame()
+{
+	unsigned int now = sceKernelGetSystemTimeLow();
+	unsigned int total = now - frameStart;
+	unsigned int waits = frameTiming.geWaitMicros + vblankWaitMicros;
+	frameTiming.cpuMicros = total > waits ? total - waits : 0;
+	frameStatsAdd(&frameStats, &frameTiming);
+	profileEndFrame();
+	memset(&frameTiming, 0, sizeof(frameTiming));
+	vblankWaitMicros = 0;
+	frameStart = now;
+}
+
+/* One line of the profiler overlay, a time in milliseconds and its bar, red if longer than a vblank. */
+static void drawProfileTime(int line, const char* name, unsigned int micros)
+{
+	char text[32];
+	int x = PROFILE_OVERLAY_X + 4;
+	int y = PROFILE_OVERLAY_Y + 4 + line * PROFILE_LINE_HEIGHT;
+	int length = micros * PROFILE_BAR_WIDTH / PROFILE_VBLANK_MICROS;
+	snprintf(text, sizeof(text), "%-7.7s%3u.%02u", name, micros / 1000, micros % 1000 / 10);
+	printTextScreen(x, y, text, 0xffffffff);
+	if (length > 0) fillScreenRect(length > PROFILE_BAR_WIDTH ? 0xff0000ff : 0xff00c000, x + PROFILE_BAR_X, y, MIN(length, PROFILE_BAR_WIDTH), GLYPH_SIZE);
+}
+
+static void drawProfileOverlay()
+{
+	const ProfileFrame* frame = profileGetFrame(0);
+	int phases = profilePhaseCount();
+	int height = (phases + 5) * PROFILE_LINE_HEIGHT + 6;
+	int i;
+	char text[48];
+	if (!frame) return;
+	// the screen below is drawn again once the overlay is hidden
+	markScreenDamage(PROFILE_OVERLAY_X, PROFILE_OVERLAY_Y, PROFILE_OVERLAY_WIDTH, height);
+	fillScreenRect(0xff202020, PROFILE_OVERLAY_X, PROFILE_OVERLAY_Y, PROFILE_OVERLAY_WIDTH, height);
+	drawProfileTime(0, "frame", frame->frameMicros);
+	for (i = 0; i < phases; i++) drawProfileTime(i + 1, profilePhaseName(i), frame->phaseMicros[i]);
+	drawProfileTime(phases + 1, "gu sync", frame->counters[PROFILE_GU_SYNC_MICROS]);
+	snprintf(text, sizeof(text), "draws %u verts %u", frame->counters[PROFILE_DRAW_CALLS], frame->counters[PROFILE_VERTICES]);
+	printTextScreen(PROFILE_OVERLAY_X + 4, PROFILE_OVERLAY_Y + 4 + (phases + 2) * PROFILE_LINE_HEIGHT, text, 0xffffffff);
+	snprintf(text, sizeof(text), "binds %u saved %u", frame->counters[PROFILE_TEXTURE_BINDS],
+		frame->counters[PROFILE_BINDS_SAVED]);
+	printTextScreen(PROFILE_OVERLAY_X + 4, PROFILE_OVERLAY_Y + 4 + (phases + 3) * PROFILE_LINE_HEIGHT, text, 0xffffffff);
+	snprintf(text, sizeof(text), "dcache %uK", frame->counters[PROFILE_DCACHE_BYTES] / 1024);
+	printTextScreen(PROFILE_OVERLAY_X + 4, PROFILE_OVERLAY_Y + 4 + (phases + 4) * PROFILE_LINE_HEIGHT, text, 0xffffffff);
+}
+
 void flipScreen()
 {
 	if (!initialized) return;
-	sceGuSwapBuffers();
-	dispBufferNumber ^= 1;
+	if (profileOverlay) drawProfileOverlay();
+	if (damageTracking && redraw.count == 0 && !listOpen) {
+		// every buffer already holds the current screen, the GE has nothing to do
+		if (framePending) {
+			presentFrame();
+		} else {
+			paceFrame();
+		}
+		updateCapture();
+		textureCacheNextFrame(&textureCache);
+		textCacheNextFrame(&textCache);
+		recordFrame();
+		return;
+	}
+	// the previous frame had this whole frame to draw, usually there is nothing left to wait for
+	presentFrame();
+	updateCapture();
+	submitDraw();
+	if (damageTracking) {
+		// the next draw buffer misses this frame's damage, with three buffers also the last one's
+		redraw = frameDamage;
+		if (bufferCount == 3) damageAddSet(&redraw, &lastDamage);
+		lastDamage = frameDamage;
+		damageClear(&frameDamage);
+	}
+	frameFence = submittedLists;
+	framePending = 1;
+	frameBufferNumber = drawBufferNumber;
+	drawBufferNumber = (drawBufferNumber + 1) % bufferCount;
+	textureCacheNextFrame(&textureCache);
+	textCacheNextFrame(&textCache);
+	recordFrame();
+}
+
+void setFramePacing(int mode)
+{
+	int buffers = mode == FRAME_PACING_TRIPLE ? 3 : 2;
+	framePacing = mode;
+	if (!initialized || buffers == bufferCount) return;
+	finishDraw();
+	// let the last swap reach the screen, the new draw buffer must not be shown
+	sceDisplayWaitVblankStart();
+	if (buffers == 3 && !thirdBuffer) {
+		// once needed, the third buffer keeps its VRAM, so leaving triple buffering is cheap
+		thirdBuffer = 1;
+		textureCacheResize(&textureCache, textureStart(), sceGeEdramGetSize() - textureStart());
+	}
+	bufferCount = buffers;
+	drawBufferNumber = dispBufferNumber == 0 ? 1 : 0;
+	// the buffers hold different frames now
+	if (damageTracking) setDamageTracking(1);
+}
+
+int getFramePacing()
+{
+	return framePacing;
+}
+
+void setProfileOverlay(int enabled)
+{
+	profileOverlay = enabled;
+}
+
+int getProfileOverlay()
+{
+	return profileOverlay;
+}
+
+const FrameStats* getFrameStats()
+{
+	return &frameStats;
 }
 
-static void drawLine(int x0, int y0, int x1, int y1, int color, Color* destination, int width)
+static void drawLine(int x0, int y0, int x1, int y1, u32 pixel, void* destination, int width, int bytes)
 {
 	int dy = y1 - y0;
 	int dx = x1 - x0;
@@ -400,7 +1824,7 @@ static void drawLine(int x0, int y0, int x1, int y1, int color, Color* destinati
 	
 	y0 *= width;
 	y1 *= width;
-	destination[x0+y0] = color;
+	storePixel((u8*) destination + (x0+y0) * bytes, bytes, pixel);
 	if (dx > dy) {
 		int fraction = dy - (dx >> 1);
 		while (x0 != x1) {
@@ -410,7 +1834,7 @@ static void drawLine(int x0, int y0, int x1, int y1, int color, Color* destinati
 			}
 			x0 += stepx;
 			fraction += dy;
-			destination[x0+y0] = color;
+			storePixel((u8*) destination + (x0+y0) * bytes, bytes, pixel);
 		}
 	} else {
 		int fraction = dx - (dy >> 1);
@@ -421,19 +1845,127 @@ static void drawLine(int x0, int y0, int x1, int y1, int color, Color* destinati
 			}
 			y0 += stepy;
 			fraction += dx;
-			destination[x0+y0] = color;
+			storePixel((u8*) destination + (x0+y0) * bytes, bytes, pixel);
 		}
 	}
 }
 
+static void setColorVertex(ColorVertex* vertex, Color color, int x, int y)
+{
+	vertex->color = color;
+	vertex->x = x;
+	vertex->y = y;
+	vertex->z = 0;
+}
+
+/* Reserve untextured line vertices, written to the screen like a CPU line without blending. */
+static ColorVertex* lineVertices(int prim, int count, int x0, int y0, int x1, int y1)
+{
+	BatchState state;
+	beginDraw();
+	memset(&state, 0, sizeof(state));
+	state.prim = prim;
+	state.vertexType = GU_COLOR_8888 | GU_VERTEX_16BIT | GU_TRANSFORM_2D;
+	state.vertexSize = sizeof(ColorVertex);
+	state.opaque = 1;
+	return (ColorVertex*) batchVertices(&state, count, x0, y0, x1, y1);
+}
+
 void drawLineScreen(int x0, int y0, int x1, int y1, Color color)
 {
-	drawLine(x0, y0, x1, y1, color, getVramDrawBuffer(), PSP_LINE_SIZE);
+	ColorVertex* vertices;
+	if (!initialized) return;
+	if (!clipLine(&x0, &y0, &x1, &y1, 0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1)) return;
+	if (!needsDraw(MIN(x0, x1), MIN(y0, y1), MAX(x0, x1) + 1, MAX(y0, y1) + 1)) return;
+	vertices = lineVertices(GU_LINES, 2, MIN(x0, x1), MIN(y0, y1), MAX(x0, x1) + 1, MAX(y0, y1) + 1);
+	setColorVertex(&vertices[0], color, x0, y0);
+	setColorVertex(&vertices[1], color, x1, y1);
+}
+
+void drawPolylineScreen(const int* points, int count, Color color)
+{
+	ColorVertex* vertices;
+	int i, segments = 0, inside = 1;
+	int left = SCREEN_WIDTH, top = SCREEN_HEIGHT, right = -1, bottom = -1;
+	if (!initialized || count < 2) return;
+
+	// bounds of the visible part, and whether any of it has to be clipped
+	for (i = 0; i + 1 < count; i++) {
+		int x0 = points[2 * i], y0 = points[2 * i + 1];
+		int x1 = points[2 * i + 2], y1 = points[2 * i + 3];
+		if (!clipLine(&x0, &y0, &x1, &y1, 0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1)) {
+			inside = 0;
+			continue;
+		}
+		if (x0 != points[2 * i] || y0 != points[2 * i + 1] || x1 != points[2 * i + 2] || y1 != points[2 * i + 3]) inside = 0;
+		left = MIN(left, MIN(x0, x1));
+		top = MIN(top, MIN(y0, y1));
+		right = MAX(right, MAX(x0, x1));
+		bottom = MAX(bottom, MAX(y0, y1));
+		segments++;
+	}
+	if (segments == 0 || !needsDraw(left, top, right + 1, bottom + 1)) return;
+
+	if (inside) {
+		vertices = lineVertices(GU_LINE_STRIP, count, left, top, right + 1, bottom + 1);
+		for (i = 0; i < count; i++) setColorVertex(&vertices[i], color, points[2 * i], points[2 * i + 1]);
+		return;
+	}
+	// the visible parts of the segments go out as one list of separate lines
+	vertices = lineVertices(GU_LINES, segments * 2, left, top, right + 1, bottom + 1);
+	for (i = 0; i + 1 < count; i++) {
+		int x0 = points[2 * i], y0 = points[2 * i + 1];
+		int x1 = points[2 * i + 2], y1 = points[2 * i + 3];
+		if (!clipLine(&x0, &y0, &x1, &y1, 0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1)) continue;
+		setColorVertex(vertices++, color, x0, y0);
+		setColorVertex(vertices++, color, x1, y1);
+	}
+}
+
+static void drawLinePlotted(int x0, int y0, int x1, int y1, u32 pixel, Image* image)
+{
+	int dx = abs(x1 - x0);
+	int dy = -abs(y1 - y0);
+	int stepx = x0 < x1 ? 1 : -1;
+	int stepy = y0 < y1 ? 1 : -1;
+	int error = dx + dy;
+	for (;;) {
+		plotPixel(image, x0, y0, pixel);
+		if (x0 == x1 && y0 == y1) break;
+		int error2 = 2 * error;
+		if (error2 >= dy) {
+			error += dy;
+			x0 += stepx;
+		}
+		if (error2 <= dx) {
+			error += dx;
+			y0 += stepy;
+		}
+	}
 }
 
 void drawLineImage(int x0, int y0, int x1, int y1, Color color, Image* image)
 {
-	drawLine(x0, y0, x1, y1, color, image->data, image->textureWidth);
+	u32 pixel = imagePixel(image, color);
+	int bytes = pixelFormatBytes(image->format);
+	int y;
+
+	if (!clipLine(&x0, &y0, &x1, &y1, 0, 0, image->imageWidth - 1, image->imageHeight - 1)) return;
+	markDirty(image, MIN(y0, y1), MAX(y0, y1) + 1);
+	if (image->swizzled || image->palette) {
+		drawLinePlotted(x0, y0, x1, y1, pixel, image);
+		return;
+	}
+	if (y0 == y1) {
+		fillRow(pixelAddress(image, MIN(x0, x1), y0), abs(x1 - x0) + 1, bytes, pixel);
+		return;
+	}
+	if (x0 == x1) {
+		u8* address = (u8*) pixelAddress(image, x0, MIN(y0, y1));
+		for (y = MIN(y0, y1); y <= MAX(y0, y1); y++, address += rowBytesOf(image)) storePixel(address, bytes, pixel);
+		return;
+	}
+	drawLine(x0, y0, x1, y1, pixel, image->data, image->stride, bytes);
 }
 
 #define BUF_WIDTH (512)
@@ -445,15 +1977,56 @@ void drawLineImage(int x0, int y0, int x1, int y1, Color color, Image* image)
 
 void initGraphics()
 {
+	initGraphicsEx(IMAGE_FORMAT_8888);
+}
+
+/* Projection of transformed sprites, screen pixels to the viewport, view and model stay identity. */
+static void setScreenProjection()
+{
+	static const float __attribute__((aligned(16))) identity[16] = {
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	};
+	static const float __attribute__((aligned(16))) projection[16] = {
+		2.0f / SCREEN_WIDTH, 0.0f, 0.0f, 0.0f,
+		0.0f, -2.0f / SCREEN_HEIGHT, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		-1.0f, 1.0f, 0.0f, 1.0f
+	};
+	sceGuSetMatrix(GU_PROJECTION, (const ScePspFMatrix4*) projection);
+	sceGuSetMatrix(GU_VIEW, (const ScePspFMatrix4*) identity);
+	sceGuSetMatrix(GU_MODEL, (const ScePspFMatrix4*) identity);
+}
+
+void initGraphicsEx(int format)
+{
+	initImageAllocator();
+	if (imageStatsLock < 0) imageStatsLock = sceKernelCreateSema("image_stats", 0, 1, 1, NULL);
+	// the thread drawing the frames, the only one whose phases are timed
+	profileSetFrameThread();
+	screenFormat = formatFromFlags(format);
+	frameBufferSize = PSP_LINE_SIZE * SCREEN_HEIGHT * pixelFormatBytes(screenFormat);
+	bufferCount = framePacing == FRAME_PACING_TRIPLE ? 3 : 2;
+	thirdBuffer = bufferCount == 3;
 	dispBufferNumber = 0;
+	drawBufferNumber = 1;
+	frameBufferNumber = 0;
+	listIndex = 0;
+	framePending = 0;
+	textureCacheInit(&textureCache, textureStart(), sceGeEdramGetSize() - textureStart());
+	frameStatsInit(&frameStats);
+	memset(&frameTiming, 0, sizeof(frameTiming));
+	vblankWaitMicros = 0;
 
 	sceGuInit();
 
 	guStart();
-	sceGuDrawBuffer(GU_PSM_8888, (void*)FRAMEBUFFER_SIZE, PSP_LINE_SIZE);
+	sceGuDrawBuffer(screenFormat, (void*) (uintptr_t) frameBufferSize, PSP_LINE_SIZE);
 	sceGuDispBuffer(SCREEN_WIDTH, SCREEN_HEIGHT, (void*)0, PSP_LINE_SIZE);
 	sceGuClear(GU_COLOR_BUFFER_BIT | GU_DEPTH_BUFFER_BIT);
-	sceGuDepthBuffer((void*) (FRAMEBUFFER_SIZE*2), PSP_LINE_SIZE);
+	sceGuDepthBuffer((void*) (uintptr_t) (frameBufferSize*2), PSP_LINE_SIZE);
 	sceGuOffset(2048 - (SCREEN_WIDTH / 2), 2048 - (SCREEN_HEIGHT / 2));
 	sceGuViewport(2048, 2048, SCREEN_WIDTH, SCREEN_HEIGHT);
 	sceGuDepthRange(0xc350, 0x2710);
@@ -462,10 +2035,12 @@ void initGraphics()
 	sceGuAlphaFunc(GU_GREATER, 0, 0xff);
 	sceGuEnable(GU_ALPHA_TEST);
 	sceGuDepthFunc(GU_GEQUAL);
-	sceGuEnable(GU_DEPTH_TEST);
+	// everything is drawn in order, and transformed sprites may be mirrored or sit at other depths
+	sceGuDisable(GU_DEPTH_TEST);
 	sceGuFrontFace(GU_CW);
 	sceGuShadeModel(GU_SMOOTH);
-	sceGuEnable(GU_CULL_FACE);
+	sceGuDisable(GU_CULL_FACE);
+	setScreenProjection();
 	sceGuEnable(GU_TEXTURE_2D);
 	sceGuEnable(GU_CLIP_PLANES);
 	sceGuTexMode(GU_PSM_8888, 0, 0, 0);
@@ -474,20 +2049,25 @@ void initGraphics()
 	sceGuAmbientColor(0xffffffff);
 	sceGuEnable(GU_BLEND);
 	sceGuBlendFunc(GU_ADD, GU_SRC_ALPHA, GU_ONE_MINUS_SRC_ALPHA, 0, 0);
+	if (screenFormat != GU_PSM_8888) sceGuEnable(GU_DITHER);
 	sceGuFinish();
 	sceGuSync(0, 0);
+	bakeGlyphAtlas();
 
 	sceDisplayWaitVblankStart();
 	sceGuDisplay(GU_TRUE);
+	swapVcount = sceDisplayGetVcount();
+	frameStart = sceKernelGetSystemTimeLow();
 	initialized = 1;
 }
 
 void disableGraphics()
 {
+	finishDraw();
 	initialized = 0;
 }
 
 void guStart()
 {
-	sceGuStart(GU_DIRECT, list);
+	sceGuStart(GU_DIRECT, list[listIndex]);
 }
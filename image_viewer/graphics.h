@@ -2,35 +2,181 @@
 #define GRAPHICS_H
 
 #include <psptypes.h>
+#include "texcache.h"
+#include "text.h"
+#include "framestats.h"
+#include "sprite.h"
+#include "profile.h"
+#include "pack.h"
+#include "imagealloc.h"
 
 #define	PSP_LINE_SIZE 512
 #define SCREEN_WIDTH 480
 #define SCREEN_HEIGHT 272
 
 typedef u32 Color;
+
+#define IMAGE_SWIZZLE 0x01  // store the image swizzled for faster GE texture reads, if its size allows
+#define IMAGE_DITHER 0x02  // ordered dithering when loading into a 16-bit format
+#define IMAGE_EXPAND_PALETTE 0x04  // load paletted PNGs as direct colors instead of CLUT indices
+#define IMAGE_NO_ARENA 0x08  // allocate outside the current image arena, for images that outlive it
+
+#define IMAGE_FORMAT_8888 0x000  // 32-bit pixels, the default
+#define IMAGE_FORMAT_5650 0x100  // 16-bit pixels without alpha
+#define IMAGE_FORMAT_5551 0x200  // 16-bit pixels with 1 bit alpha
+#define IMAGE_FORMAT_4444 0x300  // 16-bit pixels with 4 bit alpha
+#define IMAGE_FORMAT_T4 0x400  // 4-bit indices into a 16 entry palette
+#define IMAGE_FORMAT_T8 0x500  // 8-bit indices into a 256 entry palette
+#define IMAGE_FORMAT_MASK 0x700
 #define A(color) ((u8)(color >> 24 & 0xFF))
 #define B(color) ((u8)(color >> 16 & 0xFF))
 #define G(color) ((u8)(color >> 8 & 0xFF))
 #define R(color) ((u8)(color & 0xFF))
 
+/** Monotonic counter identifying a display list handed to the GE. */
+typedef unsigned int FrameFence;
+
 typedef struct
 {
-	int textureWidth;  // the real width of data, 2^n with n>=0
-	int textureHeight;  // the real height of data, 2^n with n>=0
+	int textureWidth;  // the texture width handed to the GE, 2^n with n>=0
+	int textureHeight;  // the texture height handed to the GE, 2^n with n>=0
 	int imageWidth;  // the image width
 	int imageHeight;
-	Color* data;
+	int stride;  // pixels per row of data, imageWidth padded to 16 pixels and 16 bytes
+	void* data;  // pixels in the image's format, imageHeight rows (rounded up to 8 if swizzled)
+	int format;  // GU_PSM_8888, GU_PSM_5650, GU_PSM_5551, GU_PSM_4444, GU_PSM_T4 or GU_PSM_T8
+	Color* palette;  // 8888 CLUT of indexed formats, 16 byte aligned, NULL otherwise
+	int paletteEntries;  // 16 for GU_PSM_T4, 256 for GU_PSM_T8
+	int swizzled;  // data is stored in the GE's 16 byte x 8 row block layout
+	int dirtyTop;  // first row changed by the CPU since the GE last read the image
+	int dirtyBottom;  // row after the last changed row, no rows are dirty if dirtyBottom <= dirtyTop
 } Image;
 
+#define FRAME_PACING_UNCAPPED 0  // frames are shown as soon as they are drawn without waiting for vblank and may tear, the default
+#define FRAME_PACING_VSYNC_60 1  // at most one frame per vblank, swapped while the display is in vblank
+#define FRAME_PACING_VSYNC_30 2  // at most one frame per two vblanks
+#define FRAME_PACING_TRIPLE 3  // a third buffer lets the CPU and GE start the next frame without waiting for vblank
+
+#define SCREEN_CAPTURE_IDLE 0  // no capture was started
+#define SCREEN_CAPTURE_COPYING 1  // the GE copies the screen to memory
+#define SCREEN_CAPTURE_ENCODING 2  // the encoder thread writes the PNG
+#define SCREEN_CAPTURE_DONE 3  // the last capture was saved
+#define SCREEN_CAPTURE_FAILED 4  // the last capture could not be saved
+
+/** Timing of the screen captures taken with captureScreen(). */
+typedef struct
+{
+	int captures;  // captures started
+	int failures;  // captures that could not be saved
+	unsigned int callMicros;  // time the last captureScreen() call took on the calling thread
+	unsigned int maxCallMicros;  // longest captureScreen() call
+	unsigned int encodeMicros;  // time the encoder thread took for the last saved capture
+} ScreenCaptureStats;
+
+/** Memory taken by all live images. */
+typedef struct
+{
+	int images;  // images allocated
+	int bytes;  // bytes of pixel data allocated
+	int bytesSaved;  // bytes not allocated compared to textureWidth x textureHeight storage
+} ImageMemoryStats;
+
+#define TILE_SIZE 512  // largest texture the GE can sample, in both directions
+
+/**
+ * A large image stored as a grid of images of at most TILE_SIZE x TILE_SIZE pixels.
+ */
+typedef struct
+{
+	int imageWidth;
+	int imageHeight;
+	int columns;  // tiles per row
+	int rows;  // rows of tiles
+	Image** tiles;  // columns * rows tiles, row by row, NULL for fully transparent tiles
+} TiledImage;
+
 /**
  * Load a PNG image.
  *
  * @pre filename != NULL
  * @param filename - filename of the PNG image to load
- * @return pointer to a new allocated Image struct, or NULL on failure
+ * @return pointer to a new allocated Image struct, or NULL on failure or if the image is
+ *         larger than TILE_SIZE, see loadTiledImage()
  */
 extern Image* loadImage(const char* filename);
 
+/**
+ * Load a PNG image with storage options.
+ *
+ * Colors are converted to the requested pixel format while decoding. Paletted PNGs keep
+ * their indices as GU_PSM_T4 or GU_PSM_T8 with the palette and tRNS alpha as CLUT, unless
+ * IMAGE_EXPAND_PALETTE or a 16-bit format is requested. Other PNGs ignore the indexed formats.
+ *
+ * @pre filename != NULL
+ * @param filename - filename of the PNG image to load
+ * @param flags - one IMAGE_FORMAT_* value, optionally or'ed with IMAGE_SWIZZLE, IMAGE_DITHER,
+ *                IMAGE_EXPAND_PALETTE and IMAGE_NO_ARENA
+ * @return pointer to a new allocated Image struct, or NULL on failure
+ */
+extern Image* loadImageEx(const char* filename, int flags);
+
+/**
+ * Load a PNG image from an entry of an asset pack, see loadImageEx().
+ *
+ * The entry is read in one call and libpng decodes it from memory, no file is opened.
+ *
+ * @pre pack != NULL && name != NULL
+ * @param pack - the pack, from openPack()
+ * @param name - name of the entry, its path in the directory packed
+ * @param flags - like loadImageEx()
+ * @return pointer to a new allocated Image struct, or NULL on failure, if the pack has no such
+ *         entry or if the entry is not a PNG
+ */
+extern Image* loadImageFromPack(Pack* pack, const char* name, int flags);
+
+/**
+ * Load a texture cooked by saveTextureFile() or the texcook host tool.
+ *
+ * The file holds the image as loadImageEx() would have stored it, so the texels are read
+ * in one call straight into the image, without decoding or converting anything.
+ *
+ * @pre filename != NULL
+ * @param filename - filename of the cooked texture
+ * @return pointer to a new allocated Image struct, or NULL on failure or if the file does not
+ *         match the TexFileHeader layout of this build
+ */
+extern Image* loadTextureFile(const char* filename);
+
+/**
+ * Load a PNG image of any size as a grid of tiles.
+ *
+ * Tiles are TILE_SIZE pixels wide and high, smaller at the right and bottom edges.
+ * Tiles without a single visible pixel take no memory.
+ *
+ * @pre filename != NULL
+ * @param filename - filename of the PNG image to load
+ * @return pointer to a new allocated TiledImage struct, or NULL on failure
+ */
+extern TiledImage* loadTiledImage(const char* filename);
+
+/**
+ * Load a PNG image of any size as a grid of tiles, with storage options.
+ *
+ * @pre filename != NULL
+ * @param filename - filename of the PNG image to load
+ * @param flags - like loadImageEx(), palettes are always expanded
+ * @return pointer to a new allocated TiledImage struct, or NULL on failure
+ */
+extern TiledImage* loadTiledImageEx(const char* filename, int flags);
+
+/**
+ * Frees a tiled image and all its tiles.
+ *
+ * @pre tiled != NULL
+ * @param tiled - a pointer to a TiledImage struct
+ */
+extern void freeTiledImage(TiledImage* tiled);
+
 /**
  * Blit a rectangle part of an image to another image.
  *
@@ -65,11 +211,15 @@ extern void blitImageToImage(int sx, int sy, int width, int height, Image* sourc
  * @param source - pointer to Image struct of the source image
  * @param dx - left target position in destination image
  * @param dy - top target position in destination image
+ * @note The copy is queued into the frame's display list and executed after flipScreen(),
+ *       source must not be changed or freed before the frame's fence is reached.
  */
 extern void blitImageToScreen(int sx, int sy, int width, int height, Image* source, int dx, int dy);
 
 /**
- * Blit a rectangle part of an image to another image without alpha pixels in source image.
+ * Blend a rectangle part of an image over another image using the source alpha.
+ *
+ * Source colors are straight alpha, see blendColor() in blend.h.
  *
  * @pre source != NULL && destination != NULL &&
  *      sx >= 0 && sy >= 0 &&
@@ -87,6 +237,47 @@ extern void blitImageToScreen(int sx, int sy, int width, int height, Image* sour
  */
 extern void blitAlphaImageToImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination);
 
+/**
+ * Blend a rectangle part of an image with premultiplied alpha over another image.
+ *
+ * @pre source != NULL && destination != NULL &&
+ *      sx >= 0 && sy >= 0 &&
+ *      width > 0 && height > 0 &&
+ *      sx + width <= source->width && sy + height <= source->height &&
+ *      dx + width <= destination->width && dy + height <= destination->height
+ * @param sx - left position of rectangle in source image
+ * @param sy - top position of rectangle in source image
+ * @param width - width of rectangle in source image
+ * @param height - height of rectangle in source image
+ * @param source - pointer to Image struct of the source image, colors premultiplied by alpha
+ * @param dx - left target position in destination image
+ * @param dy - top target position in destination image
+ * @param destination - pointer to Image struct of the destination image
+ */
+extern void blitPremultipliedImageToImage(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination);
+
+/**
+ * Draw a rectangle part of an image to screen rotated, scaled, flipped and tinted.
+ *
+ * The sprite is drawn by the GE's transform pipeline as two triangles at sub-pixel
+ * positions, batched with other sprites of the same image. The corners are computed
+ * by transformSprite(). Alpha pixels are blended, texels are sampled nearest.
+ *
+ * @pre source != NULL && transform != NULL &&
+ *      sx >= 0 && sy >= 0 && width > 0 && height > 0 &&
+ *      sx + width <= source->imageWidth && sy + height <= source->imageHeight &&
+ *      the sprite stays within 1024 pixels of the screen
+ * @param sx - left position of rectangle in source image
+ * @param sy - top position of rectangle in source image
+ * @param width - width of rectangle in source image
+ * @param height - height of rectangle in source image
+ * @param source - pointer to Image struct of the source image
+ * @param transform - placement of the sprite on screen
+ * @note The sprite is drawn after flipScreen(), source must not be changed or freed before
+ *       the frame's fence is reached.
+ */
+extern void drawSpriteScreen(int sx, int sy, int width, int height, Image* source, const SpriteTransform* transform);
+
 /**
  * Blit a rectangle part of an image to screen without alpha pixels in source image.
  *
@@ -102,9 +293,73 @@ extern void blitAlphaImageToImage(int sx, int sy, int width, int height, Image*
  * @param source - pointer to Image struct of the source image
  * @param dx - left target position in destination image
  * @param dy - top target position in destination image
+ * @note The sprite is batched with other draws of the same texture and drawn after
+ *       flipScreen(), source must not be changed or freed before the frame's fence is reached.
  */
 extern void blitAlphaImageToScreen(int sx, int sy, int width, int height, Image* source, int dx, int dy);
 
+/**
+ * Blit a rectangle part of a tiled image to screen.
+ *
+ * The rectangle is clipped to the screen, each visible tile is drawn as batched sprites
+ * into the frame's display list. Fully transparent tiles are skipped.
+ *
+ * @pre source != NULL &&
+ *      sx >= 0 && sy >= 0 &&
+ *      sx + width <= source->imageWidth && sy + height <= source->imageHeight
+ * @param sx - left position of rectangle in source image
+ * @param sy - top position of rectangle in source image
+ * @param width - width of rectangle in source image
+ * @param height - height of rectangle in source image
+ * @param source - pointer to TiledImage struct of the source image
+ * @param dx - left target position on screen, may be negative
+ * @param dy - top target position on screen, may be negative
+ * @note source must not be changed or freed before the frame's fence is reached.
+ */
+extern void blitTiledImageToScreen(int sx, int sy, int width, int height, TiledImage* source, int dx, int dy);
+
+/**
+ * Blit a rectangle part of a tiled image to screen without alpha pixels in source image.
+ *
+ * Clipped and batched like blitTiledImageToScreen().
+ *
+ * @pre source != NULL &&
+ *      sx >= 0 && sy >= 0 &&
+ *      sx + width <= source->imageWidth && sy + height <= source->imageHeight
+ * @param sx - left position of rectangle in source image
+ * @param sy - top position of rectangle in source image
+ * @param width - width of rectangle in source image
+ * @param height - height of rectangle in source image
+ * @param source - pointer to TiledImage struct of the source image
+ * @param dx - left target position on screen, may be negative
+ * @param dy - top target position on screen, may be negative
+ * @note source must not be changed or freed before the frame's fence is reached.
+ */
+extern void blitAlphaTiledImageToScreen(int sx, int sy, int width, int height, TiledImage* source, int dx, int dy);
+
+/**
+ * Blit a rectangle part of an indexed image to screen with another palette.
+ *
+ * Only the CLUT changes, so palette swaps like team colors share the texture and its
+ * VRAM copy with the image's own palette.
+ *
+ * @pre source != NULL && source->palette != NULL && palette != NULL &&
+ *      sx >= 0 && sy >= 0 &&
+ *      width > 0 && height > 0 &&
+ *      sx + width <= source->width && sy + height <= source->height &&
+ *      dx + width <= SCREEN_WIDTH && dy + height <= SCREEN_HEIGHT
+ * @param sx - left position of rectangle in source image
+ * @param sy - top position of rectangle in source image
+ * @param width - width of rectangle in source image
+ * @param height - height of rectangle in source image
+ * @param source - pointer to Image struct of the source image
+ * @param dx - left target position in destination image
+ * @param dy - top target position in destination image
+ * @param palette - source->paletteEntries 8888 colors, 16 byte aligned
+ * @note palette must not be changed or freed before the frame's fence is reached.
+ */
+extern void blitPaletteImageToScreen(int sx, int sy, int width, int height, Image* source, int dx, int dy, const Color* palette);
+
 /**
  * Create an empty image.
  *
@@ -115,6 +370,31 @@ extern void blitAlphaImageToScreen(int sx, int sy, int width, int height, Image*
  */
 extern Image* createImage(int width, int height);
 
+/**
+ * Create an empty image with storage options.
+ *
+ * @pre width > 0 && height > 0 && width <= 512 && height <= 512
+ * @param width - width of the new image
+ * @param height - height of the new image
+ * @param flags - one IMAGE_FORMAT_* value, optionally or'ed with IMAGE_SWIZZLE and IMAGE_NO_ARENA
+ * @return pointer to a new allocated Image struct, all pixels initialized to color 0 (index 0
+ *         and an all zero palette for indexed formats), or NULL on failure
+ */
+extern Image* createImageEx(int width, int height, int flags);
+
+/**
+ * Mark rows of an image as changed after writing to image->data directly.
+ *
+ * The drawing functions of this module mark the rows they change themselves. Dirty rows
+ * are written back from the data cache before the image is next used as a GE texture.
+ *
+ * @pre image != NULL && y >= 0 && height > 0 && y + height <= image->imageHeight
+ * @param image - the changed image
+ * @param y - first changed row
+ * @param height - number of changed rows
+ */
+extern void markImageDirty(Image* image, int y, int height);
+
 /**
  * Frees an allocated image.
  *
@@ -123,6 +403,16 @@ extern Image* createImage(int width, int height);
  */
 extern void freeImage(Image* image);
 
+/**
+ * Free every image allocated in an arena at once and take back the arena's memory, e.g.
+ * when leaving a level. Images of the arena freed before with freeImage() are skipped.
+ *
+ * @pre arena != NULL && no image of the arena is drawn anymore, also not by a display list
+ *      the GE still runs, and the loader has no request pending for the arena
+ * @param arena - the arena, set with setImageArena() while its images were loaded
+ */
+extern void resetImageArena(ImageArena* arena);
+
 /**
  * Initialize all pixels of an image with a color.
  *
@@ -135,6 +425,8 @@ extern void clearImage(Color color, Image* image);
 /**
  * Initialize all pixels of the screen with a color.
  *
+ * The clear is queued into the frame's display list.
+ *
  * @param color - new color for the pixels
  */
 extern void clearScreen(Color color);
@@ -153,17 +445,32 @@ extern void clearScreen(Color color);
 extern void fillImageRect(Color color, int x0, int y0, int width, int height, Image* image);
 
 /**
- * Fill a rectangle of an image with a color.
+ * Fill a rectangle of the screen with a color.
+ *
+ * The rectangle is drawn by the GE as a flat colored sprite, batched into the frame's
+ * display list and clipped to the screen. The color replaces the pixels without blending.
  *
- * @pre image != NULL
  * @param color - new color for the pixels
- * @param x0 - left position of rectangle in image
- * @param y0 - top position of rectangle in image
- * @param width - width of rectangle in image
- * @param height - height of rectangle in image
+ * @param x0 - left position of rectangle on screen
+ * @param y0 - top position of rectangle on screen
+ * @param width - width of rectangle on screen
+ * @param height - height of rectangle on screen
  */
 extern void fillScreenRect(Color color, int x0, int y0, int width, int height);
 
+/**
+ * Draw the one pixel wide outline of a rectangle to screen.
+ *
+ * Drawn by the GE like fillScreenRect().
+ *
+ * @param color - new color for the pixels
+ * @param x0 - left position of rectangle on screen
+ * @param y0 - top position of rectangle on screen
+ * @param width - width of rectangle on screen
+ * @param height - height of rectangle on screen
+ */
+extern void drawRectScreen(Color color, int x0, int y0, int width, int height);
+
 /**
  * Set a pixel on screen to the specified color.
  *
@@ -207,10 +514,13 @@ extern Color getPixelImage(int x, int y, Image* image);
 /**
  * Print a text (pixels out of the screen or image are clipped).
  *
+ * The characters are drawn as sprites from a glyph atlas of the font, batched into the
+ * frame's display list. Strings drawn unchanged at the same place reuse their layout.
+ *
  * @param x - left position of text
  * @param y - top position of text
  * @param text - the text to print
- * @param color - new color for the pixels
+ * @param color - new color for the pixels, alpha blends the text
  */
 extern void printTextScreen(int x, int y, const char* text, u32 color);
 
@@ -230,24 +540,229 @@ extern void printTextImage(int x, int y, const char* text, u32 color, Image* ima
  *
  * @pre filename != NULL
  * @param filename - filename of the PNG image
- * @param data - start of Color type pixel data (can be getVramDisplayBuffer())
+ * @param data - start of linear Color type pixel data (can be getVramDisplayBuffer(), not a swizzled image)
  * @param width - logical width of the image or SCREEN_WIDTH
  * @param height - height of the image or SCREEN_HEIGHT
- * @param lineSize - physical width of the image or PSP_LINE_SIZE
+ * @param lineSize - physical width of the image (image->stride) or PSP_LINE_SIZE
  * @param saveAlpha - if 0, image is saved without alpha channel
  */
 extern void saveImage(const char* filename, Color* data, int width, int height, int lineSize, int saveAlpha);
 
 /**
- * Exchange display buffer and drawing buffer.
+ * Save pixel data of any pixel format in PNG format.
+ *
+ * @pre filename != NULL
+ * @param filename - filename of the PNG image
+ * @param data - start of linear pixel data (can be getVramDisplayBuffer() with getScreenFormat())
+ * @param width - logical width of the image or SCREEN_WIDTH
+ * @param height - height of the image or SCREEN_HEIGHT
+ * @param lineSize - physical width of the image in pixels (image->stride) or PSP_LINE_SIZE
+ * @param format - GU_PSM_* pixel format of data
+ * @param saveAlpha - if 0, image is saved without alpha channel
+ */
+extern void saveImageFormat(const char* filename, void* data, int width, int height, int lineSize, int format, int saveAlpha);
+
+/**
+ * Save an image of any format in PNG format.
+ *
+ * Indexed images are saved as paletted PNGs, their palette alpha as tRNS if saveAlpha is set.
+ *
+ * @pre filename != NULL && image != NULL
+ * @param filename - filename of the PNG image
+ * @param image - the image, swizzled or not
+ * @param saveAlpha - if 0, image is saved without alpha channel
+ */
+extern void saveImageFile(const char* filename, Image* image, int saveAlpha);
+
+/**
+ * Save an image as a cooked texture, see texfile.h and loadTextureFile().
+ *
+ * @pre filename != NULL && image != NULL
+ * @param filename - filename of the cooked texture
+ * @param image - the image, in any format, swizzled or not
+ * @return 1 on success, 0 if the file could not be written
+ */
+extern int saveTextureFile(const char* filename, Image* image);
+
+/**
+ * Save the last flipped frame in PNG format without stalling the game.
+ *
+ * The GE copies the frame to memory with one sceGuCopyImage in the current frame's
+ * display list, a low priority thread then encodes it with fast PNG settings while the
+ * game waits for vblank or the GE. Unlike saveImage() on getVramDisplayBuffer() the call
+ * neither waits for the GE nor reads uncached VRAM. Only one capture runs at a time.
+ *
+ * @pre filename != NULL
+ * @param filename - filename of the PNG image, shorter than 256 characters
+ * @param saveAlpha - if 0, image is saved without alpha channel
+ * @return 1 if the capture was started, 0 if one is still running or it could not be started
+ */
+extern int captureScreen(const char* filename, int saveAlpha);
+
+/**
+ * Check the progress of the last captureScreen().
+ *
+ * The copy is handed to the encoder by flipScreen() or this call once the GE made it.
+ *
+ * @return SCREEN_CAPTURE_IDLE, SCREEN_CAPTURE_COPYING, SCREEN_CAPTURE_ENCODING,
+ *         SCREEN_CAPTURE_DONE or SCREEN_CAPTURE_FAILED
+ */
+extern int getScreenCaptureState();
+
+/**
+ * Get the timing of the screen captures.
+ *
+ * @return pointer to the live counters
+ */
+extern const ScreenCaptureStats* getScreenCaptureStats();
+
+/**
+ * Hand the frame's display list to the GE and start recording the next frame.
+ *
+ * The GE draws the frame while the CPU builds the next one in the other display list.
+ * The frame is put on screen by the next flipScreen(), or earlier if the CPU needs the
+ * draw buffer, so the display runs one frame behind the game logic. Putting it on screen
+ * waits as the frame pacing asks, see setFramePacing(), and ends the frame's timing.
  */
 extern void flipScreen();
 
+/**
+ * Choose how flipScreen() paces frames.
+ *
+ * Triple buffering takes a third frame buffer from the VRAM the texture cache uses, all
+ * cached textures are uploaded again once. The VRAM stays with the frame buffer when
+ * switching to another mode later. Can be called before initGraphics().
+ *
+ * @pre called right after flipScreen(), the frame being recorded may be lost otherwise
+ * @param mode - FRAME_PACING_UNCAPPED, FRAME_PACING_VSYNC_60, FRAME_PACING_VSYNC_30 or FRAME_PACING_TRIPLE
+ */
+extern void setFramePacing(int mode);
+
+/**
+ * Get the frame pacing mode.
+ *
+ * @return FRAME_PACING_UNCAPPED, FRAME_PACING_VSYNC_60, FRAME_PACING_VSYNC_30 or FRAME_PACING_TRIPLE
+ */
+extern int getFramePacing();
+
+/**
+ * Get the timing of the last frames.
+ *
+ * CPU time, GE wait time and missed vblanks of the frames in the rolling window,
+ * as histograms and sums, and per frame with frameStatsGet().
+ *
+ * @return pointer to the live statistics
+ */
+extern const FrameStats* getFrameStats();
+
+/**
+ * Show or hide the profiler overlay.
+ *
+ * When shown, flipScreen() draws the time, phases and counters of the previous frame from
+ * profileGetFrame() over the top left of the screen, as numbers and bars one vblank long
+ * at full length. The overlay is drawn opaque and is part of the frame it is drawn in.
+ *
+ * @param enabled - 1 to show the overlay, 0 to hide it
+ */
+extern void setProfileOverlay(int enabled);
+
+/**
+ * @return 1 if the profiler overlay is shown, 0 otherwise
+ */
+extern int getProfileOverlay();
+
+/**
+ * Get the fence of the frame last handed to the GE by flipScreen().
+ *
+ * @return the fence of the last flipped frame
+ */
+extern FrameFence getFrameFence();
+
+/**
+ * Get the fence of the draws recorded so far, including those of the frame not flipped yet.
+ * Once it is reached no image drawn before the call is read by the GE anymore.
+ *
+ * @return a fence to pass to isFrameFenceReached(), not to waitFrameFence() before the
+ *         frame is flipped
+ */
+extern FrameFence getDrawFence();
+
+/**
+ * Check without blocking whether the GE has finished a frame.
+ *
+ * @param fence - fence returned by getFrameFence()
+ * @return 1 if the frame is drawn and its images can be changed or freed, 0 otherwise
+ */
+extern int isFrameFenceReached(FrameFence fence);
+
+/**
+ * Wait until the GE has finished a frame.
+ *
+ * @param fence - fence returned by getFrameFence()
+ */
+extern void waitFrameFence(FrameFence fence);
+
+/**
+ * Switch the opt-in dirty rectangle mode on or off.
+ *
+ * In this mode only the parts of the screen marked with markScreenDamage() in this frame
+ * or the one before are redrawn, since the draw buffer still shows the frame before the
+ * last. Draws and clears outside of them are dropped, the rest is clipped to them. Frames
+ * without any damage leave the GE idle, flipScreen() then only shows the last frame.
+ * The whole screen is redrawn in the two frames after the mode is switched on.
+ *
+ * @param enabled - 1 to track damage, 0 to redraw everything
+ */
+extern void setDamageTracking(int enabled);
+
+/**
+ * Mark a part of the screen as changed in this frame, before drawing it.
+ *
+ * Everything drawn over the part has to be drawn again, not only what changed, since
+ * it is cleared and redrawn. Does nothing if damage tracking is off.
+ *
+ * @param x - left position of the changed rectangle
+ * @param y - top position of the changed rectangle
+ * @param width - width of the changed rectangle
+ * @param height - height of the changed rectangle
+ */
+extern void markScreenDamage(int x, int y, int width, int height);
+
+/**
+ * Check whether anything drawn into a screen rectangle this frame would be visible.
+ *
+ * Lets callers skip preparing draws that damage tracking would drop anyway.
+ *
+ * @param x - left position of the rectangle
+ * @param y - top position of the rectangle
+ * @param width - width of the rectangle
+ * @param height - height of the rectangle
+ * @return 1 if the rectangle has to be drawn, always 1 if damage tracking is off
+ */
+extern int isScreenRectDamaged(int x, int y, int width, int height);
+
 /**
  * Initialize the graphics.
  */
 extern void initGraphics();
 
+/**
+ * Initialize the graphics with a given frame buffer format.
+ *
+ * 16-bit formats halve the VRAM the GE writes per frame and leave more VRAM for textures,
+ * drawing is dithered in that case.
+ *
+ * @param format - IMAGE_FORMAT_8888, IMAGE_FORMAT_5650, IMAGE_FORMAT_5551 or IMAGE_FORMAT_4444
+ */
+extern void initGraphicsEx(int format);
+
+/**
+ * Get the pixel format of the frame buffers.
+ *
+ * @return GU_PSM_* format of getVramDrawBuffer() and getVramDisplayBuffer() pixels
+ */
+extern int getScreenFormat();
+
 /**
  * Disable graphics, used for debug text output.
  */
@@ -256,30 +771,87 @@ extern void disableGraphics();
 /**
  * Draw a line to screen.
  *
- * @pre x0 >= 0 && x0 < SCREEN_WIDTH && y0 >= 0 && y0 < SCREEN_HEIGHT &&
- *      x1 >= 0 && x1 < SCREEN_WIDTH && y1 >= 0 && y1 < SCREEN_HEIGHT
+ * The line is clipped to the screen and drawn by the GE, batched into the frame's
+ * display list with the other lines.
+ *
  * @param x0 - x line start position
  * @param y0 - y line start position
  * @param x1 - x line end position
  * @param y1 - y line end position
+ * @param color - new color for the pixels
  */
-void drawLineScreen(int x0, int y0, int x1, int y1, Color color);
+extern void drawLineScreen(int x0, int y0, int x1, int y1, Color color);
 
 /**
- * Draw a line to screen.
+ * Draw connected lines to screen.
+ *
+ * A polyline inside the screen is drawn as one line strip, otherwise the visible parts
+ * of its segments are drawn as one list of lines.
+ *
+ * @pre points != NULL && count <= 4096
+ * @param points - count x, y pairs
+ * @param count - number of points, lines are drawn between neighbors
+ * @param color - new color for the pixels
+ */
+extern void drawPolylineScreen(const int* points, int count, Color color);
+
+/**
+ * Draw a line to an image.
+ *
+ * The line is clipped to the image.
  *
- * @pre x0 >= 0 && x0 < image->imageWidth && y0 >= 0 && y0 < image->imageHeight &&
- *      x1 >= 0 && x1 < image->imageWidth && y1 >= 0 && y1 < image->imageHeight
+ * @pre image != NULL
  * @param x0 - x line start position
  * @param y0 - y line start position
  * @param x1 - x line end position
  * @param y1 - y line end position
+ * @param color - new color for the pixels
+ * @param image - image
  */
 extern void drawLineImage(int x0, int y0, int x1, int y1, Color color, Image* image);
 
+/**
+ * Get the counters of the VRAM texture cache.
+ *
+ * Images drawn repeatedly are copied to the VRAM left after the frame and depth buffers
+ * and drawn from there, least recently drawn ones are evicted when it runs out.
+ *
+ * @return pointer to the live counters
+ */
+extern const TextureCacheStats* getTextureCacheStats();
+
+/**
+ * Get the counters of the cache of laid-out strings drawn by printTextScreen().
+ *
+ * @return pointer to the live counters
+ */
+extern const TextCacheStats* getTextCacheStats();
+
+/**
+ * Get the counters of the memory taken by images.
+ *
+ * Image data is stored with a padded row stride and only the rows of the image, the
+ * power of two texture size is only handed to the GE. bytesSaved sums up the difference
+ * for all live images, e.g. after loading a level's assets.
+ *
+ * @return pointer to the live counters
+ */
+extern const ImageMemoryStats* getImageMemoryStats();
+
+/**
+ * Get the memory an image takes, its pixel data and palette.
+ *
+ * @pre image != NULL
+ * @param image - the image
+ * @return bytes allocated for the image's pixels and palette
+ */
+extern int getImageBytes(Image* image);
+
 /**
  * Get the current draw buffer for fast unchecked access.
  *
+ * Waits until the GE has drawn everything queued so far. Pixels are in getScreenFormat().
+ *
  * @return the start address of the current draw buffer
  */
 extern Color* getVramDrawBuffer();
@@ -0,0 +1,707 @@
+/*
+ * Software GE of the host build. The display lists recorded by the sceGu* stand-ins in
+ * pspsdk_host.c are run here when they are sent, drawing into host_vram.
+ *
+ * Covered is what the image viewer uses: points, lines, triangles and sprites in through
+ * mode or through the matrices, textures of every format, swizzled or not, with 8888
+ * palettes, sampled nearest, the modulate and replace texture functions, alpha test,
+ * blending, scissor, clears and the copy engine. Depth, stencil, fog, lighting, dithering
+ * and indexed drawing are left out, disabled states that graphics.c does not use.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <png.h>
+
+#include "pspgu.h"
+#include "pspge.h"
+#include "hostge.h"
+
+#define CLUT_ENTRIES 256
+#define DISPLAY_WIDTH 480
+#define DISPLAY_HEIGHT 272
+#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
+#define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
+
+/* Vertex after decoding and transforming, in screen pixels and texels. */
+typedef struct
+{
+	float u, v;
+	u32 color;
+	float x, y;
+} GeVertex;
+
+static struct
+{
+	int psm;
+	int offset;  // VRAM offset of the draw buffer
+	int width;  // pixels per row of the draw buffer
+	int enabled[GU_MAX_STATUS];
+	int scissorX0, scissorY0, scissorX1, scissorY1;
+	int alphaFunction, alphaReference, alphaMask;
+	int blendOp, blendSource, blendDestination;
+	u32 blendSourceFix, blendDestinationFix;
+	u32 material;
+	int texturePsm, textureSwizzle;
+	int textureWidth, textureHeight, textureStride;
+	const u8* texture;
+	int textureFunction, textureAlpha;
+	float textureScaleU, textureScaleV, textureOffsetU, textureOffsetV;
+	int clutShift, clutMask;
+	u32 clut[CLUT_ENTRIES];  // loaded like the GE's CLUT cache, later changes to the palette are not seen
+	float matrices[3][16];  // GU_PROJECTION, GU_VIEW, GU_MODEL
+	float offsetX, offsetY;
+	float viewportX, viewportY, viewportWidth, viewportHeight;
+} ge = {
+	GU_PSM_8888, 0, 512,
+	{ 0 },
+	0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT,
+	GU_ALWAYS, 0, 0xff,
+	GU_ADD, GU_SRC_ALPHA, GU_ONE_MINUS_SRC_ALPHA, 0, 0,
+	0xffffffff,
+	GU_PSM_8888, 0, 1, 1, 1, NULL,
+	GU_TFX_MODULATE, GU_TCC_RGBA,
+	1.0f, 1.0f, 0.0f, 0.0f,
+	0, 0xff
+};
+
+static int fragments;
+
+static struct
+{
+	const u8* buffer;
+	int stride;
+	int psm;
+} display;
+
+static int bitsOf(int psm)
+{
+	switch (psm) {
+		case GU_PSM_8888: case GU_PSM_T32: return 32;
+		case GU_PSM_T4: return 4;
+		case GU_PSM_T8: return 8;
+		default: return 16;
+	}
+}
+
+static int expand(u32 value, int bits)
+{
+	return (value << (8 - bits)) | (value >> (2 * bits - 8));
+}
+
+/* Convert a pixel of a direct format to 8888, red in the low byte. */
+static u32 decodePixel(u32 pixel, int psm)
+{
+	u32 r, g, b, a;
+	switch (psm) {
+		case GU_PSM_5650:
+			r = expand(pixel & 31, 5);
+			g = expand((pixel >> 5) & 63, 6);
+			b = expand((pixel >> 11) & 31, 5);
+			a = 255;
+			break;
+		case GU_PSM_5551:
+			r = expand(pixel & 31, 5);
+			g = expand((pixel >> 5) & 31, 5);
+			b = expand((pixel >> 10) & 31, 5);
+			a = (pixel >> 15) ? 255 : 0;
+			break;
+		case GU_PSM_4444:
+			r = (pixel & 15) * 17;
+			g = ((pixel >> 4) & 15) * 17;
+			b = ((pixel >> 8) & 15) * 17;
+			a = (pixel >> 12) * 17;
+			break;
+		default:
+			return pixel;
+	}
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static u32 encodePixel(u32 color, int psm)
+{
+	u32 r = color & 0xff, g = (color >> 8) & 0xff, b = (color >> 16) & 0xff, a = color >> 24;
+	switch (psm) {
+		case GU_PSM_5650: return (r >> 3) | ((g >> 2) << 5) | ((b >> 3) << 11);
+		case GU_PSM_5551: return (r >> 3) | ((g >> 3) << 5) | ((b >> 3) << 10) | ((a >> 7) << 15);
+		case GU_PSM_4444: return (r >> 4) | ((g >> 4) << 4) | ((b >> 4) << 8) | ((a >> 4) << 12);
+		default: return color;
+	}
+}
+
+static u32 load(const u8* address, int bytes)
+{
+	if (bytes == 4) return address[0] | (address[1] << 8) | (address[2] << 16) | ((u32) address[3] << 24);
+	return address[0] | (address[1] << 8);
+}
+
+static void store(u8* address, int bytes, u32 value)
+{
+	address[0] = value;
+	address[1] = value >> 8;
+	if (bytes == 4) {
+		address[2] = value >> 16;
+		address[3] = value >> 24;
+	}
+}
+
+static u32 fetchTexel(int x, int y)
+{
+	int bits = bitsOf(ge.texturePsm);
+	int rowBytes = ge.textureStride * bits / 8;
+	int xBytes, offset;
+	const u8* address;
+	u32 value;
+
+	x &= ge.textureWidth - 1;
+	y &= ge.textureHeight - 1;
+	xBytes = x * bits / 8;
+	if (ge.textureSwizzle) {
+		offset = ((y >> 3) * (rowBytes >> 4) + (xBytes >> 4)) * 128 + ((y & 7) << 4) + (xBytes & 15);
+	} else {
+		offset = y * rowBytes + xBytes;
+	}
+	address = ge.texture + offset;
+	switch (bits) {
+		case 4: value = (x & 1) ? address[0] >> 4 : address[0] & 15; break;
+		case 8: value = address[0]; break;
+		case 16: value = load(address, 2); break;
+		default: value = load(address, 4); break;
+	}
+	if (ge.texturePsm >= GU_PSM_T4) return ge.clut[((value >> ge.clutShift) & ge.clutMask) % CLUT_ENTRIES];
+	return decodePixel(value, ge.texturePsm);
+}
+
+static int channel(u32 color, int shift)
+{
+	return (color >> shift) & 0xff;
+}
+
+static u32 modulate(u32 a, u32 b)
+{
+	u32 result = 0;
+	int shift;
+	for (shift = 0; shift < 32; shift += 8) result |= ((channel(a, shift) * channel(b, shift) + 127) / 255) << shift;
+	return result;
+}
+
+/* Fragment color of a primitive color and texture coordinates. */
+static u32 shade(u32 color, float u, float v, int textured)
+{
+	u32 texel, result;
+	if (!textured) return color;
+	texel = fetchTexel((int) floorf(u), (int) floorf(v));
+	result = ge.textureFunction == GU_TFX_REPLACE ? texel : modulate(texel, color);
+	if (ge.textureAlpha == GU_TCC_RGB) result = (result & 0x00ffffff) | (color & 0xff000000);
+	return result;
+}
+
+static int alphaPasses(int alpha)
+{
+	int a = alpha & ge.alphaMask;
+	int reference = ge.alphaReference & ge.alphaMask;
+	switch (ge.alphaFunction) {
+		case GU_NEVER: return 0;
+		case GU_EQUAL: return a == reference;
+		case GU_NOTEQUAL: return a != reference;
+		case GU_LESS: return a < reference;
+		case GU_LEQUAL: return a <= reference;
+		case GU_GREATER: return a > reference;
+		case GU_GEQUAL: return a >= reference;
+		default: return 1;
+	}
+}
+
+/* Blend factor of one channel, the color factors refer to the other color. */
+static int factor(int function, int source, u32 sourceColor, u32 destinationColor, u32 fix, int shift)
+{
+	switch (function) {
+		case 0: return channel(source ? destinationColor : sourceColor, shift);
+		case 1: return 255 - channel(source ? destinationColor : sourceColor, shift);
+		case GU_SRC_ALPHA: return sourceColor >> 24;
+		case GU_ONE_MINUS_SRC_ALPHA: return 255 - (sourceColor >> 24);
+		case GU_DST_ALPHA: return destinationColor >> 24;
+		case GU_ONE_MINUS_DST_ALPHA: return 255 - (destinationColor >> 24);
+		default: return channel(fix, shift);
+	}
+}
+
+/* The GE blends the color channels only, the alpha of the fragment is written as it is. */
+static u32 blend(u32 source, u32 destination)
+{
+	u32 result = source & 0xff000000;
+	int shift;
+	for (shift = 0; shift < 24; shift += 8) {
+		int s = channel(source, shift) * factor(ge.blendSource, 1, source, destination, ge.blendSourceFix, shift);
+		int d = channel(destination, shift) * factor(ge.blendDestination, 0, source, destination, ge.blendDestinationFix, shift);
+		int value;
+		switch (ge.blendOp) {
+			case GU_SUBTRACT: value = s - d; break;
+			case GU_REVERSE_SUBTRACT: value = d - s; break;
+			case GU_MIN: value = MIN(channel(source, shift), channel(destination, shift)) * 255; break;
+			case GU_MAX: value = MAX(channel(source, shift), channel(destination, shift)) * 255; break;
+			case GU_ABS: value = abs(channel(source, shift) - channel(destination, shift)) * 255; break;
+			default: value = s + d; break;
+		}
+		value = (value + 127) / 255;
+		result |= (u32) MAX(0, MIN(255, value)) << shift;
+	}
+	return result;
+}
+
+static u8* pixelAddress(int x, int y, int bytes)
+{
+	int offset = ge.offset + (y * ge.width + x) * bytes;
+	if (offset < 0 || offset + bytes > HOST_EDRAM_SIZE) return NULL;
+	return host_vram + offset;
+}
+
+static int inScissor(int x, int y)
+{
+	if (!ge.enabled[GU_SCISSOR_TEST]) return x >= 0 && y >= 0 && x < ge.width;
+	return x >= ge.scissorX0 && x < ge.scissorX1 && y >= ge.scissorY0 && y < ge.scissorY1;
+}
+
+static void plot(int x, int y, u32 color)
+{
+	int bytes = bitsOf(ge.psm) / 8;
+	u8* address;
+	if (!inScissor(x, y)) return;
+	if (ge.enabled[GU_ALPHA_TEST] && !alphaPasses(color >> 24)) return;
+	address = pixelAddress(x, y, bytes);
+	if (!address) return;
+	if (ge.enabled[GU_BLEND]) color = blend(color, decodePixel(load(address, bytes), ge.psm));
+	store(address, bytes, encodePixel(color, ge.psm));
+	fragments++;
+}
+
+static float component(const u8* data, int bits)
+{
+	switch (bits) {
+		case 1: return *(const s8*) data;
+		case 2: return *(const s16*) data;
+		default: return *(const float*) data;
+	}
+}
+
+static void transform(const float* m, const float* in, float* out)
+{
+	int i;
+	for (i = 0; i < 4; i++) out[i] = m[i] * in[0] + m[4 + i] * in[1] + m[8 + i] * in[2] + m[12 + i] * in[3];
+}
+
+/*
+ * Decode one vertex of a vertex declaration. Every component is aligned to its size, and the
+ * vertex to its largest component. Returns the size of the vertex.
+ */
+static int decodeVertex(const u8* data, int vtype, GeVertex* vertex)
+{
+	static const int textureSizes[4] = { 0, 1, 2, 4 };
+	static const int colorSizes[8] = { 0, 0, 0, 0, 2, 2, 2, 4 };
+	static const int normalSizes[4] = { 0, 1, 2, 4 };
+	static const int positionSizes[4] = { 0, 1, 2, 4 };
+	int textureSize = textureSizes[vtype & GU_TEXTURE_BITS];
+	int colorSize = colorSizes[(vtype & GU_COLOR_BITS) >> 2];
+	int normalSize = normalSizes[(vtype >> 5) & 3];
+	int positionSize = positionSizes[(vtype & GU_VERTEX_BITS) >> 7];
+	int through = (vtype & GU_TRANSFORM_BITS) == GU_TRANSFORM_2D;
+	int offset = 0;
+	int largest = MAX(MAX(textureSize, colorSize), MAX(normalSize, positionSize));
+	float position[4];
+
+	vertex->u = vertex->v = 0.0f;
+	vertex->color = ge.material;
+	if (textureSize) {
+		offset = (offset + textureSize - 1) & ~(textureSize - 1);
+		vertex->u = component(data + offset, textureSize);
+		vertex->v = component(data + offset + textureSize, textureSize);
+		if (!through) {
+			// 8 and 16-bit coordinates are fractions, 1.0 being 128 and 32768
+			if (textureSize == 1) { vertex->u /= 128.0f; vertex->v /= 128.0f; }
+			if (textureSize == 2) { vertex->u /= 32768.0f; vertex->v /= 32768.0f; }
+			vertex->u = (vertex->u * ge.textureScaleU + ge.textureOffsetU) * ge.textureWidth;
+			vertex->v = (vertex->v * ge.textureScaleV + ge.textureOffsetV) * ge.textureHeight;
+		} else if (textureSize == 2) {
+			vertex->u = *(const u16*) (data + offset);
+			vertex->v = *(const u16*) (data + offset + 2);
+		}
+		offset += 2 * textureSize;
+	}
+	if (colorSize) {
+		offset = (offset + colorSize - 1) & ~(colorSize - 1);
+		if (colorSize == 4) {
+			vertex->color = load(data + offset, 4);
+		} else {
+			static const int formats[3] = { GU_PSM_5650, GU_PSM_5551, GU_PSM_4444 };
+			vertex->color = decodePixel(load(data + offset, 2), formats[((vtype & GU_COLOR_BITS) >> 2) - 4]);
+		}
+		offset += colorSize;
+	}
+	if (normalSize) {
+		offset = (offset + normalSize - 1) & ~(normalSize - 1);
+		offset += 3 * normalSize;
+	}
+	offset = (offset + positionSize - 1) & ~(positionSize - 1);
+	position[0] = component(data + offset, positionSize);
+	position[1] = component(data + offset + positionSize, positionSize);
+	position[2] = component(data + offset + 2 * positionSize, positionSize);
+	position[3] = 1.0f;
+	offset += 3 * positionSize;
+
+	if (through) {
+		vertex->x = position[0];
+		vertex->y = position[1];
+	} else {
+		float world[4], view[4], clip[4];
+		transform(ge.matrices[GU_MODEL], position, world);
+		transform(ge.matrices[GU_VIEW], world, view);
+		transform(ge.matrices[GU_PROJECTION], view, clip);
+		vertex->x = ge.viewportX + clip[0] / clip[3] * ge.viewportWidth / 2 - ge.offsetX;
+		vertex->y = ge.viewportY - clip[1] / clip[3] * ge.viewportHeight / 2 - ge.offsetY;
+	}
+	return (offset + largest - 1) & ~(largest - 1);
+}
+
+static void drawSprite(const GeVertex* a, const GeVertex* b, int textured)
+{
+	const GeVertex* left = a->x <= b->x ? a : b;
+	const GeVertex* right = a->x <= b->x ? b : a;
+	const GeVertex* top = a->y <= b->y ? a : b;
+	const GeVertex* bottom = a->y <= b->y ? b : a;
+	int x0 = (int) ceilf(left->x - 0.5f), x1 = (int) ceilf(right->x - 0.5f);
+	int y0 = (int) ceilf(top->y - 0.5f), y1 = (int) ceilf(bottom->y - 0.5f);
+	float du = right->x > left->x ? (right->u - left->u) / (right->x - left->x) : 0.0f;
+	float dv = bottom->y > top->y ? (bottom->v - top->v) / (bottom->y - top->y) : 0.0f;
+	int x, y;
+	// sprites take the color of their second vertex
+	for (y = y0; y < y1; y++) {
+		float v = top->v + (y + 0.5f - top->y) * dv;
+		for (x = x0; x < x1; x++) {
+			float u = left->u + (x + 0.5f - left->x) * du;
+			plot(x, y, shade(b->color, u, v, textured));
+		}
+	}
+}
+
+static float edge(const GeVertex* a, const GeVertex* b, float x, float y)
+{
+	return (b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x);
+}
+
+/* Pixels exactly on an edge belong to one of the two triangles sharing it. */
+static int ownsEdge(const GeVertex* a, const GeVertex* b)
+{
+	float dx = b->x - a->x, dy = b->y - a->y;
+	return dy > 0 || (dy == 0 && dx < 0);
+}
+
+static u32 mix(u32 c0, u32 c1, u32 c2, float w0, float w1, float w2)
+{
+	u32 result = 0;
+	int shift;
+	for (shift = 0; shift < 32; shift += 8) {
+		float value = channel(c0, shift) * w0 + channel(c1, shift) * w1 + channel(c2, shift) * w2;
+		result |= (u32) MAX(0, MIN(255, (int) (value + 0.5f))) << shift;
+	}
+	return result;
+}
+
+static void drawTriangle(const GeVertex* v0, const GeVertex* v1, const GeVertex* v2, int textured)
+{
+	float area = edge(v0, v1, v2->x, v2->y);
+	int x0, y0, x1, y1, x, y;
+	int own0, own1, own2;
+
+	if (area == 0) return;
+	if (area < 0) {
+		const GeVertex* swap = v1;
+		v1 = v2;
+		v2 = swap;
+		area = -area;
+	}
+	own0 = ownsEdge(v1, v2);
+	own1 = ownsEdge(v2, v0);
+	own2 = ownsEdge(v0, v1);
+	x0 = (int) floorf(MIN(v0->x, MIN(v1->x, v2->x)));
+	y0 = (int) floorf(MIN(v0->y, MIN(v1->y, v2->y)));
+	x1 = (int) ceilf(MAX(v0->x, MAX(v1->x, v2->x)));
+	y1 = (int) ceilf(MAX(v0->y, MAX(v1->y, v2->y)));
+	for (y = y0; y <= y1; y++) {
+		for (x = x0; x <= x1; x++) {
+			float px = x + 0.5f, py = y + 0.5f;
+			float e0 = edge(v1, v2, px, py);
+			float e1 = edge(v2, v0, px, py);
+			float e2 = edge(v0, v1, px, py);
+			float w0, w1, w2;
+			if (e0 < 0 || e1 < 0 || e2 < 0) continue;
+			if ((e0 == 0 && !own0) || (e1 == 0 && !own1) || (e2 == 0 && !own2)) continue;
+			w0 = e0 / area;
+			w1 = e1 / area;
+			w2 = e2 / area;
+			plot(x, y, shade(mix(v0->color, v1->color, v2->color, w0, w1, w2),
+				v0->u * w0 + v1->u * w1 + v2->u * w2, v0->v * w0 + v1->v * w1 + v2->v * w2, textured));
+		}
+	}
+}
+
+static void drawLine(const GeVertex* a, const GeVertex* b, int first, int textured)
+{
+	int x0 = (int) floorf(a->x), y0 = (int) floorf(a->y);
+	int x1 = (int) floorf(b->x), y1 = (int) floorf(b->y);
+	int dx = abs(x1 - x0), dy = -abs(y1 - y0);
+	int stepX = x0 < x1 ? 1 : -1, stepY = y0 < y1 ? 1 : -1;
+	int error = dx + dy;
+	// strips share their joints, only the first segment draws its start
+	int skip = !first;
+	for (;;) {
+		int twice = 2 * error;
+		if (!skip) plot(x0, y0, shade(b->color, a->u, a->v, textured));
+		skip = 0;
+		if (x0 == x1 && y0 == y1) break;
+		if (twice >= dy) { error += dy; x0 += stepX; }
+		if (twice <= dx) { error += dx; y0 += stepY; }
+	}
+}
+
+static void draw(int prim, int vtype, int count, const u8* data)
+{
+	GeVertex vertices[3];
+	int textured = ge.enabled[GU_TEXTURE_2D] && (vtype & GU_TEXTURE_BITS) && ge.texture;
+	int i;
+	for (i = 0; i < count; i++) {
+		GeVertex vertex;
+		data += decodeVertex(data, vtype, &vertex);
+		switch (prim) {
+			case GU_POINTS:
+				plot((int) floorf(vertex.x), (int) floorf(vertex.y), shade(vertex.color, vertex.u, vertex.v, textured));
+				break;
+			case GU_LINES:
+				vertices[i & 1] = vertex;
+				if (i & 1) drawLine(&vertices[0], &vertices[1], 1, textured);
+				break;
+			case GU_LINE_STRIP:
+				vertices[1] = vertex;
+				if (i > 0) drawLine(&vertices[0], &vertices[1], i == 1, textured);
+				vertices[0] = vertex;
+				break;
+			case GU_TRIANGLES:
+				vertices[i % 3] = vertex;
+				if (i % 3 == 2) drawTriangle(&vertices[0], &vertices[1], &vertices[2], textured);
+				break;
+			case GU_TRIANGLE_STRIP:
+				vertices[MIN(i, 2)] = vertex;
+				if (i >= 2) {
+					drawTriangle(&vertices[0], &vertices[1], &vertices[2], textured);
+					vertices[0] = vertices[1];
+					vertices[1] = vertices[2];
+				}
+				break;
+			case GU_TRIANGLE_FAN:
+				vertices[i == 0 ? 0 : MIN(i, 2)] = vertex;
+				if (i >= 2) {
+					drawTriangle(&vertices[0], &vertices[1], &vertices[2], textured);
+					vertices[1] = vertices[2];
+				}
+				break;
+			case GU_SPRITES:
+				vertices[i & 1] = vertex;
+				if (i & 1) drawSprite(&vertices[0], &vertices[1], textured);
+				break;
+		}
+	}
+}
+
+static void copy(const HostGeCopy* c)
+{
+	int bytes = c->psm == GU_PSM_8888 ? 4 : 2;
+	int y;
+	for (y = 0; y < c->height; y++) {
+		memmove((u8*) c->destination + ((c->dy + y) * c->destinationStride + c->dx) * bytes,
+			(const u8*) c->source + ((c->sy + y) * c->sourceStride + c->sx) * bytes, c->width * bytes);
+	}
+}
+
+/* sceGuClear draws the screen sized by sceGuDispBuffer, clipped by the scissor. */
+static void clear(int flags, u32 color, int width, int height)
+{
+	int bytes = bitsOf(ge.psm) / 8;
+	u32 pixel = encodePixel(color, ge.psm);
+	int x, y;
+	if (!(flags & GU_COLOR_BUFFER_BIT)) return;
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			u8* address;
+			if (!inScissor(x, y)) continue;
+			address = pixelAddress(x, y, bytes);
+			if (!address) continue;
+			store(address, bytes, pixel);
+			fragments++;
+		}
+	}
+}
+
+int hostGeExecute(const u32* list)
+{
+	int start = fragments;
+	for (;;) {
+		u32 header = *list++;
+		const u8* args = (const u8*) list;
+		int a[5];
+		const void* pointer;
+		list += (HOST_GE_BYTES(header) + 3) / 4;
+		switch (HOST_GE_OP(header)) {
+			case HOST_GE_END:
+				return fragments - start;
+			case HOST_GE_DRAW_BUFFER:
+				memcpy(a, args, 3 * sizeof(int));
+				ge.psm = a[0];
+				ge.offset = a[1];
+				ge.width = a[2];
+				break;
+			case HOST_GE_ENABLE:
+				memcpy(a, args, 2 * sizeof(int));
+				if (a[0] >= 0 && a[0] < GU_MAX_STATUS) ge.enabled[a[0]] = a[1];
+				break;
+			case HOST_GE_SCISSOR:
+				memcpy(a, args, 4 * sizeof(int));
+				ge.scissorX0 = a[0];
+				ge.scissorY0 = a[1];
+				ge.scissorX1 = a[2];
+				ge.scissorY1 = a[3];
+				break;
+			case HOST_GE_ALPHA_FUNC:
+				memcpy(a, args, 3 * sizeof(int));
+				ge.alphaFunction = a[0];
+				ge.alphaReference = a[1];
+				ge.alphaMask = a[2];
+				break;
+			case HOST_GE_BLEND_FUNC:
+				memcpy(a, args, 5 * sizeof(int));
+				ge.blendOp = a[0];
+				ge.blendSource = a[1];
+				ge.blendDestination = a[2];
+				ge.blendSourceFix = a[3];
+				ge.blendDestinationFix = a[4];
+				break;
+			case HOST_GE_COLOR:
+				memcpy(&ge.material, args, sizeof(u32));
+				break;
+			case HOST_GE_TEX_MODE:
+				memcpy(a, args, 2 * sizeof(int));
+				ge.texturePsm = a[0];
+				ge.textureSwizzle = a[1];
+				break;
+			case HOST_GE_TEX_FUNC:
+				memcpy(a, args, 2 * sizeof(int));
+				ge.textureFunction = a[0];
+				ge.textureAlpha = a[1];
+				break;
+			case HOST_GE_TEX_IMAGE:
+				memcpy(a, args, 3 * sizeof(int));
+				memcpy(&pointer, args + 3 * sizeof(int), sizeof(pointer));
+				ge.textureWidth = a[0];
+				ge.textureHeight = a[1];
+				ge.textureStride = a[2];
+				ge.texture = (const u8*) pointer;
+				break;
+			case HOST_GE_TEX_SCALE:
+				memcpy(&ge.textureScaleU, args, sizeof(float));
+				memcpy(&ge.textureScaleV, args + sizeof(float), sizeof(float));
+				break;
+			case HOST_GE_TEX_OFFSET:
+				memcpy(&ge.textureOffsetU, args, sizeof(float));
+				memcpy(&ge.textureOffsetV, args + sizeof(float), sizeof(float));
+				break;
+			case HOST_GE_CLUT_MODE:
+				memcpy(a, args, 3 * sizeof(int));
+				ge.clutShift = a[1];
+				ge.clutMask = a[2];
+				break;
+			case HOST_GE_CLUT_LOAD:
+				memcpy(a, args, sizeof(int));
+				memcpy(&pointer, args + sizeof(int), sizeof(pointer));
+				memcpy(ge.clut, pointer, MIN(a[0] * 8, CLUT_ENTRIES) * sizeof(u32));
+				break;
+			case HOST_GE_MATRIX:
+				memcpy(a, args, sizeof(int));
+				if (a[0] >= GU_PROJECTION && a[0] <= GU_MODEL) memcpy(ge.matrices[a[0]], args + sizeof(int), 16 * sizeof(float));
+				break;
+			case HOST_GE_OFFSET:
+				memcpy(a, args, 2 * sizeof(int));
+				ge.offsetX = a[0];
+				ge.offsetY = a[1];
+				break;
+			case HOST_GE_VIEWPORT:
+				memcpy(a, args, 4 * sizeof(int));
+				ge.viewportX = a[0];
+				ge.viewportY = a[1];
+				ge.viewportWidth = a[2];
+				ge.viewportHeight = a[3];
+				break;
+			case HOST_GE_DRAW:
+				memcpy(a, args, 3 * sizeof(int));
+				memcpy(&pointer, args + 3 * sizeof(int), sizeof(pointer));
+				draw(a[0], a[1], a[2], (const u8*) pointer);
+				break;
+			case HOST_GE_COPY: {
+				HostGeCopy c;
+				memcpy(&c, args, sizeof(c));
+				copy(&c);
+				break;
+			}
+			case HOST_GE_CLEAR: {
+				u32 color;
+				memcpy(a, args, sizeof(int));
+				memcpy(&color, args + sizeof(int), sizeof(u32));
+				memcpy(a + 1, args + 2 * sizeof(int), 2 * sizeof(int));
+				clear(a[0], color, a[1], a[2]);
+				break;
+			}
+		}
+	}
+}
+
+void hostGeSetDisplay(const void* buffer, int stride, int psm)
+{
+	display.buffer = (const u8*) buffer;
+	display.stride = stride;
+	display.psm = psm;
+}
+
+int hostGeDumpDisplay(const char* filename)
+{
+	png_structp png_ptr;
+	png_infop info_ptr;
+	FILE* fp;
+	u8 line[DISPLAY_WIDTH * 3];
+	int bytes = bitsOf(display.psm) / 8;
+	int x, y;
+
+	if (!display.buffer) return 0;
+	if ((fp = fopen(filename, "wb")) == NULL) return 0;
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+	if (!info_ptr) {
+		png_destroy_write_struct(&png_ptr, NULL);
+		fclose(fp);
+		return 0;
+	}
+	png_init_io(png_ptr, fp);
+	png_set_compression_level(png_ptr, 1);
+	png_set_IHDR(png_ptr, info_ptr, DISPLAY_WIDTH, DISPLAY_HEIGHT, 8, PNG_COLOR_TYPE_RGB,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+	for (y = 0; y < DISPLAY_HEIGHT; y++) {
+		for (x = 0; x < DISPLAY_WIDTH; x++) {
+			u32 color = decodePixel(load(display.buffer + (y * display.stride + x) * bytes, bytes), display.psm);
+			line[3 * x] = color;
+			line[3 * x + 1] = color >> 8;
+			line[3 * x + 2] = color >> 16;
+		}
+		png_write_row(png_ptr, line);
+	}
+	png_write_end(png_ptr, info_ptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	return fclose(fp) == 0;
+}
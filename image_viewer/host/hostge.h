@@ -0,0 +1,76 @@
+#ifndef HOSTGE_H
+#define HOSTGE_H
+
+#include "psptypes.h"
+
+/*
+ * Display list format shared by the host sceGu* stand-ins, which record the lists, and
+ * the software GE, which runs them. Every command is a u32 header, the op in the low
+ * byte and the size of its arguments in bytes above it, followed by the arguments
+ * padded to 4 bytes.
+ */
+
+#define HOST_GE_HEADER(op, bytes) ((op) | ((bytes) << 8))
+#define HOST_GE_OP(header) ((header) & 0xff)
+#define HOST_GE_BYTES(header) ((header) >> 8)
+
+enum
+{
+	HOST_GE_END,  // end of the list
+	HOST_GE_SKIP,  // memory handed out by sceGuGetMemory
+	HOST_GE_DRAW_BUFFER,  // int psm, int offset, int width
+	HOST_GE_ENABLE,  // int state, int enabled
+	HOST_GE_SCISSOR,  // int x0, y0, x1, y1 with x1, y1 exclusive
+	HOST_GE_ALPHA_FUNC,  // int function, int reference, int mask
+	HOST_GE_BLEND_FUNC,  // int op, int source, int destination, u32 sourceFix, u32 destinationFix
+	HOST_GE_COLOR,  // u32 material color
+	HOST_GE_TEX_MODE,  // int psm, int swizzle
+	HOST_GE_TEX_FUNC,  // int function, int alpha
+	HOST_GE_TEX_IMAGE,  // int width, int height, int stride, const void* texels
+	HOST_GE_TEX_SCALE,  // float u, float v
+	HOST_GE_TEX_OFFSET,  // float u, float v
+	HOST_GE_CLUT_MODE,  // int psm, int shift, int mask
+	HOST_GE_CLUT_LOAD,  // int blocks, const void* palette
+	HOST_GE_MATRIX,  // int type, float matrix[16]
+	HOST_GE_OFFSET,  // int x, int y
+	HOST_GE_VIEWPORT,  // int x, int y, int width, int height
+	HOST_GE_DRAW,  // int prim, int vtype, int count, const void* vertices
+	HOST_GE_COPY,  // HostGeCopy
+	HOST_GE_CLEAR  // int flags, u32 color, int width, int height
+};
+
+typedef struct
+{
+	int psm;
+	int sx, sy, width, height, sourceStride;
+	const void* source;
+	int dx, dy, destinationStride;
+	void* destination;
+} HostGeCopy;
+
+/**
+ * Run a display list.
+ *
+ * @param list - start of the list, ended by HOST_GE_END
+ * @return number of pixels written
+ */
+extern int hostGeExecute(const u32* list);
+
+/**
+ * Show a frame buffer, like sceDisplaySetFrameBuf.
+ *
+ * @param buffer - start of the frame buffer
+ * @param stride - pixels per row
+ * @param psm - GU_PSM_* format of the pixels
+ */
+extern void hostGeSetDisplay(const void* buffer, int stride, int psm);
+
+/**
+ * Write the shown frame buffer to a PNG file.
+ *
+ * @param filename - name of the PNG file
+ * @return 1 if the file was written, 0 otherwise
+ */
+extern int hostGeDumpDisplay(const char* filename);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef HOSTGU_H
+#define HOSTGU_H
+
+/**
+ * Call counters kept by the host stand-in for the sceGu and sceDisplay calls.
+ * Only available in the host build (Makefile.host), which renders the display lists
+ * in software into an in-memory VRAM.
+ */
+typedef struct
+{
+	int lists;  // sceGuStart calls
+	int finishes;  // sceGuFinish calls
+	int sends;  // sceGuSendList calls
+	int syncs;  // waiting sceGuSync calls, i.e. CPU stalls on the GE
+	int polls;  // non-waiting sceGuSync calls
+	int drawCalls;  // sceGuDrawArray calls
+	int vertices;  // vertices submitted through sceGuDrawArray
+	int copies;  // sceGuCopyImage calls
+	int clears;  // sceGuClear calls
+	int textureBinds;  // sceGuTexImage calls
+	int swaps;  // sceGuSwapBuffers and sceDisplaySetFrameBuf calls
+	int listBytes;  // display list bytes consumed, including sceGuGetMemory
+	int fragments;  // pixels written by the software GE
+} HostGuCounters;
+
+/**
+ * Get the counters accumulated since the last reset.
+ *
+ * @return pointer to the live counters
+ */
+extern const HostGuCounters* hostGuGetCounters();
+
+/**
+ * Reset all counters to zero.
+ */
+extern void hostGuResetCounters();
+
+/**
+ * Print the counters to stdout.
+ *
+ * @param label - text printed in front of the counters
+ */
+extern void hostGuPrintCounters(const char* label);
+
+/**
+ * Write the frame buffer last shown with sceDisplaySetFrameBuf to a PNG file.
+ *
+ * @param filename - name of the PNG file
+ * @return 1 if the file was written, 0 otherwise
+ */
+extern int hostGuDumpFrame(const char* filename);
+
+/**
+ * Dump every frame shown from now on to a PNG file. sceGuInit sets the pattern from the
+ * HOST_GU_FRAME_DUMP environment variable if it is set.
+ *
+ * @param pattern - printf pattern of the file names, given the frame number, NULL to stop dumping
+ */
+extern void hostGuSetFrameDump(const char* pattern);
+
+/**
+ * Get the range of the last sceKernelDcacheWritebackRange call, e.g. to check which bytes
+ * of an image are written back for the GE.
+ *
+ * @param data - receives the start of the range, NULL before the first call
+ * @param size - receives the bytes of the range
+ */
+extern void hostGetLastWriteback(const void** data, int* size);
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOST_PSPDEBUG_H
+#define HOST_PSPDEBUG_H
+
+extern void pspDebugScreenInit(void);
+extern void pspDebugScreenPrintf(const char* format, ...);
+
+#endif
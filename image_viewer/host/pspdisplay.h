@@ -0,0 +1,20 @@
+#ifndef HOST_PSPDISPLAY_H
+#define HOST_PSPDISPLAY_H
+
+#include "psptypes.h"
+
+#define PSP_DISPLAY_PIXEL_FORMAT_565 0
+#define PSP_DISPLAY_PIXEL_FORMAT_5551 1
+#define PSP_DISPLAY_PIXEL_FORMAT_4444 2
+#define PSP_DISPLAY_PIXEL_FORMAT_8888 3
+
+#define PSP_DISPLAY_SETBUF_IMMEDIATE 0
+#define PSP_DISPLAY_SETBUF_NEXTFRAME 1
+
+extern int sceDisplayWaitVblankStart(void);
+extern int sceDisplayWaitVblank(void);
+extern int sceDisplayIsVblank(void);
+extern unsigned int sceDisplayGetVcount(void);
+extern int sceDisplaySetFrameBuf(void* topaddr, int bufferwidth, int pixelformat, int sync);
+
+#endif
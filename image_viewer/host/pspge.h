@@ -0,0 +1,19 @@
+#ifndef HOST_PSPGE_H
+#define HOST_PSPGE_H
+
+#include "psptypes.h"
+
+#define HOST_EDRAM_SIZE (2 * 1024 * 1024)
+
+typedef struct PspGeContext
+{
+	unsigned int context[512];
+} PspGeContext;
+
+/** In-memory stand-in for the 2MB of PSP eDRAM. */
+extern u8 host_vram[HOST_EDRAM_SIZE];
+
+extern void* sceGeEdramGetAddr(void);
+extern u32 sceGeEdramGetSize(void);
+
+#endif
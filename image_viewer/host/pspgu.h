@@ -0,0 +1,219 @@
+#ifndef HOST_PSPGU_H
+#define HOST_PSPGU_H
+
+#include "psptypes.h"
+#include "pspge.h"
+
+/* Primitive types */
+#define GU_POINTS (0)
+#define GU_LINES (1)
+#define GU_LINE_STRIP (2)
+#define GU_TRIANGLES (3)
+#define GU_TRIANGLE_STRIP (4)
+#define GU_TRIANGLE_FAN (5)
+#define GU_SPRITES (6)
+
+/* States */
+#define GU_ALPHA_TEST (0)
+#define GU_DEPTH_TEST (1)
+#define GU_SCISSOR_TEST (2)
+#define GU_STENCIL_TEST (3)
+#define GU_BLEND (4)
+#define GU_CULL_FACE (5)
+#define GU_DITHER (6)
+#define GU_FOG (7)
+#define GU_CLIP_PLANES (8)
+#define GU_TEXTURE_2D (9)
+#define GU_LIGHTING (10)
+#define GU_MAX_STATUS (22)
+
+/* Matrix modes */
+#define GU_PROJECTION (0)
+#define GU_VIEW (1)
+#define GU_MODEL (2)
+#define GU_TEXTURE (3)
+
+/* Vertex declarations */
+#define GU_TEXTURE_SHIFT(n) ((n)<<0)
+#define GU_TEXTURE_8BIT GU_TEXTURE_SHIFT(1)
+#define GU_TEXTURE_16BIT GU_TEXTURE_SHIFT(2)
+#define GU_TEXTURE_32BITF GU_TEXTURE_SHIFT(3)
+#define GU_TEXTURE_BITS GU_TEXTURE_SHIFT(3)
+
+#define GU_COLOR_SHIFT(n) ((n)<<2)
+#define GU_COLOR_5650 GU_COLOR_SHIFT(4)
+#define GU_COLOR_5551 GU_COLOR_SHIFT(5)
+#define GU_COLOR_4444 GU_COLOR_SHIFT(6)
+#define GU_COLOR_8888 GU_COLOR_SHIFT(7)
+#define GU_COLOR_BITS GU_COLOR_SHIFT(7)
+
+#define GU_VERTEX_SHIFT(n) ((n)<<7)
+#define GU_VERTEX_8BIT GU_VERTEX_SHIFT(1)
+#define GU_VERTEX_16BIT GU_VERTEX_SHIFT(2)
+#define GU_VERTEX_32BITF GU_VERTEX_SHIFT(3)
+#define GU_VERTEX_BITS GU_VERTEX_SHIFT(3)
+
+#define GU_TRANSFORM_SHIFT(n) ((n)<<23)
+#define GU_TRANSFORM_3D GU_TRANSFORM_SHIFT(0)
+#define GU_TRANSFORM_2D GU_TRANSFORM_SHIFT(1)
+#define GU_TRANSFORM_BITS GU_TRANSFORM_SHIFT(1)
+
+/* Pixel formats */
+#define GU_PSM_5650 (0)
+#define GU_PSM_5551 (1)
+#define GU_PSM_4444 (2)
+#define GU_PSM_8888 (3)
+#define GU_PSM_T4 (4)
+#define GU_PSM_T8 (5)
+#define GU_PSM_T16 (6)
+#define GU_PSM_T32 (7)
+
+/* Shading */
+#define GU_FLAT (0)
+#define GU_SMOOTH (1)
+
+/* Front face */
+#define GU_CW (0)
+#define GU_CCW (1)
+
+/* Test functions */
+#define GU_NEVER (0)
+#define GU_ALWAYS (1)
+#define GU_EQUAL (2)
+#define GU_NOTEQUAL (3)
+#define GU_LESS (4)
+#define GU_LEQUAL (5)
+#define GU_GREATER (6)
+#define GU_GEQUAL (7)
+
+/* Clear buffer mask */
+#define GU_COLOR_BUFFER_BIT (1)
+#define GU_STENCIL_BUFFER_BIT (2)
+#define GU_DEPTH_BUFFER_BIT (4)
+#define GU_FAST_CLEAR_BIT (16)
+
+/* Texture filter */
+#define GU_NEAREST (0)
+#define GU_LINEAR (1)
+
+/* Texture effect */
+#define GU_TFX_MODULATE (0)
+#define GU_TFX_DECAL (1)
+#define GU_TFX_BLEND (2)
+#define GU_TFX_REPLACE (3)
+#define GU_TFX_ADD (4)
+
+/* Texture color component */
+#define GU_TCC_RGB (0)
+#define GU_TCC_RGBA (1)
+
+/* Blending op */
+#define GU_ADD (0)
+#define GU_SUBTRACT (1)
+#define GU_REVERSE_SUBTRACT (2)
+#define GU_MIN (3)
+#define GU_MAX (4)
+#define GU_ABS (5)
+
+/* Blending factor */
+#define GU_SRC_COLOR (0)
+#define GU_ONE_MINUS_SRC_COLOR (1)
+#define GU_SRC_ALPHA (2)
+#define GU_ONE_MINUS_SRC_ALPHA (3)
+#define GU_DST_ALPHA (4)
+#define GU_ONE_MINUS_DST_ALPHA (5)
+#define GU_DST_COLOR (0)
+#define GU_ONE_MINUS_DST_COLOR (1)
+#define GU_FIX (10)
+
+/* Boolean */
+#define GU_FALSE (0)
+#define GU_TRUE (1)
+
+/* List contexts */
+#define GU_DIRECT (0)
+#define GU_CALL (1)
+#define GU_SEND (2)
+
+/* List queue */
+#define GU_TAIL (0)
+#define GU_HEAD (1)
+
+/* Sync behavior (mode) */
+#define GU_SYNC_FINISH (0)
+#define GU_SYNC_SIGNAL (1)
+#define GU_SYNC_DONE (2)
+#define GU_SYNC_LIST (3)
+#define GU_SYNC_SEND (4)
+
+/* Sync behavior (what) */
+#define GU_SYNC_WAIT (0)
+#define GU_SYNC_NOWAIT (1)
+
+/* Sync behavior (what) [see sceGuSync()] */
+#define GU_SYNC_WHAT_DONE (0)
+#define GU_SYNC_WHAT_QUEUED (1)
+#define GU_SYNC_WHAT_DRAW (2)
+#define GU_SYNC_WHAT_STALL (3)
+#define GU_SYNC_WHAT_CANCEL (4)
+
+typedef struct ScePspFVector3
+{
+	float x, y, z;
+} ScePspFVector3;
+
+typedef struct ScePspFMatrix4
+{
+	float x[4], y[4], z[4], w[4];
+} ScePspFMatrix4;
+
+extern void sceGuInit(void);
+extern void sceGuTerm(void);
+extern void sceGuStart(int cid, void* list);
+extern int sceGuFinish(void);
+extern int sceGuSync(int mode, int what);
+extern void* sceGuGetMemory(int size);
+extern int sceGuCheckList(void);
+extern void sceGuSendList(int mode, const void* list, PspGeContext* context);
+
+extern void sceGuDrawBuffer(int psm, void* fbp, int fbw);
+extern void sceGuDrawBufferList(int psm, void* fbp, int fbw);
+extern void sceGuDispBuffer(int width, int height, void* dispbp, int dispbw);
+extern void sceGuDepthBuffer(void* zbp, int zbw);
+extern void* sceGuSwapBuffers(void);
+extern int sceGuDisplay(int state);
+
+extern void sceGuClear(int flags);
+extern void sceGuClearColor(unsigned int color);
+extern void sceGuClearDepth(unsigned int depth);
+extern void sceGuOffset(unsigned int x, unsigned int y);
+extern void sceGuViewport(int cx, int cy, int width, int height);
+extern void sceGuDepthRange(int near, int far);
+extern void sceGuScissor(int x, int y, int w, int h);
+extern void sceGuEnable(int state);
+extern void sceGuDisable(int state);
+extern void sceGuAlphaFunc(int a0, int a1, int a2);
+extern void sceGuDepthFunc(int function);
+extern void sceGuFrontFace(int order);
+extern void sceGuShadeModel(int mode);
+extern void sceGuAmbientColor(unsigned int color);
+extern void sceGuColor(unsigned int color);
+extern void sceGuBlendFunc(int op, int src, int dest, unsigned int srcfix, unsigned int destfix);
+
+extern void sceGuTexMode(int tpsm, int maxmips, int a2, int swizzle);
+extern void sceGuTexFunc(int tfx, int tcc);
+extern void sceGuTexFilter(int min, int mag);
+extern void sceGuTexImage(int mipmap, int width, int height, int tbw, const void* tbp);
+extern void sceGuTexScale(float u, float v);
+extern void sceGuTexOffset(float u, float v);
+extern void sceGuTexFlush(void);
+extern void sceGuTexSync(void);
+extern void sceGuClutMode(unsigned int cpsm, unsigned int shift, unsigned int mask, unsigned int a3);
+extern void sceGuClutLoad(int num_blocks, const void* cbp);
+
+extern void sceGuSetMatrix(int type, const ScePspFMatrix4* matrix);
+extern void sceGuDrawArray(int prim, int vtype, int count, const void* indices, const void* vertices);
+extern void sceGuCopyImage(int psm, int sx, int sy, int width, int height, int srcw, void* src,
+	int dx, int dy, int destw, void* dest);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef HOST_PSPIOFILEMGR_H
+#define HOST_PSPIOFILEMGR_H
+
+#include "psptypes.h"
+
+#define PSP_O_RDONLY 0x0001
+#define PSP_O_WRONLY 0x0002
+#define PSP_O_RDWR (PSP_O_RDONLY | PSP_O_WRONLY)
+#define PSP_O_CREAT 0x0200
+#define PSP_O_TRUNC 0x0400
+
+#define PSP_SEEK_SET 0
+#define PSP_SEEK_CUR 1
+#define PSP_SEEK_END 2
+
+typedef s64 SceOff;
+
+extern SceUID sceIoOpen(const char* file, int flags, int mode);
+extern int sceIoClose(SceUID fd);
+extern int sceIoRead(SceUID fd, void* data, SceSize size);
+extern int sceIoWrite(SceUID fd, const void* data, SceSize size);
+extern SceOff sceIoLseek(SceUID fd, SceOff offset, int whence);
+
+#endif
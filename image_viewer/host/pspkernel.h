@@ -0,0 +1,31 @@
+#ifndef HOST_PSPKERNEL_H
+#define HOST_PSPKERNEL_H
+
+#include "psptypes.h"
+#include "psputils.h"
+
+#define PSP_MODULE_INFO(name, attributes, major_version, minor_version)
+#define PSP_MAIN_THREAD_ATTR(attr)
+#define THREAD_ATTR_USER 0x80000000
+#define THREAD_ATTR_VFPU 0x00004000
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void* argp);
+typedef int (*SceKernelCallbackFunction)(int arg1, int arg2, void* arg);
+
+extern int sceKernelCreateCallback(const char* name, SceKernelCallbackFunction func, void* arg);
+extern int sceKernelRegisterExitCallback(int cbid);
+extern int sceKernelSleepThread(void);
+extern int sceKernelSleepThreadCB(void);
+extern SceUID sceKernelCreateThread(const char* name, SceKernelThreadEntry entry, int initPriority,
+	int stackSize, SceUInt attr, void* option);
+extern int sceKernelStartThread(SceUID thid, SceSize arglen, void* argp);
+extern SceUID sceKernelGetThreadId(void);
+extern int sceKernelDelayThread(SceUInt delay);
+extern SceUID sceKernelCreateSema(const char* name, SceUInt attr, int initVal, int maxVal, void* option);
+extern int sceKernelDeleteSema(SceUID semaid);
+extern int sceKernelWaitSema(SceUID semaid, int signal, SceUInt* timeout);
+extern int sceKernelSignalSema(SceUID semaid, int signal);
+extern unsigned int sceKernelGetSystemTimeLow(void);
+extern void sceKernelExitGame(void);
+
+#endif
@@ -0,0 +1,559 @@
+/*
+ * Host (Linux) stand-in for the PSP SDK calls used by the image viewer.
+ *
+ * The sceGu* functions record their commands into the display list passed to
+ * sceGuStart, with sceGuGetMemory handing out memory from the same list as on the
+ * target. The lists are rendered into host_vram by the software GE in hostge.c when
+ * they are finished (direct lists) or sent, and every call is counted.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pspgu.h"
+#include "pspge.h"
+#include "pspdisplay.h"
+#include "pspkernel.h"
+#include "pspdebug.h"
+#include "pspctrl.h"
+#include "pspiofilemgr.h"
+#include "hostgu.h"
+#include "hostge.h"
+
+#define HOST_MAX_THREADS 16
+#define HOST_MAX_SEMAS 16
+#define HOST_VBLANK_MICROS 16683  // 59.94 Hz
+#define HOST_VBLANK_LENGTH_MICROS 850  // 14 of 286 lines
+
+u8 host_vram[HOST_EDRAM_SIZE] __attribute__((aligned(16)));
+
+/* The target links the 8x8 font from libpspdebug, the host gets blank glyphs. */
+u8 msx[256 * 8];
+
+static HostGuCounters counters;
+static const void* lastWriteback;
+static int lastWritebackSize;
+static u8* listStart;
+static u8* listCurrent;
+static int listContext;
+
+/* sceGu context, kept out of the lists like on the target */
+static unsigned int clearColor;
+static int drawPsm = GU_PSM_8888;
+static int screenWidth = 480, screenHeight = 272;
+static int displayOffset, displayWidth = 512;
+
+static const char* frameDumpPattern;
+static int frameDumpCount;
+
+/* Kernel threads run as pthreads, priorities are ignored. */
+typedef struct
+{
+	SceKernelThreadEntry entry;
+	SceSize arglen;
+	void* argp;  // copy of the start arguments, like the kernel copies them to the thread's stack
+} HostThread;
+
+typedef struct
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t signaled;
+	int count;
+	int max;
+	int used;  // 0 once deleted, the slot is then taken by the next semaphore
+} HostSema;
+
+static HostThread threads[HOST_MAX_THREADS];
+static int threadCount;
+static __thread SceUID currentThread = HOST_MAX_THREADS;  // ids past the created threads' are the main thread's
+static HostSema semas[HOST_MAX_SEMAS];
+static int semaCount;
+
+static void record(int op, const void* args, int size)
+{
+	u32 header = HOST_GE_HEADER(op, size);
+	memcpy(listCurrent, &header, sizeof(header));
+	if (size > 0) memcpy(listCurrent + sizeof(header), args, size);
+	size = sizeof(header) + ((size + 3) & ~3);
+	listCurrent += size;
+	counters.listBytes += size;
+}
+
+static void recordInts(int op, int count, ...)
+{
+	int args[5];
+	int i;
+	va_list list;
+	va_start(list, count);
+	for (i = 0; i < count; i++) args[i] = va_arg(list, int);
+	va_end(list);
+	record(op, args, count * sizeof(int));
+}
+
+/* Pointers are recorded in the list as they are, after the ints in front of them. */
+static void recordPointer(int op, const int* args, int count, const void* pointer)
+{
+	u8 buffer[4 * sizeof(int) + sizeof(void*)];
+	memcpy(buffer, args, count * sizeof(int));
+	memcpy(buffer + count * sizeof(int), &pointer, sizeof(pointer));
+	record(op, buffer, count * sizeof(int) + sizeof(pointer));
+}
+
+static void execute(const void* list)
+{
+	counters.fragments += hostGeExecute((const u32*) list);
+}
+
+const HostGuCounters* hostGuGetCounters()
+{
+	return &counters;
+}
+
+void hostGuResetCounters()
+{
+	memset(&counters, 0, sizeof(counters));
+}
+
+void hostGuPrintCounters(const char* label)
+{
+	printf("%s: lists=%d finishes=%d sends=%d syncs=%d polls=%d drawCalls=%d vertices=%d copies=%d clears=%d "
+		"textureBinds=%d swaps=%d listBytes=%d fragments=%d\n",
+		label, counters.lists, counters.finishes, counters.sends, counters.syncs, counters.polls, counters.drawCalls,
+		counters.vertices, counters.copies, counters.clears, counters.textureBinds,
+		counters.swaps, counters.listBytes, counters.fragments);
+}
+
+int hostGuDumpFrame(const char* filename)
+{
+	return hostGeDumpDisplay(filename);
+}
+
+void hostGuSetFrameDump(const char* pattern)
+{
+	frameDumpPattern = pattern;
+	frameDumpCount = 0;
+}
+
+static void printCountersAtExit()
+{
+	hostGuPrintCounters("gu");
+}
+
+void* sceGeEdramGetAddr(void) { return host_vram; }
+u32 sceGeEdramGetSize(void) { return HOST_EDRAM_SIZE; }
+
+void sceGuInit(void)
+{
+	static int registered = 0;
+	if (!registered) {
+		atexit(printCountersAtExit);
+		if (getenv("HOST_GU_FRAME_DUMP")) hostGuSetFrameDump(getenv("HOST_GU_FRAME_DUMP"));
+	}
+	registered = 1;
+}
+
+void sceGuTerm(void) {}
+
+void sceGuStart(int cid, void* list)
+{
+	listStart = (u8*) list;
+	listCurrent = listStart;
+	listContext = cid;
+	counters.lists++;
+}
+
+/* Direct lists run when they are finished, sent lists when they are sent. */
+int sceGuFinish(void)
+{
+	record(HOST_GE_END, NULL, 0);
+	counters.finishes++;
+	if (listContext == GU_DIRECT) execute(listStart);
+	return (int) (listCurrent - listStart);
+}
+
+/* Lists are complete as soon as they are finished, the host has no GE running behind the CPU. */
+int sceGuSync(int mode, int what)
+{
+	if (what == GU_SYNC_NOWAIT) counters.polls++;
+	else counters.syncs++;
+	return 0;
+}
+
+void sceGuSendList(int mode, const void* list, PspGeContext* context)
+{
+	counters.sends++;
+	execute(list);
+}
+
+/* The memory is skipped over when the list runs, like the jump the target emits. */
+void* sceGuGetMemory(int size)
+{
+	u32 header;
+	void* memory;
+	size = (size + 3) & ~3;
+	header = HOST_GE_HEADER(HOST_GE_SKIP, size);
+	memcpy(listCurrent, &header, sizeof(header));
+	memory = listCurrent + sizeof(header);
+	listCurrent += sizeof(header) + size;
+	counters.listBytes += sizeof(header) + size;
+	return memory;
+}
+
+int sceGuCheckList(void)
+{
+	return (int) (listCurrent - listStart);
+}
+
+void sceGuDrawBuffer(int psm, void* fbp, int fbw)
+{
+	drawPsm = psm;
+	recordInts(HOST_GE_DRAW_BUFFER, 3, psm, (int) (uintptr_t) fbp, fbw);
+}
+
+void sceGuDrawBufferList(int psm, void* fbp, int fbw)
+{
+	recordInts(HOST_GE_DRAW_BUFFER, 3, psm, (int) (uintptr_t) fbp, fbw);
+}
+
+void sceGuDispBuffer(int width, int height, void* dispbp, int dispbw)
+{
+	screenWidth = width;
+	screenHeight = height;
+	displayOffset = (int) (uintptr_t) dispbp;
+	displayWidth = dispbw;
+}
+
+void sceGuDepthBuffer(void* zbp, int zbw) {}
+
+/* graphics.c flips with sceDisplaySetFrameBuf, the host does not track the draw buffer for sceGuSwapBuffers. */
+void* sceGuSwapBuffers(void)
+{
+	counters.swaps++;
+	return NULL;
+}
+
+int sceGuDisplay(int state)
+{
+	if (state) sceDisplaySetFrameBuf(host_vram + displayOffset, displayWidth, drawPsm, PSP_DISPLAY_SETBUF_NEXTFRAME);
+	return state;
+}
+
+void sceGuClear(int flags)
+{
+	u8 args[4 * sizeof(int)];
+	int size[2] = { screenWidth, screenHeight };
+	memcpy(args, &flags, sizeof(int));
+	memcpy(args + sizeof(int), &clearColor, sizeof(u32));
+	memcpy(args + 2 * sizeof(int), size, sizeof(size));
+	record(HOST_GE_CLEAR, args, sizeof(args));
+	counters.clears++;
+}
+
+void sceGuClearColor(unsigned int color) { clearColor = color; }
+void sceGuClearDepth(unsigned int depth) {}
+void sceGuOffset(unsigned int x, unsigned int y) { recordInts(HOST_GE_OFFSET, 2, (int) x, (int) y); }
+void sceGuViewport(int cx, int cy, int width, int height) { recordInts(HOST_GE_VIEWPORT, 4, cx, cy, width, height); }
+void sceGuDepthRange(int near, int far) {}
+void sceGuScissor(int x, int y, int w, int h) { recordInts(HOST_GE_SCISSOR, 4, x, y, w, h); }
+void sceGuEnable(int state) { recordInts(HOST_GE_ENABLE, 2, state, 1); }
+void sceGuDisable(int state) { recordInts(HOST_GE_ENABLE, 2, state, 0); }
+void sceGuAlphaFunc(int a0, int a1, int a2) { recordInts(HOST_GE_ALPHA_FUNC, 3, a0, a1, a2); }
+void sceGuDepthFunc(int function) {}
+void sceGuFrontFace(int order) {}
+void sceGuShadeModel(int mode) {}
+void sceGuAmbientColor(unsigned int color) {}
+void sceGuColor(unsigned int color) { record(HOST_GE_COLOR, &color, sizeof(color)); }
+
+void sceGuBlendFunc(int op, int src, int dest, unsigned int srcfix, unsigned int destfix)
+{
+	recordInts(HOST_GE_BLEND_FUNC, 5, op, src, dest, (int) srcfix, (int) destfix);
+}
+
+void sceGuTexMode(int tpsm, int maxmips, int a2, int swizzle) { recordInts(HOST_GE_TEX_MODE, 2, tpsm, swizzle); }
+void sceGuTexFunc(int tfx, int tcc) { recordInts(HOST_GE_TEX_FUNC, 2, tfx, tcc); }
+void sceGuTexFilter(int min, int mag) {}
+
+void sceGuTexImage(int mipmap, int width, int height, int tbw, const void* tbp)
+{
+	int args[3] = { width, height, tbw };
+	recordPointer(HOST_GE_TEX_IMAGE, args, 3, tbp);
+	counters.textureBinds++;
+}
+
+void sceGuTexScale(float u, float v)
+{
+	float args[2] = { u, v };
+	record(HOST_GE_TEX_SCALE, args, sizeof(args));
+}
+
+void sceGuTexOffset(float u, float v)
+{
+	float args[2] = { u, v };
+	record(HOST_GE_TEX_OFFSET, args, sizeof(args));
+}
+
+void sceGuTexFlush(void) {}
+void sceGuTexSync(void) {}
+
+void sceGuClutMode(unsigned int cpsm, unsigned int shift, unsigned int mask, unsigned int a3)
+{
+	recordInts(HOST_GE_CLUT_MODE, 3, (int) cpsm, (int) shift, (int) mask);
+}
+
+void sceGuClutLoad(int num_blocks, const void* cbp)
+{
+	recordPointer(HOST_GE_CLUT_LOAD, &num_blocks, 1, cbp);
+}
+
+void sceGuSetMatrix(int type, const ScePspFMatrix4* matrix)
+{
+	u8 args[sizeof(int) + 16 * sizeof(float)];
+	memcpy(args, &type, sizeof(int));
+	memcpy(args + sizeof(int), matrix, 16 * sizeof(float));
+	record(HOST_GE_MATRIX, args, sizeof(args));
+}
+
+void sceGuDrawArray(int prim, int vtype, int count, const void* indices, const void* vertices)
+{
+	int args[3] = { prim, vtype, count };
+	recordPointer(HOST_GE_DRAW, args, 3, vertices);
+	counters.drawCalls++;
+	counters.vertices += count;
+}
+
+void sceGuCopyImage(int psm, int sx, int sy, int width, int height, int srcw, void* src,
+	int dx, int dy, int destw, void* dest)
+{
+	HostGeCopy copy = { psm, sx, sy, width, height, srcw, src, dx, dy, destw, dest };
+	record(HOST_GE_COPY, &copy, sizeof(copy));
+	counters.copies++;
+}
+
+/* The host display runs on the monotonic clock, vblank starts every HOST_VBLANK_MICROS. */
+static unsigned long long hostMicros()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000ull + now.tv_nsec / 1000;
+}
+
+unsigned int sceDisplayGetVcount(void)
+{
+	return (unsigned int) (hostMicros() / HOST_VBLANK_MICROS);
+}
+
+int sceDisplayIsVblank(void)
+{
+	return hostMicros() % HOST_VBLANK_MICROS < HOST_VBLANK_LENGTH_MICROS;
+}
+
+int sceDisplayWaitVblankStart(void)
+{
+	unsigned long long now = hostMicros();
+	unsigned long long wait = HOST_VBLANK_MICROS - now % HOST_VBLANK_MICROS;
+	struct timespec delay = { 0, (long) (wait * 1000) };
+	nanosleep(&delay, NULL);
+	return 0;
+}
+
+int sceDisplayWaitVblank(void)
+{
+	if (sceDisplayIsVblank()) return 0;
+	return sceDisplayWaitVblankStart();
+}
+
+/* The frame is shown at once, whether the target would wait for the vblank or not. */
+int sceDisplaySetFrameBuf(void* topaddr, int bufferwidth, int pixelformat, int sync)
+{
+	counters.swaps++;
+	hostGeSetDisplay(topaddr, bufferwidth, pixelformat);
+	if (frameDumpPattern) {
+		char filename[256];
+		snprintf(filename, sizeof(filename), frameDumpPattern, frameDumpCount++);
+		hostGeDumpDisplay(filename);
+	}
+	return 0;
+}
+
+void sceKernelDcacheWritebackAll(void) {}
+void sceKernelDcacheWritebackInvalidateAll(void) {}
+void sceKernelDcacheWritebackRange(const void* p, unsigned int size)
+{
+	lastWriteback = p;
+	lastWritebackSize = size;
+}
+
+void hostGetLastWriteback(const void** data, int* size)
+{
+	*data = lastWriteback;
+	*size = lastWritebackSize;
+}
+void sceKernelDcacheWritebackInvalidateRange(const void* p, unsigned int size) {}
+void sceKernelDcacheInvalidateRange(const void* p, unsigned int size) {}
+
+int sceKernelCreateCallback(const char* name, SceKernelCallbackFunction func, void* arg) { return 1; }
+int sceKernelRegisterExitCallback(int cbid) { return 0; }
+
+/* There is no HOME button to wait for on the host, sleeping threads return at once. */
+int sceKernelSleepThread(void) { return 0; }
+int sceKernelSleepThreadCB(void) { return 0; }
+
+SceUID sceKernelCreateThread(const char* name, SceKernelThreadEntry entry, int initPriority,
+	int stackSize, SceUInt attr, void* option)
+{
+	if (threadCount == HOST_MAX_THREADS) return -1;
+	threads[threadCount].entry = entry;
+	return threadCount++;
+}
+
+static void* runThread(void* argument)
+{
+	HostThread* thread = (HostThread*) argument;
+	currentThread = thread - threads;
+	thread->entry(thread->arglen, thread->argp);
+	return NULL;
+}
+
+int sceKernelStartThread(SceUID thid, SceSize arglen, void* argp)
+{
+	pthread_t handle;
+	HostThread* thread;
+	if (thid < 0 || thid >= threadCount) return -1;
+	thread = &threads[thid];
+	thread->arglen = arglen;
+	thread->argp = NULL;
+	if (arglen > 0) {
+		thread->argp = malloc(arglen);
+		memcpy(thread->argp, argp, arglen);
+	}
+	if (pthread_create(&handle, NULL, runThread, thread) != 0) return -1;
+	pthread_detach(handle);
+	return 0;
+}
+
+int sceKernelDelayThread(SceUInt delay)
+{
+	usleep(delay);
+	return 0;
+}
+
+SceUID sceKernelGetThreadId(void)
+{
+	return currentThread;
+}
+
+SceUID sceKernelCreateSema(const char* name, SceUInt attr, int initVal, int maxVal, void* option)
+{
+	HostSema* sema;
+	SceUID id;
+	for (id = 0; id < HOST_MAX_SEMAS && semas[id].used; id++);
+	if (id == HOST_MAX_SEMAS) return -1;
+	sema = &semas[id];
+	pthread_mutex_init(&sema->mutex, NULL);
+	pthread_cond_init(&sema->signaled, NULL);
+	sema->count = initVal;
+	sema->max = maxVal;
+	sema->used = 1;
+	if (id >= semaCount) semaCount = id + 1;
+	return id;
+}
+
+int sceKernelDeleteSema(SceUID semaid)
+{
+	HostSema* sema;
+	if (semaid < 0 || semaid >= semaCount || !semas[semaid].used) return -1;
+	sema = &semas[semaid];
+	pthread_mutex_destroy(&sema->mutex);
+	pthread_cond_destroy(&sema->signaled);
+	sema->used = 0;
+	return 0;
+}
+
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt* timeout)
+{
+	HostSema* sema;
+	if (semaid < 0 || semaid >= semaCount || !semas[semaid].used) return -1;
+	sema = &semas[semaid];
+	pthread_mutex_lock(&sema->mutex);
+	while (sema->count < signal) pthread_cond_wait(&sema->signaled, &sema->mutex);
+	sema->count -= signal;
+	pthread_mutex_unlock(&sema->mutex);
+	return 0;
+}
+
+int sceKernelSignalSema(SceUID semaid, int signal)
+{
+	HostSema* sema;
+	if (semaid < 0 || semaid >= semaCount || !semas[semaid].used) return -1;
+	sema = &semas[semaid];
+	pthread_mutex_lock(&sema->mutex);
+	if (sema->count + signal > sema->max) {
+		pthread_mutex_unlock(&sema->mutex);
+		return -1;
+	}
+	sema->count += signal;
+	pthread_cond_broadcast(&sema->signaled);
+	pthread_mutex_unlock(&sema->mutex);
+	return 0;
+}
+
+unsigned int sceKernelGetSystemTimeLow(void)
+{
+	return (unsigned int) hostMicros();
+}
+
+/* File descriptors are passed through, the PSP_O_* flags are translated. */
+SceUID sceIoOpen(const char* file, int flags, int mode)
+{
+	int access = (flags & PSP_O_RDWR) == PSP_O_RDWR ? O_RDWR : (flags & PSP_O_WRONLY) ? O_WRONLY : O_RDONLY;
+	if (flags & PSP_O_CREAT) access |= O_CREAT;
+	if (flags & PSP_O_TRUNC) access |= O_TRUNC;
+	return open(file, access, mode);
+}
+
+int sceIoClose(SceUID fd)
+{
+	return close(fd);
+}
+
+int sceIoRead(SceUID fd, void* data, SceSize size)
+{
+	return (int) read(fd, data, size);
+}
+
+int sceIoWrite(SceUID fd, const void* data, SceSize size)
+{
+	return (int) write(fd, data, size);
+}
+
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence)
+{
+	return lseek(fd, offset, whence == PSP_SEEK_END ? SEEK_END : whence == PSP_SEEK_CUR ? SEEK_CUR : SEEK_SET);
+}
+
+void sceKernelExitGame(void)
+{
+	exit(0);
+}
+
+void pspDebugScreenInit(void) {}
+
+void pspDebugScreenPrintf(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
+
+int sceCtrlPeekBufferPositive(SceCtrlData* pad_data, int count)
+{
+	memset(pad_data, 0, sizeof(SceCtrlData));
+	return count;
+}
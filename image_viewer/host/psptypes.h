@@ -0,0 +1,21 @@
+#ifndef HOST_PSPTYPES_H
+#define HOST_PSPTYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef unsigned int SceSize;
+typedef int SceUID;
+typedef unsigned int SceUInt;
+typedef int SceInt32;
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef HOST_PSPUTILS_H
+#define HOST_PSPUTILS_H
+
+#include "psptypes.h"
+
+extern void sceKernelDcacheWritebackAll(void);
+extern void sceKernelDcacheWritebackInvalidateAll(void);
+extern void sceKernelDcacheWritebackRange(const void* p, unsigned int size);
+extern void sceKernelDcacheWritebackInvalidateRange(const void* p, unsigned int size);
+extern void sceKernelDcacheInvalidateRange(const void* p, unsigned int size);
+
+#endif
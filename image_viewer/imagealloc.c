@@ -0,0 +1,415 @@
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <pspkernel.h>
+
+#include "imagealloc.h"
+
+#define HEADER_SIZE 16  // in front of large and arena blocks, keeps them 16 byte aligned
+#define PAGE_HEADER_SIZE ((sizeof(SlabPage) + 15) & ~15)
+
+/* Heap block of a slab page, its blocks follow the header. */
+typedef struct
+{
+	int sizeClass;
+	int usedBlocks;
+	void* freeBlocks;  // list linked through the first word of each free block
+	u16 waste[IMAGE_SLAB_PAGE_SIZE / IMAGE_SLAB_MIN_BLOCK];  // of each used block, its class size minus the size asked for
+} SlabPage;
+
+/* In front of large and arena blocks, slab blocks are told by their page. */
+typedef struct
+{
+	u32 size;  // bytes of the block including this header
+	u32 waste;  // bytes of large blocks beyond the size asked for
+	u32 reserved[2];
+} BlockHeader;
+
+static SlabPage* pages[IMAGE_SLAB_MAX_PAGES];  // pages holding blocks, taken from the heap as needed
+static int pageCount;
+static SlabPage* sparePage;  // the last emptied page, kept so a class going empty and back does not hit the heap
+static BlockHeader* largePool[IMAGE_LARGE_POOL_BLOCKS];  // freed large blocks kept for reuse
+static int largePoolCount;
+static ImageArena* arenas[IMAGE_MAX_ARENAS];
+static ImageArena* currentArena;
+static ImageAllocStats stats;
+static SceUID allocLock = -1;
+
+void initImageAllocator()
+{
+	if (allocLock < 0) allocLock = sceKernelCreateSema("image_alloc", 0, 1, 1, NULL);
+}
+
+/* Before initImageAllocator() the wait and signal fail on the invalid id, only one thread allocates then. */
+static void lock()
+{
+	sceKernelWaitSema(allocLock, 1, NULL);
+}
+
+static void unlock()
+{
+	sceKernelSignalSema(allocLock, 1);
+}
+
+static void addLive(int bytes)
+{
+	stats.liveBytes += bytes;
+	if (stats.liveBytes > stats.peakBytes) stats.peakBytes = stats.liveBytes;
+}
+
+/* Block size of a slab class, the classes alternate between 2^n and 1.5 * 2^n bytes. */
+static int classBlock(int sizeClass)
+{
+	return (sizeClass & 1 ? IMAGE_SLAB_MIN_BLOCK * 3 / 2 : IMAGE_SLAB_MIN_BLOCK) << (sizeClass >> 1);
+}
+
+static u8* pageData(SlabPage* page)
+{
+	return (u8*) page + PAGE_HEADER_SIZE;
+}
+
+/* Give a page from the heap to a size class, all its blocks free. */
+static SlabPage* carvePage(int sizeClass)
+{
+	int block = classBlock(sizeClass);
+	int tail = IMAGE_SLAB_PAGE_SIZE % block;
+	SlabPage* page = sparePage;
+	int offset;
+	if (pageCount == IMAGE_SLAB_MAX_PAGES) return NULL;
+	if (page) {
+		sparePage = NULL;
+	} else {
+		page = (SlabPage*) memalign(16, PAGE_HEADER_SIZE + IMAGE_SLAB_PAGE_SIZE);
+		if (!page) return NULL;
+		stats.heapBytes += PAGE_HEADER_SIZE + IMAGE_SLAB_PAGE_SIZE;
+	}
+	page->sizeClass = sizeClass;
+	page->usedBlocks = 0;
+	page->freeBlocks = NULL;
+	for (offset = IMAGE_SLAB_PAGE_SIZE - tail - block; offset >= 0; offset -= block) {
+		*(void**) (pageData(page) + offset) = page->freeBlocks;
+		page->freeBlocks = pageData(page) + offset;
+	}
+	pages[pageCount++] = page;
+	stats.slabPages++;
+	stats.slabFreeBytes += IMAGE_SLAB_PAGE_SIZE - tail;
+	// the tail after the last block is never used
+	stats.wasteBytes += tail;
+	return page;
+}
+
+static void* allocSlab(int size)
+{
+	int sizeClass = 0;
+	SlabPage* page = NULL;
+	void* data;
+	int block, i;
+	while (classBlock(sizeClass) < size) sizeClass++;
+	block = classBlock(sizeClass);
+	for (i = 0; i < pageCount; i++) {
+		if (pages[i]->sizeClass == sizeClass && pages[i]->freeBlocks) {
+			page = pages[i];
+			break;
+		}
+	}
+	if (!page) page = carvePage(sizeClass);
+	if (!page) return NULL;
+	data = page->freeBlocks;
+	page->freeBlocks = *(void**) data;
+	page->usedBlocks++;
+	page->waste[((u8*) data - pageData(page)) / block] = block - size;
+	stats.slabFreeBytes -= block;
+	stats.wasteBytes += block - size;
+	addLive(block);
+	return data;
+}
+
+/* The index of the page holding a slab block, -1 for other memory. */
+static int findPage(const void* data)
+{
+	int i;
+	for (i = 0; i < pageCount; i++) {
+		if ((const u8*) data >= pageData(pages[i]) && (const u8*) data < pageData(pages[i]) + IMAGE_SLAB_PAGE_SIZE) return i;
+	}
+	return -1;
+}
+
+static void freeSlab(int index, void* data)
+{
+	SlabPage* page = pages[index];
+	int block = classBlock(page->sizeClass);
+	int tail = IMAGE_SLAB_PAGE_SIZE % block;
+	*(void**) data = page->freeBlocks;
+	page->freeBlocks = data;
+	stats.slabFreeBytes += block;
+	stats.wasteBytes -= page->waste[((u8*) data - pageData(page)) / block];
+	stats.liveBytes -= block;
+	if (--page->usedBlocks > 0) return;
+	// an empty page goes back to the heap, or waits as the spare for any size class
+	pages[index] = pages[--pageCount];
+	stats.slabPages--;
+	stats.slabFreeBytes -= IMAGE_SLAB_PAGE_SIZE - tail;
+	stats.wasteBytes -= tail;
+	if (!sparePage) {
+		sparePage = page;
+		return;
+	}
+	stats.heapBytes -= PAGE_HEADER_SIZE + IMAGE_SLAB_PAGE_SIZE;
+	free(page);
+}
+
+/* Heap bytes of a large block, rounded up to an eighth of its power of two, at least 8 KB, so freed blocks fit later ones of a similar size. */
+static int largeBlockBytes(int size)
+{
+	int bytes = HEADER_SIZE + size;
+	int step = IMAGE_SLAB_PAGE_SIZE / 8;
+	while (step * 16 <= bytes) step <<= 1;
+	return (bytes + step - 1) & ~(step - 1);
+}
+
+/* Give the pooled large blocks back to the heap. */
+static void drainLargePool()
+{
+	while (largePoolCount > 0) {
+		BlockHeader* header = largePool[--largePoolCount];
+		stats.heapBytes -= header->size;
+		stats.largePoolBytes -= header->size;
+		free(header);
+	}
+}
+
+/* A pooled large block of the given heap bytes, NULL if none. */
+static BlockHeader* takePooled(int bytes)
+{
+	int i;
+	for (i = 0; i < largePoolCount; i++) {
+		BlockHeader* header = largePool[i];
+		if ((int) header->size != bytes) continue;
+		largePool[i] = largePool[--largePoolCount];
+		stats.largePoolBytes -= bytes;
+		return header;
+	}
+	return NULL;
+}
+
+static void* allocLarge(int size)
+{
+	int bytes = largeBlockBytes(size);
+	BlockHeader* header = takePooled(bytes);
+	if (!header) {
+		header = (BlockHeader*) memalign(16, bytes);
+		if (!header && largePoolCount > 0) {
+			// pooled blocks of other sizes may be what keeps the heap from fitting this one
+			drainLargePool();
+			header = (BlockHeader*) memalign(16, bytes);
+		}
+		if (!header) return NULL;
+		stats.heapBytes += bytes;
+	}
+	header->size = bytes;
+	header->waste = bytes - HEADER_SIZE - size;
+	stats.largeBytes += bytes;
+	stats.wasteBytes += header->waste;
+	addLive(bytes);
+	return (u8*) header + HEADER_SIZE;
+}
+
+static void freeLarge(BlockHeader* header)
+{
+	stats.largeBytes -= header->size;
+	stats.wasteBytes -= header->waste;
+	stats.liveBytes -= header->size;
+	if (largePoolCount < IMAGE_LARGE_POOL_BLOCKS && stats.largePoolBytes + (int) header->size <= IMAGE_LARGE_POOL_SIZE) {
+		largePool[largePoolCount++] = header;
+		stats.largePoolBytes += header->size;
+		return;
+	}
+	stats.heapBytes -= header->size;
+	free(header);
+}
+
+static ImageArena* arenaOf(const void* data)
+{
+	int i;
+	for (i = 0; i < IMAGE_MAX_ARENAS; i++) {
+		ImageArena* arena = arenas[i];
+		if (arena && (const u8*) data >= arena->base && (const u8*) data < arena->base + arena->size) return arena;
+	}
+	return NULL;
+}
+
+void* allocImageMemory(int size)
+{
+	void* data = NULL;
+	lock();
+	stats.allocations++;
+	if (size <= IMAGE_SLAB_MAX_BLOCK) data = allocSlab(size);
+	if (!data) data = allocLarge(size);
+	if (!data) stats.failures++;
+	unlock();
+	return data;
+}
+
+void* allocArenaMemory(ImageArena* arena, int size)
+{
+	int bytes = HEADER_SIZE + ((size + 15) & ~15);
+	BlockHeader* header;
+	lock();
+	stats.allocations++;
+	if (bytes > arena->size - arena->used) {
+		stats.failures++;
+		unlock();
+		return NULL;
+	}
+	header = (BlockHeader*) (arena->base + arena->used);
+	header->size = bytes;
+	arena->used += bytes;
+	if (arena->used > arena->peak) arena->peak = arena->used;
+	stats.arenaBytes += bytes;
+	addLive(bytes);
+	unlock();
+	return (u8*) header + HEADER_SIZE;
+}
+
+void freeImageMemory(void* data)
+{
+	BlockHeader* header;
+	ImageArena* arena;
+	int page;
+	if (!data) return;
+	header = (BlockHeader*) ((u8*) data - HEADER_SIZE);
+	lock();
+	stats.frees++;
+	if ((page = findPage(data)) >= 0) {
+		freeSlab(page, data);
+	} else if ((arena = arenaOf(data)) != NULL) {
+		arena->deadBytes += header->size;
+		stats.arenaDeadBytes += header->size;
+		stats.liveBytes -= header->size;
+	} else {
+		freeLarge(header);
+	}
+	unlock();
+}
+
+ImageArena* createImageArena(int size)
+{
+	ImageArena* arena;
+	int i;
+	lock();
+	for (i = 0; i < IMAGE_MAX_ARENAS && arenas[i]; i++);
+	if (i == IMAGE_MAX_ARENAS) {
+		unlock();
+		return NULL;
+	}
+	arena = (ImageArena*) calloc(1, sizeof(ImageArena));
+	if (arena) arena->base = (u8*) memalign(16, size);
+	if (!arena || !arena->base) {
+		free(arena);
+		unlock();
+		return NULL;
+	}
+	arena->size = size;
+	arenas[i] = arena;
+	stats.heapBytes += size;
+	unlock();
+	return arena;
+}
+
+void destroyImageArena(ImageArena* arena)
+{
+	int i;
+	clearImageArena(arena);
+	lock();
+	for (i = 0; i < IMAGE_MAX_ARENAS; i++) {
+		if (arenas[i] == arena) arenas[i] = NULL;
+	}
+	if (currentArena == arena) currentArena = NULL;
+	stats.heapBytes -= arena->size;
+	unlock();
+	free(arena->base);
+	free(arena);
+}
+
+void clearImageArena(ImageArena* arena)
+{
+	lock();
+	stats.liveBytes -= arena->used - arena->deadBytes;
+	stats.arenaBytes -= arena->used;
+	stats.arenaDeadBytes -= arena->deadBytes;
+	arena->used = 0;
+	arena->deadBytes = 0;
+	arena->imageCount = 0;
+	unlock();
+}
+
+void setImageArena(ImageArena* arena)
+{
+	lock();
+	currentArena = arena;
+	unlock();
+}
+
+ImageArena* getImageArena()
+{
+	ImageArena* arena;
+	lock();
+	arena = currentArena;
+	unlock();
+	return arena;
+}
+
+ImageArena* findImageArena(const void* data)
+{
+	ImageArena* arena;
+	lock();
+	arena = arenaOf(data);
+	unlock();
+	return arena;
+}
+
+int addArenaImage(ImageArena* arena, void* image)
+{
+	int added = 0;
+	lock();
+	if (arena->imageCount < IMAGE_ARENA_MAX_IMAGES) {
+		arena->images[arena->imageCount++] = image;
+		added = 1;
+	}
+	unlock();
+	return added;
+}
+
+void removeArenaImage(ImageArena* arena, void* image)
+{
+	int i;
+	lock();
+	for (i = 0; i < arena->imageCount; i++) {
+		if (arena->images[i] == image) {
+			arena->images[i] = arena->images[--arena->imageCount];
+			break;
+		}
+	}
+	unlock();
+}
+
+const ImageAllocStats* getImageAllocStats()
+{
+	int used, unused;
+	lock();
+	used = stats.slabPages * IMAGE_SLAB_PAGE_SIZE + stats.largeBytes + stats.largePoolBytes + stats.arenaBytes;
+	unused = stats.slabFreeBytes + stats.wasteBytes + stats.largePoolBytes + stats.arenaDeadBytes;
+	stats.fragmentation = used > 0 ? (int) ((long long) unused * 100 / used) : 0;
+	unlock();
+	return &stats;
+}
+
+void resetImageAllocStats()
+{
+	lock();
+	stats.peakBytes = stats.liveBytes;
+	stats.allocations = 0;
+	stats.frees = 0;
+	stats.failures = 0;
+	unlock();
+}
@@ -0,0 +1,167 @@
+#ifndef IMAGEALLOC_H
+#define IMAGEALLOC_H
+
+#include <psptypes.h>
+
+#define IMAGE_SLAB_PAGE_SIZE 0x10000  // taken from the heap one at a time and given to one size class
+#define IMAGE_SLAB_MAX_PAGES 64  // beyond these small blocks are allocated like large ones
+#define IMAGE_SLAB_MIN_BLOCK 64  // smallest size class, then 96, 128, 192 and so on
+#define IMAGE_SLAB_MAX_BLOCK (IMAGE_SLAB_PAGE_SIZE / 2)  // largest size class, larger blocks are large blocks
+#define IMAGE_LARGE_POOL_SIZE (2 * 1024 * 1024)  // freed large blocks kept for reuse instead of going back to the heap
+#define IMAGE_LARGE_POOL_BLOCKS 16
+#define IMAGE_MAX_ARENAS 4
+#define IMAGE_ARENA_MAX_IMAGES 512
+
+/**
+ * Memory handed out in order and taken back all at once, e.g. for the images of a level.
+ * Create it once and reset it between levels, the heap then never sees the level's images.
+ */
+typedef struct
+{
+	u8* base;
+	int size;
+	int used;  // bytes handed out since the last reset, 16 byte aligned
+	int peak;  // most bytes used before a reset
+	int deadBytes;  // bytes handed out and freed again, taken back by the next reset
+	void* images[IMAGE_ARENA_MAX_IMAGES];  // Images allocated in the arena and not freed, see resetImageArena()
+	int imageCount;
+} ImageArena;
+
+typedef struct
+{
+	int liveBytes;  // bytes allocated and not freed, slab blocks at their class size
+	int peakBytes;  // most live bytes since the last reset
+	int heapBytes;  // bytes taken from the heap, slab pages, large blocks, the large pool and arenas
+	int slabPages;  // slab pages holding blocks
+	int slabFreeBytes;  // free blocks in those pages
+	int largeBytes;  // live large blocks
+	int largePoolBytes;  // freed large blocks kept for reuse
+	int wasteBytes;  // bytes of live slab and large blocks beyond the size asked for, and slab page tails
+	int arenaBytes;  // bytes used in all arenas
+	int arenaDeadBytes;  // bytes freed in all arenas but not reset yet
+	int fragmentation;  // percent of the slab pages, large blocks and arena bytes in use that are free, pooled, wasted or dead
+	int allocations;
+	int frees;
+	int failures;  // allocations that failed
+} ImageAllocStats;
+
+/**
+ * Create the allocator's lock, called once by initGraphics() before a second thread may
+ * allocate. Until then the allocator takes no lock, tools without threads never call it.
+ */
+extern void initImageAllocator();
+
+/**
+ * Allocate memory for image data, palettes and headers, 16 byte aligned.
+ *
+ * Blocks up to IMAGE_SLAB_MAX_BLOCK come from the next size class, classes step by 1.5 and
+ * 4/3 alternately. Each class fills slab pages taken from the heap as needed, so small
+ * images neither split the heap nor leave holes in it between large ones. Larger blocks are
+ * rounded up to an eighth of their power of two, at least 8 KB, and pooled when freed. A
+ * later block that rounds to the same size reuses one, so loading and freeing images of
+ * similar sizes does not break the heap into holes. Thread safe, like all functions here.
+ *
+ * @param size - bytes to allocate
+ * @return the memory, NULL if out of memory
+ */
+extern void* allocImageMemory(int size);
+
+/**
+ * Allocate memory from an arena, 16 byte aligned.
+ *
+ * @pre arena != NULL
+ * @param arena - the arena
+ * @param size - bytes to allocate
+ * @return the memory, NULL if the arena is full
+ */
+extern void* allocArenaMemory(ImageArena* arena, int size);
+
+/**
+ * Free memory of allocImageMemory() or allocArenaMemory(). Arena memory is only counted as
+ * dead, it is taken back by the next reset of its arena.
+ *
+ * @param data - the memory, may be NULL
+ */
+extern void freeImageMemory(void* data);
+
+/**
+ * Create an arena, its memory taken from the heap in one block.
+ *
+ * @param size - bytes of the arena
+ * @return the arena, NULL if out of memory or IMAGE_MAX_ARENAS exist
+ */
+extern ImageArena* createImageArena(int size);
+
+/**
+ * Destroy an arena and give its memory back to the heap.
+ *
+ * @pre arena != NULL && no image of the arena is used anymore, see resetImageArena()
+ * @param arena - the arena
+ */
+extern void destroyImageArena(ImageArena* arena);
+
+/**
+ * Take back all memory of an arena. Use resetImageArena() for arenas holding images.
+ *
+ * @pre arena != NULL && nothing allocated in the arena is used anymore
+ * @param arena - the arena
+ */
+extern void clearImageArena(ImageArena* arena);
+
+/**
+ * Set the arena new images are allocated in, by the loading functions and createImage().
+ * Images fall back to allocImageMemory() when the arena is full, those loaded or created with
+ * IMAGE_NO_ARENA always use it.
+ *
+ * @param arena - the arena, NULL to allocate images with allocImageMemory()
+ */
+extern void setImageArena(ImageArena* arena);
+
+/**
+ * Get the arena new images are allocated in.
+ *
+ * @return the arena, NULL if none is set
+ */
+extern ImageArena* getImageArena();
+
+/**
+ * Find the arena holding some memory.
+ *
+ * @param data - the memory
+ * @return the arena, NULL if data is not arena memory
+ */
+extern ImageArena* findImageArena(const void* data);
+
+/**
+ * Remember an image allocated in an arena, for resetImageArena().
+ *
+ * @pre arena != NULL
+ * @param arena - the arena
+ * @param image - the image
+ * @return 1 on success, 0 if IMAGE_ARENA_MAX_IMAGES images are remembered
+ */
+extern int addArenaImage(ImageArena* arena, void* image);
+
+/**
+ * Forget an image of an arena, when it is freed before the reset.
+ *
+ * @pre arena != NULL
+ * @param arena - the arena
+ * @param image - the image, unknown images are ignored
+ */
+extern void removeArenaImage(ImageArena* arena, void* image);
+
+/**
+ * Get the allocator statistics.
+ *
+ * @return pointer to the statistics, updated by every call
+ */
+extern const ImageAllocStats* getImageAllocStats();
+
+/**
+ * Reset the counters to zero and the peak to the live bytes, the other fields describe the
+ * memory and are kept.
+ */
+extern void resetImageAllocStats();
+
+#endif
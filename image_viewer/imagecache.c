@@ -0,0 +1,217 @@
+#include <string.h>
+
+#include "imagecache.h"
+
+typedef struct
+{
+	u32 hash;  // hashPackName() of the name, compared before the name
+	char name[IMAGE_CACHE_NAME_SIZE];
+	Pack* pack;  // NULL for files
+	int flags;
+	Image* image;  // NULL if the entry is unused
+	int references;
+	int bytes;
+	unsigned int lastUsed;  // useClock at the last acquire or release
+	FrameFence fence;  // getDrawFence() at the last release
+} ImageCacheEntry;
+
+/* An evicted image the GE may still read, freed once its fence is reached. */
+typedef struct
+{
+	Image* image;
+	int bytes;
+	FrameFence fence;
+} RetiredImage;
+
+static ImageCacheEntry entries[IMAGE_CACHE_MAX_ENTRIES];
+static RetiredImage retired[IMAGE_CACHE_MAX_ENTRIES];
+static int retiredCount;
+static unsigned int useClock;
+static int budget = IMAGE_CACHE_DEFAULT_BUDGET;
+static ImageCacheStats stats;
+
+static ImageCacheEntry* findEntry(u32 hash, Pack* pack, const char* name, int flags)
+{
+	int i;
+	for (i = 0; i < IMAGE_CACHE_MAX_ENTRIES; i++) {
+		ImageCacheEntry* entry = &entries[i];
+		if (entry->image && entry->hash == hash && entry->pack == pack && entry->flags == flags &&
+			strcmp(entry->name, name) == 0) return entry;
+	}
+	return NULL;
+}
+
+static ImageCacheEntry* entryOf(Image* image)
+{
+	int i;
+	for (i = 0; i < IMAGE_CACHE_MAX_ENTRIES; i++) {
+		if (entries[i].image == image) return &entries[i];
+	}
+	return NULL;
+}
+
+/* Free the evicted images the GE is done with. */
+static void freeRetired()
+{
+	int i = 0;
+	while (i < retiredCount) {
+		if (!isFrameFenceReached(retired[i].fence)) {
+			i++;
+			continue;
+		}
+		freeImage(retired[i].image);
+		stats.retiredBytes -= retired[i].bytes;
+		retired[i] = retired[--retiredCount];
+	}
+}
+
+/* Remove an unreferenced image from the cache, 0 if it has to wait for the GE and no retired slot is left. */
+static int evict(ImageCacheEntry* entry)
+{
+	if (isFrameFenceReached(entry->fence)) {
+		freeImage(entry->image);
+	} else {
+		if (retiredCount == IMAGE_CACHE_MAX_ENTRIES) return 0;
+		retired[retiredCount].image = entry->image;
+		retired[retiredCount].bytes = entry->bytes;
+		retired[retiredCount].fence = entry->fence;
+		retiredCount++;
+		stats.retiredBytes += entry->bytes;
+	}
+	entry->image = NULL;
+	stats.evictions++;
+	stats.entries--;
+	stats.residentBytes -= entry->bytes;
+	return 1;
+}
+
+/* The least recently used entry without references, NULL if all are referenced. */
+static ImageCacheEntry* findVictim()
+{
+	ImageCacheEntry* victim = NULL;
+	int i;
+	for (i = 0; i < IMAGE_CACHE_MAX_ENTRIES; i++) {
+		ImageCacheEntry* entry = &entries[i];
+		if (!entry->image || entry->references > 0) continue;
+		if (!victim || (int) (entry->lastUsed - victim->lastUsed) < 0) victim = entry;
+	}
+	return victim;
+}
+
+static void fitBudget()
+{
+	while (stats.residentBytes > budget) {
+		ImageCacheEntry* victim = findVictim();
+		if (!victim || !evict(victim)) return;
+	}
+}
+
+/* An unused entry, evicting the least recently used image if none is left. */
+static ImageCacheEntry* freeEntry()
+{
+	ImageCacheEntry* victim;
+	int i;
+	for (i = 0; i < IMAGE_CACHE_MAX_ENTRIES; i++) {
+		if (!entries[i].image) return &entries[i];
+	}
+	victim = findVictim();
+	return victim && evict(victim) ? victim : NULL;
+}
+
+static Image* acquire(Pack* pack, const char* name, int flags)
+{
+	u32 hash = hashPackName(name);
+	ImageCacheEntry* entry;
+	Image* image;
+	freeRetired();
+	entry = findEntry(hash, pack, name, flags);
+	stats.lookups++;
+	if (entry) {
+		stats.hits++;
+		if (entry->references++ == 0) stats.referencedEntries++;
+		entry->lastUsed = useClock++;
+		return entry->image;
+	}
+	stats.misses++;
+	if (strlen(name) >= IMAGE_CACHE_NAME_SIZE) return NULL;
+	entry = freeEntry();
+	if (!entry) return NULL;
+	// cached images outlive levels, they stay out of the level's arena
+	image = pack ? loadImageFromPack(pack, name, flags | IMAGE_NO_ARENA) : loadImageEx(name, flags | IMAGE_NO_ARENA);
+	if (!image) return NULL;
+	entry->hash = hash;
+	strcpy(entry->name, name);
+	entry->pack = pack;
+	entry->flags = flags;
+	entry->image = image;
+	entry->references = 1;
+	entry->bytes = getImageBytes(image);
+	entry->lastUsed = useClock++;
+	stats.entries++;
+	stats.referencedEntries++;
+	stats.residentBytes += entry->bytes;
+	fitBudget();
+	return image;
+}
+
+Image* acquireImage(const char* filename, int flags)
+{
+	return acquire(NULL, filename, flags);
+}
+
+Image* acquirePackImage(Pack* pack, const char* name, int flags)
+{
+	return acquire(pack, name, flags);
+}
+
+void retainImage(Image* image)
+{
+	ImageCacheEntry* entry = entryOf(image);
+	if (!entry) return;
+	if (entry->references++ == 0) stats.referencedEntries++;
+	entry->lastUsed = useClock++;
+}
+
+void releaseImage(Image* image)
+{
+	ImageCacheEntry* entry = entryOf(image);
+	if (!entry || entry->references == 0) return;
+	entry->lastUsed = useClock++;
+	if (--entry->references > 0) return;
+	stats.referencedEntries--;
+	// draws already recorded may still read the image
+	entry->fence = getDrawFence();
+	freeRetired();
+	fitBudget();
+}
+
+void setImageCacheBudget(int bytes)
+{
+	budget = bytes;
+	freeRetired();
+	fitBudget();
+}
+
+int flushImageCache()
+{
+	int freed = 0;
+	int i;
+	freeRetired();
+	for (i = 0; i < IMAGE_CACHE_MAX_ENTRIES; i++) {
+		if (entries[i].image && entries[i].references == 0 && evict(&entries[i])) freed++;
+	}
+	return freed;
+}
+
+const ImageCacheStats* getImageCacheStats()
+{
+	return &stats;
+}
+
+void resetImageCacheStats()
+{
+	stats.lookups = 0;
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.evictions = 0;
+}
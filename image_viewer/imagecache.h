@@ -0,0 +1,102 @@
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "graphics.h"
+
+#define IMAGE_CACHE_MAX_ENTRIES 128
+#define IMAGE_CACHE_NAME_SIZE 128  // file and entry names, including the terminating 0
+#define IMAGE_CACHE_DEFAULT_BUDGET (8 * 1024 * 1024)  // of the PSP's 24 MB of user memory
+
+typedef struct
+{
+	int lookups;  // acquireImage() and acquirePackImage() calls
+	int hits;  // lookups served by an image already loaded
+	int misses;  // lookups that loaded the image
+	int evictions;  // unreferenced images removed to stay within the budget or by a flush
+	int entries;  // images in the cache
+	int referencedEntries;  // images in the cache acquired and not released yet
+	int residentBytes;  // getImageBytes() of the images in the cache
+	int retiredBytes;  // getImageBytes() of evicted images not freed yet, the GE may still draw them
+} ImageCacheStats;
+
+/**
+ * Get a shared image loaded with loadImageEx(). The image is loaded on the first call for a
+ * filename and flags, later calls share it until it is evicted. Every call takes a reference
+ * the caller gives back with releaseImage().
+ *
+ * Released images stay loaded while the cache is within its budget, the least recently
+ * released are evicted first when it is not. Images still referenced are never evicted, the
+ * cache then exceeds the budget. An evicted image drawn before its release is freed by a
+ * later cache call, once the GE has finished those draws.
+ *
+ * Call it from one thread only. Shared images must not be freed with freeImage(), nor
+ * changed unless every user expects that.
+ *
+ * @pre filename != NULL && strlen(filename) < IMAGE_CACHE_NAME_SIZE
+ * @param filename - filename of the PNG image, compared as is, "a/../b.png" and "b.png" are
+ *                   different images
+ * @param flags - like loadImageEx(), the same file loaded with other flags is another image
+ * @return the image, NULL if it could not be loaded or IMAGE_CACHE_MAX_ENTRIES images are
+ *         referenced
+ */
+extern Image* acquireImage(const char* filename, int flags);
+
+/**
+ * Get a shared image loaded from an asset pack with loadImageFromPack(), see acquireImage().
+ *
+ * @pre pack != NULL && name != NULL && strlen(name) < IMAGE_CACHE_NAME_SIZE
+ * @param pack - the pack, images of other packs are other images even if named alike. Flush
+ *               the cache before closing the pack, a new pack might get its address
+ * @param name - name of the entry
+ * @param flags - like loadImageEx()
+ * @return the image, NULL if it could not be loaded or IMAGE_CACHE_MAX_ENTRIES images are
+ *         referenced
+ */
+extern Image* acquirePackImage(Pack* pack, const char* name, int flags);
+
+/**
+ * Take another reference to a shared image, e.g. when a second object keeps it.
+ *
+ * @pre image was returned by acquireImage() or acquirePackImage() and not evicted
+ * @param image - the image
+ */
+extern void retainImage(Image* image);
+
+/**
+ * Give back a reference to a shared image. Without references it may be evicted.
+ *
+ * @pre image holds a reference taken by acquireImage(), acquirePackImage() or retainImage()
+ * @param image - the image
+ */
+extern void releaseImage(Image* image);
+
+/**
+ * Set the memory the cache may keep, unreferenced images are evicted at once to fit.
+ *
+ * @param bytes - getImageBytes() of all images in the cache, IMAGE_CACHE_DEFAULT_BUDGET
+ *                by default
+ */
+extern void setImageCacheBudget(int bytes);
+
+/**
+ * Evict every unreferenced image, e.g. after leaving a level. Images the GE may still draw
+ * are freed by a later cache call once it is done, see ImageCacheStats.retiredBytes.
+ *
+ * @return the number of images evicted
+ */
+extern int flushImageCache();
+
+/**
+ * Get the cache statistics, the counters accumulate since the last reset.
+ *
+ * @return pointer to the live statistics
+ */
+extern const ImageCacheStats* getImageCacheStats();
+
+/**
+ * Reset the lookup counters to zero, entries and resident bytes describe the cache and are
+ * kept.
+ */
+extern void resetImageCacheStats();
+
+#endif
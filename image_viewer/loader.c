@@ -0,0 +1,278 @@
+#include <string.h>
+#include <pspkernel.h>
+
+#include "loader.h"
+
+#define LOADER_THREAD_PRIORITY 0x28  // below the main thread, above the capture encoder
+#define LOADER_THREAD_STACK_SIZE 0x10000
+#define LOADER_WAIT_MICROS 1000  // polling interval of cancelAllLoads()
+
+#define SOURCE_PNG 0  // loadImageEx()
+#define SOURCE_PACK 1  // loadImageFromPack()
+#define SOURCE_TEXTURE 2  // loadTextureFile()
+
+typedef struct
+{
+	int state;  // LOAD_*
+	LoadRequest request;
+	int source;  // SOURCE_*
+	char name[LOADER_NAME_SIZE];
+	Pack* pack;
+	int flags;
+	int priority;
+	unsigned int order;  // when it was requested, orders requests of the same priority
+	int cancelled;  // cancelled while loading or waiting for delivery, pollLoader() frees the image
+	LoadCallback callback;
+	void* user;
+	Image* image;
+} Slot;
+
+/* A finished request handed from the loader thread to pollLoader(). */
+typedef struct
+{
+	LoadRequest request;
+	Image* image;
+	LoadCallback callback;
+	void* user;
+} Delivery;
+
+static Slot slots[LOADER_MAX_REQUESTS];
+static LoadRequest finished[LOADER_MAX_REQUESTS];  // requests to deliver or free, in the order they finished
+static int finishedCount;
+static unsigned int nextOrder;
+static unsigned int nextSerial = 1;
+static LoaderProgress progress;
+static SceUID thread = -1;
+static SceUID lock = -1;  // semaphore guarding everything above
+static SceUID work = -1;  // semaphore signaled when a request is queued
+
+static Slot* slotOf(LoadRequest request)
+{
+	Slot* slot = &slots[request % LOADER_MAX_REQUESTS];
+	return request != 0 && slot->state != LOAD_FREE && slot->request == request ? slot : NULL;
+}
+
+/* Highest priority first, the oldest request among equals. */
+static Slot* nextQueued()
+{
+	Slot* next = NULL;
+	int i;
+	for (i = 0; i < LOADER_MAX_REQUESTS; i++) {
+		Slot* slot = &slots[i];
+		if (slot->state != LOAD_QUEUED) continue;
+		if (!next || slot->priority > next->priority ||
+			(slot->priority == next->priority && (int) (slot->order - next->order) < 0)) next = slot;
+	}
+	return next;
+}
+
+static Image* loadSlot(const Slot* slot)
+{
+	switch (slot->source) {
+	case SOURCE_PACK:
+		return loadImageFromPack(slot->pack, slot->name, slot->flags);
+	case SOURCE_TEXTURE:
+		return loadTextureFile(slot->name);
+	default:
+		return loadImageEx(slot->name, slot->flags);
+	}
+}
+
+/* Loads one request after the other, sleeps while none is queued. */
+static int loaderThread(SceSize args, void* argp)
+{
+	for (;;) {
+		Slot* slot;
+		Image* image;
+		unsigned int start;
+		sceKernelWaitSema(lock, 1, NULL);
+		slot = nextQueued();
+		if (slot) slot->state = LOAD_LOADING;
+		sceKernelSignalSema(lock, 1);
+		if (!slot) {
+			sceKernelWaitSema(work, 1, NULL);
+			continue;
+		}
+		// the main thread leaves a loading slot alone, apart from cancelling it
+		start = sceKernelGetSystemTimeLow();
+		image = loadSlot(slot);
+		sceKernelWaitSema(lock, 1, NULL);
+		progress.loadMicros += sceKernelGetSystemTimeLow() - start;
+		// even cancelled images go to the main thread, freeImage() is not thread safe
+		slot->image = image;
+		slot->state = image ? LOAD_DONE : LOAD_FAILED;
+		finished[finishedCount++] = slot->request;
+		sceKernelSignalSema(lock, 1);
+	}
+	return 0;
+}
+
+static int startLoader()
+{
+	if (thread >= 0) return 1;
+	lock = sceKernelCreateSema("loader_lock", 0, 1, 1, NULL);
+	work = sceKernelCreateSema("loader_work", 0, 0, 1, NULL);
+	thread = sceKernelCreateThread("asset_loader", loaderThread, LOADER_THREAD_PRIORITY,
+		LOADER_THREAD_STACK_SIZE, THREAD_ATTR_USER, NULL);
+	if (lock < 0 || work < 0 || thread < 0 || sceKernelStartThread(thread, 0, NULL) < 0) {
+		if (lock >= 0) sceKernelDeleteSema(lock);
+		if (work >= 0) sceKernelDeleteSema(work);
+		lock = work = thread = -1;
+		return 0;
+	}
+	return 1;
+}
+
+static LoadRequest queueLoad(int source, Pack* pack, const char* name, int flags, int priority, LoadCallback callback, void* user)
+{
+	Slot* slot = NULL;
+	int i;
+	if (strlen(name) >= LOADER_NAME_SIZE || !startLoader()) return 0;
+	sceKernelWaitSema(lock, 1, NULL);
+	for (i = 0; i < LOADER_MAX_REQUESTS; i++) {
+		if (slots[i].state == LOAD_FREE) {
+			slot = &slots[i];
+			break;
+		}
+	}
+	if (!slot) {
+		sceKernelSignalSema(lock, 1);
+		return 0;
+	}
+	memset(slot, 0, sizeof(Slot));
+	// the slot index is the request modulo LOADER_MAX_REQUESTS, the serial tells reuses apart
+	slot->request = nextSerial++ * LOADER_MAX_REQUESTS + i;
+	slot->state = LOAD_QUEUED;
+	slot->source = source;
+	strcpy(slot->name, name);
+	slot->pack = pack;
+	slot->flags = flags;
+	slot->priority = priority;
+	slot->order = nextOrder++;
+	slot->callback = callback;
+	slot->user = user;
+	progress.requested++;
+	sceKernelSignalSema(lock, 1);
+	// a binary semaphore, the thread loads everything queued before it waits again
+	sceKernelSignalSema(work, 1);
+	return slot->request;
+}
+
+LoadRequest requestImageLoad(const char* filename, int flags, int priority, LoadCallback callback, void* user)
+{
+	return queueLoad(SOURCE_PNG, NULL, filename, flags, priority, callback, user);
+}
+
+LoadRequest requestPackImageLoad(Pack* pack, const char* name, int flags, int priority, LoadCallback callback, void* user)
+{
+	return queueLoad(SOURCE_PACK, pack, name, flags, priority, callback, user);
+}
+
+LoadRequest requestTextureLoad(const char* filename, int priority, LoadCallback callback, void* user)
+{
+	return queueLoad(SOURCE_TEXTURE, NULL, filename, 0, priority, callback, user);
+}
+
+/* Cancel with the lock held. Requests being loaded or finished stay until pollLoader() frees their image. */
+static int cancelSlot(Slot* slot)
+{
+	if (slot->cancelled) return 0;
+	progress.cancelled++;
+	if (slot->state == LOAD_QUEUED) slot->state = LOAD_FREE;
+	else slot->cancelled = 1;
+	return 1;
+}
+
+int cancelLoad(LoadRequest request)
+{
+	Slot* slot;
+	int cancelled = 0;
+	if (thread < 0) return 0;
+	sceKernelWaitSema(lock, 1, NULL);
+	slot = slotOf(request);
+	if (slot) cancelled = cancelSlot(slot);
+	sceKernelSignalSema(lock, 1);
+	return cancelled;
+}
+
+void cancelAllLoads()
+{
+	int loading, i;
+	if (thread < 0) return;
+	// the images of cancelled requests are freed by pollLoader(), it delivers nothing else now
+	do {
+		loading = 0;
+		sceKernelWaitSema(lock, 1, NULL);
+		for (i = 0; i < LOADER_MAX_REQUESTS; i++) {
+			if (slots[i].state == LOAD_FREE) continue;
+			cancelSlot(&slots[i]);
+			if (slots[i].state == LOAD_LOADING) loading = 1;
+		}
+		sceKernelSignalSema(lock, 1);
+		if (loading) sceKernelDelayThread(LOADER_WAIT_MICROS);
+	} while (loading);
+	pollLoader();
+}
+
+int pollLoader()
+{
+	Delivery deliveries[LOADER_MAX_REQUESTS];
+	Image* discarded[LOADER_MAX_REQUESTS];
+	int count = 0, discardedCount = 0, i;
+	if (thread < 0) return 0;
+	sceKernelWaitSema(lock, 1, NULL);
+	for (i = 0; i < finishedCount; i++) {
+		Slot* slot = slotOf(finished[i]);
+		if (slot->cancelled) {
+			if (slot->image) discarded[discardedCount++] = slot->image;
+		} else {
+			deliveries[count].request = slot->request;
+			deliveries[count].image = slot->image;
+			deliveries[count].callback = slot->callback;
+			deliveries[count].user = slot->user;
+			count++;
+			if (slot->image) progress.loaded++;
+			else progress.failed++;
+		}
+		slot->state = LOAD_FREE;
+	}
+	finishedCount = 0;
+	sceKernelSignalSema(lock, 1);
+	// outside the lock, the callbacks may request more
+	for (i = 0; i < discardedCount; i++) freeImage(discarded[i]);
+	for (i = 0; i < count; i++) deliveries[i].callback(deliveries[i].request, deliveries[i].image, deliveries[i].user);
+	return count;
+}
+
+int getLoadState(LoadRequest request)
+{
+	Slot* slot;
+	int state = LOAD_FREE;
+	if (thread < 0) return LOAD_FREE;
+	sceKernelWaitSema(lock, 1, NULL);
+	slot = slotOf(request);
+	if (slot && !slot->cancelled) state = slot->state;
+	sceKernelSignalSema(lock, 1);
+	return state;
+}
+
+LoaderProgress getLoaderProgress()
+{
+	LoaderProgress copy;
+	if (thread >= 0) sceKernelWaitSema(lock, 1, NULL);
+	copy = progress;
+	if (thread >= 0) sceKernelSignalSema(lock, 1);
+	copy.pending = copy.requested - copy.loaded - copy.failed - copy.cancelled;
+	return copy;
+}
+
+void resetLoaderProgress()
+{
+	int i;
+	if (thread >= 0) sceKernelWaitSema(lock, 1, NULL);
+	memset(&progress, 0, sizeof(progress));
+	for (i = 0; i < LOADER_MAX_REQUESTS; i++) {
+		if (slots[i].state != LOAD_FREE && !slots[i].cancelled) progress.requested++;
+	}
+	if (thread >= 0) sceKernelSignalSema(lock, 1);
+}
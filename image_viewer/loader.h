@@ -0,0 +1,132 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "graphics.h"
+
+#define LOADER_MAX_REQUESTS 64  // requests queued, loading or waiting for delivery at once
+#define LOADER_NAME_SIZE 128  // file and entry names, including the terminating 0
+
+#define LOAD_FREE 0  // no such request, or it was delivered or cancelled
+#define LOAD_QUEUED 1  // waiting for the loader thread
+#define LOAD_LOADING 2  // being read and decoded by the loader thread
+#define LOAD_DONE 3  // loaded, delivered by the next pollLoader()
+#define LOAD_FAILED 4  // could not be loaded, delivered with a NULL image by the next pollLoader()
+
+/** Identifies a load request, 0 is never a valid request. */
+typedef unsigned int LoadRequest;
+
+/**
+ * Called by pollLoader() on the thread that polls, when a request finished.
+ *
+ * @param request - the request
+ * @param image - the loaded image, owned by the callback from now on, NULL if loading failed
+ * @param user - the pointer passed with the request
+ */
+typedef void (*LoadCallback)(LoadRequest request, Image* image, void* user);
+
+/** Progress of the requests made since the last resetLoaderProgress(). */
+typedef struct
+{
+	int requested;
+	int loaded;  // delivered with an image
+	int failed;  // delivered without an image
+	int cancelled;  // cancelled before delivery
+	int pending;  // requested but neither delivered nor cancelled yet
+	unsigned int loadMicros;  // time the loader thread spent reading and decoding
+} LoaderProgress;
+
+/**
+ * Queue a PNG to be loaded with loadImageEx() by the loader thread. The thread is started
+ * by the first request. It runs below the main thread's priority, so it reads and decodes
+ * while the main thread waits for vblank or the GE, and the frame rate holds.
+ *
+ * @pre initGraphics() was called && filename != NULL && strlen(filename) < LOADER_NAME_SIZE &&
+ *      callback != NULL
+ * @param filename - filename of the PNG image to load
+ * @param flags - like loadImageEx()
+ * @param priority - requests of a higher priority are loaded first, requests of the same
+ *                   priority in the order they were made
+ * @param callback - receives the image
+ * @param user - passed to the callback
+ * @return the request, 0 if LOADER_MAX_REQUESTS are pending or the thread cannot start
+ */
+extern LoadRequest requestImageLoad(const char* filename, int flags, int priority, LoadCallback callback, void* user);
+
+/**
+ * Queue a PNG to be loaded from an asset pack with loadImageFromPack().
+ *
+ * @pre initGraphics() was called && pack != NULL && name != NULL &&
+ *      strlen(name) < LOADER_NAME_SIZE && callback != NULL
+ * @param pack - the pack, kept open until the request is delivered or cancelAllLoads() returned
+ * @param name - name of the entry
+ * @param flags - like loadImageEx()
+ * @param priority - see requestImageLoad()
+ * @param callback - see requestImageLoad()
+ * @param user - passed to the callback
+ * @return the request, 0 if LOADER_MAX_REQUESTS are pending or the thread cannot start
+ */
+extern LoadRequest requestPackImageLoad(Pack* pack, const char* name, int flags, int priority, LoadCallback callback, void* user);
+
+/**
+ * Queue a cooked texture to be loaded with loadTextureFile().
+ *
+ * @pre initGraphics() was called && filename != NULL && strlen(filename) < LOADER_NAME_SIZE &&
+ *      callback != NULL
+ * @param filename - filename of the cooked texture
+ * @param priority - see requestImageLoad()
+ * @param callback - see requestImageLoad()
+ * @param user - passed to the callback
+ * @return the request, 0 if LOADER_MAX_REQUESTS are pending or the thread cannot start
+ */
+extern LoadRequest requestTextureLoad(const char* filename, int priority, LoadCallback callback, void* user);
+
+/**
+ * Cancel a request. A queued request is dropped, the image of a request being loaded or
+ * waiting for delivery is freed by the next pollLoader(). The callback is not called.
+ *
+ * @param request - the request
+ * @return 1 if the request was cancelled, 0 if it was delivered or cancelled before
+ */
+extern int cancelLoad(LoadRequest request);
+
+/**
+ * Cancel every request not delivered yet, e.g. when leaving a level that is still loading.
+ * Returns once the loader thread finished the load it was running and the images of all
+ * cancelled requests are freed, so the files and packs of the requests may be closed.
+ */
+extern void cancelAllLoads();
+
+/**
+ * Deliver the finished requests to their callbacks, in the order they finished, and free
+ * the images of cancelled requests.
+ *
+ * Call it once per frame at a point where the new images may be used, e.g. before drawing,
+ * and always from the thread that draws. The callbacks may make new requests.
+ *
+ * @return the number of requests delivered
+ */
+extern int pollLoader();
+
+/**
+ * Get the state of a request.
+ *
+ * @param request - the request
+ * @return LOAD_QUEUED, LOAD_LOADING, LOAD_DONE or LOAD_FAILED, LOAD_FREE once delivered or
+ *         cancelled
+ */
+extern int getLoadState(LoadRequest request);
+
+/**
+ * Get the progress of the requests made since the last reset, e.g. for a loading bar of
+ * loaded + failed out of requested - cancelled.
+ *
+ * @return a copy of the progress, taken under the loader's lock
+ */
+extern LoaderProgress getLoaderProgress();
+
+/**
+ * Reset the progress to zero, pending requests are counted again.
+ */
+extern void resetLoaderProgress();
+
+#endif
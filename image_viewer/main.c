@@ -11,6 +11,7 @@
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y)) 
 
 PSP_MODULE_INFO("Image Program", 0, 1, 1);
+PSP_MAIN_THREAD_ATTR(THREAD_ATTR_USER | THREAD_ATTR_VFPU);
 
 /* Exit callback */
 int exit_callback(int arg1, int arg2, void *common) {
@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pspkernel.h>
+#include <pspiofilemgr.h>
+#include <zlib.h>
+
+#include "pack.h"
+
+u32 hashPackName(const char* name)
+{
+	u32 hash = 2166136261u;
+	while (*name) {
+		hash ^= (u8) *name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* Check the index once, so lookups and reads can trust it. */
+static int validIndex(Pack* pack, int namesSize, u32 fileSize)
+{
+	int i;
+	if (namesSize <= 0 || pack->names[namesSize - 1] != 0) return 0;
+	if (pack->buckets[0] != 0 || pack->buckets[pack->bucketCount] != (u32) pack->entryCount) return 0;
+	for (i = 0; i < pack->bucketCount; i++) {
+		if (pack->buckets[i] > pack->buckets[i + 1]) return 0;
+	}
+	for (i = 0; i < pack->entryCount; i++) {
+		const PackEntry* entry = &pack->entries[i];
+		if (entry->name >= (u32) namesSize || entry->offset > fileSize || entry->storedSize > fileSize - entry->offset) return 0;
+		if (entry->compression > PACK_COMPRESSION_DEFLATE) return 0;
+		if (entry->compression == PACK_COMPRESSION_NONE && entry->storedSize != entry->size) return 0;
+	}
+	for (i = 0; i < pack->bucketCount; i++) {
+		u32 e;
+		for (e = pack->buckets[i]; e < pack->buckets[i + 1]; e++) {
+			if ((pack->entries[e].hash & (pack->bucketCount - 1)) != (u32) i) return 0;
+		}
+	}
+	return 1;
+}
+
+Pack* openPack(const char* filename)
+{
+	PackHeader header;
+	Pack* pack;
+	SceOff fileSize;
+	int indexBytes;
+
+	SceUID fd = sceIoOpen(filename, PSP_O_RDONLY, 0);
+	if (fd < 0) return NULL;
+	fileSize = sceIoLseek(fd, 0, PSP_SEEK_END);
+	if (fileSize < (SceOff) sizeof(header) || sceIoLseek(fd, 0, PSP_SEEK_SET) != 0 ||
+		sceIoRead(fd, &header, sizeof(header)) != sizeof(header) ||
+		header.magic != PACK_MAGIC || header.version != PACK_VERSION ||
+		header.bucketCount == 0 || (header.bucketCount & (header.bucketCount - 1)) != 0 ||
+		header.bucketCount < header.entryCount || header.bucketCount > header.indexSize / sizeof(u32) ||
+		header.indexSize > fileSize - sizeof(header)) {
+		sceIoClose(fd);
+		return NULL;
+	}
+	indexBytes = header.entryCount * sizeof(PackEntry) + (header.bucketCount + 1) * sizeof(u32);
+	pack = (Pack*) calloc(1, sizeof(Pack));
+	if (!pack) {
+		sceIoClose(fd);
+		return NULL;
+	}
+	pack->fd = fd;
+	pack->lock = sceKernelCreateSema("pack_lock", 0, 1, 1, NULL);
+	pack->entryCount = header.entryCount;
+	pack->bucketCount = header.bucketCount;
+	pack->index = malloc(header.indexSize);
+	if (pack->lock < 0 || !pack->index || (int) header.indexSize <= indexBytes ||
+		sceIoRead(fd, pack->index, header.indexSize) != (int) header.indexSize) {
+		closePack(pack);
+		return NULL;
+	}
+	pack->entries = (PackEntry*) pack->index;
+	pack->buckets = (u32*) (pack->entries + pack->entryCount);
+	pack->names = (const char*) (pack->buckets + pack->bucketCount + 1);
+	if (!validIndex(pack, header.indexSize - indexBytes, fileSize)) {
+		closePack(pack);
+		return NULL;
+	}
+	return pack;
+}
+
+void closePack(Pack* pack)
+{
+	sceIoClose(pack->fd);
+	if (pack->lock >= 0) sceKernelDeleteSema(pack->lock);
+	free(pack->index);
+	free(pack);
+}
+
+const PackEntry* findPackEntry(Pack* pack, const char* name)
+{
+	u32 hash = hashPackName(name);
+	u32 bucket = hash & (pack->bucketCount - 1);
+	const PackEntry* found = NULL;
+	int compares = 0;
+	u32 i;
+	// the index is never written after openPack(), only the counters need the lock
+	for (i = pack->buckets[bucket]; i < pack->buckets[bucket + 1] && !found; i++) {
+		const PackEntry* entry = &pack->entries[i];
+		if (entry->hash != hash) continue;
+		compares++;
+		if (strcmp(pack->names + entry->name, name) == 0) found = entry;
+	}
+	sceKernelWaitSema(pack->lock, 1, NULL);
+	pack->stats.lookups++;
+	pack->stats.compares += compares;
+	if (!found) pack->stats.misses++;
+	sceKernelSignalSema(pack->lock, 1);
+	return found;
+}
+
+const char* getPackEntryName(Pack* pack, const PackEntry* entry)
+{
+	return pack->names + entry->name;
+}
+
+static int readAt(SceUID fd, u32 offset, void* data, int size)
+{
+	if (sceIoLseek(fd, offset, PSP_SEEK_SET) != offset) return 0;
+	return sceIoRead(fd, data, size) == size;
+}
+
+/* The seek and the read must not be split by another thread reading the pack. */
+static int lockedRead(Pack* pack, u32 offset, void* data, int size)
+{
+	int ok;
+	sceKernelWaitSema(pack->lock, 1, NULL);
+	pack->stats.reads++;
+	pack->stats.bytesRead += size;
+	ok = readAt(pack->fd, offset, data, size);
+	sceKernelSignalSema(pack->lock, 1);
+	return ok;
+}
+
+int readPackEntry(Pack* pack, const PackEntry* entry, void* data)
+{
+	uLongf size = entry->size;
+	void* stored;
+	int ok;
+	if (entry->compression == PACK_COMPRESSION_NONE) return lockedRead(pack, entry->offset, data, entry->size);
+	stored = malloc(entry->storedSize);
+	if (!stored) return 0;
+	ok = lockedRead(pack, entry->offset, stored, entry->storedSize) &&
+		uncompress((Bytef*) data, &size, (const Bytef*) stored, entry->storedSize) == Z_OK && size == entry->size;
+	free(stored);
+	if (!ok) return 0;
+	sceKernelWaitSema(pack->lock, 1, NULL);
+	pack->stats.bytesInflated += entry->size;
+	sceKernelSignalSema(pack->lock, 1);
+	return 1;
+}
+
+void* loadPackEntry(Pack* pack, const char* name, int* size)
+{
+	const PackEntry* entry = findPackEntry(pack, name);
+	void* data;
+	if (!entry) return NULL;
+	// one spare byte, so an empty entry still gets memory of its own
+	data = malloc(entry->size + 1);
+	if (!data) return NULL;
+	if (!readPackEntry(pack, entry, data)) {
+		free(data);
+		return NULL;
+	}
+	if (size) *size = entry->size;
+	return data;
+}
+
+PackStats getPackStats(Pack* pack)
+{
+	PackStats copy;
+	sceKernelWaitSema(pack->lock, 1, NULL);
+	copy = pack->stats;
+	sceKernelSignalSema(pack->lock, 1);
+	return copy;
+}
+
+void resetPackStats(Pack* pack)
+{
+	sceKernelWaitSema(pack->lock, 1, NULL);
+	memset(&pack->stats, 0, sizeof(pack->stats));
+	sceKernelSignalSema(pack->lock, 1);
+}
@@ -0,0 +1,153 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <psptypes.h>
+
+#define PACK_MAGIC 0x4b415047  // "GPAK"
+#define PACK_VERSION 1
+
+#define PACK_COMPRESSION_NONE 0  // stored as is
+#define PACK_COMPRESSION_DEFLATE 1  // zlib stream, inflated while reading
+
+/**
+ * Header of an asset pack, written by the assetpack host tool.
+ *
+ * The header is followed by the index: entryCount PackEntry records, bucketCount + 1 u32
+ * bucket starts and the 0 terminated entry names, indexSize bytes in all. The entries are
+ * sorted by the bucket of their hash, hash & (bucketCount - 1), entries[buckets[b]] to
+ * entries[buckets[b + 1] - 1] lie in bucket b. The data of the entries follows the index.
+ * All fields are little endian.
+ */
+typedef struct
+{
+	u32 magic;  // PACK_MAGIC
+	u32 version;  // PACK_VERSION
+	u32 entryCount;
+	u32 bucketCount;  // 2^n, at least entryCount
+	u32 indexSize;  // bytes of entries, buckets and names
+	u32 reserved[3];  // 0
+} PackHeader;
+
+/** A file in a pack. */
+typedef struct
+{
+	u32 hash;  // hashPackName() of the name
+	u32 name;  // offset of the name in the names of the index
+	u32 offset;  // file offset of the data
+	u32 size;  // bytes of the file
+	u32 storedSize;  // bytes of the data in the pack, size if not compressed
+	u16 compression;  // PACK_COMPRESSION_NONE or PACK_COMPRESSION_DEFLATE
+	u16 alignment;  // the offset is a multiple of it, 64 keeps cooked textures aligned as in their own files
+} PackEntry;
+
+typedef struct
+{
+	int lookups;  // findPackEntry() calls
+	int misses;  // lookups of names not in the pack
+	int compares;  // names compared, about one per lookup while hashes do not collide
+	int reads;  // entries read
+	int bytesRead;  // bytes read from the pack file
+	int bytesInflated;  // bytes of compressed entries after inflating
+} PackStats;
+
+/** An open pack, its index kept in memory. */
+typedef struct
+{
+	SceUID fd;
+	SceUID lock;  // semaphore around the seek and read of an entry and the statistics, packs may be read by the loader thread
+	int entryCount;
+	int bucketCount;
+	PackEntry* entries;
+	u32* buckets;
+	const char* names;
+	void* index;  // one allocation holding entries, buckets and names
+	PackStats stats;
+} Pack;
+
+/**
+ * Hash of an entry name, 32-bit FNV-1a.
+ *
+ * @pre name != NULL
+ * @param name - the name
+ * @return the hash
+ */
+extern u32 hashPackName(const char* name);
+
+/**
+ * Open a pack and read its index. The file stays open until closePack(), every entry is
+ * then read with a seek and one read instead of opening a file.
+ *
+ * @pre filename != NULL
+ * @param filename - filename of the pack written by assetpack
+ * @return pointer to a new allocated Pack struct, or NULL on failure
+ */
+extern Pack* openPack(const char* filename);
+
+/**
+ * Close a pack and free its index.
+ *
+ * @pre pack != NULL
+ * @param pack - the pack
+ */
+extern void closePack(Pack* pack);
+
+/**
+ * Look up an entry by name in the bucket of its hash.
+ *
+ * @pre pack != NULL && name != NULL
+ * @param pack - the pack
+ * @param name - path of the file relative to the directory packed, with '/' separators
+ * @return the entry, NULL if the pack has no such file
+ */
+extern const PackEntry* findPackEntry(Pack* pack, const char* name);
+
+/**
+ * Get the name of an entry.
+ *
+ * @pre pack != NULL && entry != NULL
+ * @param pack - the pack
+ * @param entry - entry of the pack
+ * @return the name
+ */
+extern const char* getPackEntryName(Pack* pack, const PackEntry* entry);
+
+/**
+ * Read an entry, inflating it if it is compressed.
+ *
+ * @pre pack != NULL && entry != NULL && data != NULL
+ * @param pack - the pack
+ * @param entry - entry of the pack
+ * @param data - receives entry->size bytes
+ * @return 1 on success, 0 if the entry could not be read
+ */
+extern int readPackEntry(Pack* pack, const PackEntry* entry, void* data);
+
+/**
+ * Read an entry by name into new memory.
+ *
+ * @pre pack != NULL && name != NULL
+ * @param pack - the pack
+ * @param name - name of the entry
+ * @param size - receives the bytes of the entry, may be NULL
+ * @return the data allocated with malloc(), free() it, NULL if not found or on failure
+ */
+extern void* loadPackEntry(Pack* pack, const char* name, int* size);
+
+/**
+ * Get the statistics of a pack accumulated since it was opened or last reset.
+ *
+ * @pre pack != NULL
+ * @param pack - the pack
+ * @return a copy of the statistics, taken while no other thread updates them
+ */
+extern PackStats getPackStats(Pack* pack);
+
+/**
+ * Reset the statistics of a pack to zero.
+ *
+ * @pre pack != NULL
+ * @param pack - the pack
+ */
+extern void resetPackStats(Pack* pack);
+
+#endif
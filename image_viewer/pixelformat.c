@@ -0,0 +1,125 @@
+#include <string.h>
+#include <pspgu.h>
+
+#include "pixelformat.h"
+
+static const u8 bayer4[4][4] = {
+	{ 0, 8, 2, 10 },
+	{ 12, 4, 14, 6 },
+	{ 3, 11, 1, 9 },
+	{ 15, 7, 13, 5 }
+};
+
+int pixelFormatBytes(int format)
+{
+	return format == GU_PSM_8888 ? 4 : 2;
+}
+
+int pixelFormatBits(int format)
+{
+	switch (format) {
+		case GU_PSM_8888: return 32;
+		case GU_PSM_T8: return 8;
+		case GU_PSM_T4: return 4;
+		default: return 16;
+	}
+}
+
+int pixelFormatIndexed(int format)
+{
+	return format == GU_PSM_T4 || format == GU_PSM_T8;
+}
+
+u32 colorToPixel(u32 color, int format)
+{
+	u32 r = color & 0xff;
+	u32 g = (color >> 8) & 0xff;
+	u32 b = (color >> 16) & 0xff;
+	u32 a = color >> 24;
+	switch (format) {
+		case GU_PSM_5650:
+			return (r >> 3) | ((g >> 2) << 5) | ((b >> 3) << 11);
+		case GU_PSM_5551:
+			return (r >> 3) | ((g >> 3) << 5) | ((b >> 3) << 10) | ((a >> 7) << 15);
+		case GU_PSM_4444:
+			return (r >> 4) | ((g >> 4) << 4) | ((b >> 4) << 8) | ((a >> 4) << 12);
+		default:
+			return color;
+	}
+}
+
+/* Add the dither threshold, scaled to the step of a channel of the given width. */
+static u32 dither(u32 value, int bits, int threshold)
+{
+	value += (threshold * (256 >> bits)) >> 4;
+	return value > 255 ? 255 : value;
+}
+
+u32 colorToPixelDithered(u32 color, int format, int x, int y)
+{
+	int threshold = bayer4[y & 3][x & 3];
+	u32 r = color & 0xff;
+	u32 g = (color >> 8) & 0xff;
+	u32 b = (color >> 16) & 0xff;
+	u32 a = color & 0xff000000;
+	switch (format) {
+		case GU_PSM_5650:
+			return colorToPixel(a | dither(r, 5, threshold) | (dither(g, 6, threshold) << 8) | (dither(b, 5, threshold) << 16), format);
+		case GU_PSM_5551:
+			return colorToPixel(a | dither(r, 5, threshold) | (dither(g, 5, threshold) << 8) | (dither(b, 5, threshold) << 16), format);
+		case GU_PSM_4444:
+			return colorToPixel(a | dither(r, 4, threshold) | (dither(g, 4, threshold) << 8) | (dither(b, 4, threshold) << 16), format);
+		default:
+			return color;
+	}
+}
+
+u32 pixelToColor(u32 pixel, int format)
+{
+	u32 r, g, b, a;
+	switch (format) {
+		case GU_PSM_5650:
+			r = pixel & 0x1f;
+			g = (pixel >> 5) & 0x3f;
+			b = (pixel >> 11) & 0x1f;
+			r = (r << 3) | (r >> 2);
+			g = (g << 2) | (g >> 4);
+			b = (b << 3) | (b >> 2);
+			a = 0xff;
+			break;
+		case GU_PSM_5551:
+			r = pixel & 0x1f;
+			g = (pixel >> 5) & 0x1f;
+			b = (pixel >> 10) & 0x1f;
+			r = (r << 3) | (r >> 2);
+			g = (g << 3) | (g >> 2);
+			b = (b << 3) | (b >> 2);
+			a = (pixel & 0x8000) ? 0xff : 0;
+			break;
+		case GU_PSM_4444:
+			r = (pixel & 0xf) * 0x11;
+			g = ((pixel >> 4) & 0xf) * 0x11;
+			b = ((pixel >> 8) & 0xf) * 0x11;
+			a = ((pixel >> 12) & 0xf) * 0x11;
+			break;
+		default:
+			return pixel;
+	}
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+void convertRow(void* out, const u32* in, int width, int format, int dither, int y)
+{
+	int x;
+	u16* out16 = (u16*) out;
+	if (format == GU_PSM_8888) {
+		// converted in place there is nothing to do, memcpy must not overlap
+		if (out != (const void*) in) memcpy(out, in, width * sizeof(u32));
+		return;
+	}
+	if (dither) {
+		for (x = 0; x < width; x++) out16[x] = colorToPixelDithered(in[x], format, x, y);
+	} else {
+		for (x = 0; x < width; x++) out16[x] = colorToPixel(in[x], format);
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef PIXELFORMAT_H
+#define PIXELFORMAT_H
+
+#include <psptypes.h>
+
+/*
+ * Conversion between 8888 colors (red in the low byte, like Color in graphics.h) and the
+ * pixel formats of the GE, identified by their GU_PSM_* value.
+ */
+
+/**
+ * Get the storage size of one pixel.
+ *
+ * @param format - GU_PSM_8888, GU_PSM_5650, GU_PSM_5551 or GU_PSM_4444
+ * @return 4 for GU_PSM_8888, 2 for the 16-bit formats
+ */
+extern int pixelFormatBytes(int format);
+
+/**
+ * Get the storage size of one pixel in bits, including the indexed formats.
+ *
+ * @param format - any GU_PSM_* texture format
+ * @return 32, 16, 8 for GU_PSM_T8 or 4 for GU_PSM_T4
+ */
+extern int pixelFormatBits(int format);
+
+/**
+ * Check whether pixels of a format are indices into a CLUT.
+ *
+ * @param format - any GU_PSM_* texture format
+ * @return 1 for GU_PSM_T4 and GU_PSM_T8, 0 otherwise
+ */
+extern int pixelFormatIndexed(int format);
+
+/**
+ * Convert a color to a pixel, truncating the channels.
+ *
+ * @param color - 8888 color
+ * @param format - target pixel format
+ * @return the pixel, in the low 16 bits for 16-bit formats
+ */
+extern u32 colorToPixel(u32 color, int format);
+
+/**
+ * Convert a color to a pixel with 4x4 ordered dithering of the color channels.
+ * Alpha is never dithered, so binary transparency keeps its edges.
+ *
+ * @param color - 8888 color
+ * @param format - target pixel format
+ * @param x - horizontal position of the pixel, selects the dither threshold
+ * @param y - vertical position of the pixel, selects the dither threshold
+ * @return the pixel, in the low 16 bits for 16-bit formats
+ */
+extern u32 colorToPixelDithered(u32 color, int format, int x, int y);
+
+/**
+ * Expand a pixel to an 8888 color, replicating the high bits of each channel.
+ *
+ * @param pixel - pixel in the given format
+ * @param format - pixel format
+ * @return 8888 color
+ */
+extern u32 pixelToColor(u32 pixel, int format);
+
+/**
+ * Convert a row of 8888 colors to a pixel format.
+ *
+ * @pre out != NULL && in != NULL && width >= 0
+ * @param out - destination, width * pixelFormatBytes(format) bytes, may be the same buffer as in
+ * @param in - source colors
+ * @param width - number of pixels
+ * @param format - target pixel format
+ * @param dither - nonzero to apply ordered dithering
+ * @param y - row number, selects the dither thresholds
+ */
+extern void convertRow(void* out, const u32* in, int width, int format, int dither, int y);
+
+#endif
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <string.h>
+#include <pspkernel.h>
+
+#include "profile.h"
+
+static const char* phaseNames[PROFILE_MAX_PHASES];
+static int phaseCount;
+static ProfileFrame current;
+static ProfileFrame history[PROFILE_HISTORY];
+static int historyFrames;
+static int historyNext;
+static unsigned int frameStart;
+static int started;
+static SceUID frameThread = -1;  // thread drawing the frames, see profileSetFrameThread()
+
+static const char* counterNames[PROFILE_COUNTERS] = {
+	"draw_calls", "vertices", "texture_binds", "dcache_bytes", "gu_sync_us", "binds_saved"
+};
+
+/* Phases are mostly named by the same literal every time, so the pointer usually matches. */
+static int findPhase(const char* name)
+{
+	int i;
+	for (i = 0; i < phaseCount; i++) {
+		if (phaseNames[i] == name) return i;
+	}
+	for (i = 0; i < phaseCount; i++) {
+		if (strcmp(phaseNames[i], name) == 0) return i;
+	}
+	if (phaseCount == PROFILE_MAX_PHASES) return -1;
+	phaseNames[phaseCount] = name;
+	return phaseCount++;
+}
+
+void profileSetFrameThread()
+{
+	frameThread = sceKernelGetThreadId();
+}
+
+ProfileScope profileBegin(const char* name)
+{
+	ProfileScope scope;
+	// phases of other threads, like the loader's, would overlap the frame's own and race
+	// with it on the phase table
+	scope.phase = frameThread >= 0 && sceKernelGetThreadId() == frameThread ? findPhase(name) : -1;
+	scope.start = sceKernelGetSystemTimeLow();
+	return scope;
+}
+
+void profileEnd(ProfileScope scope)
+{
+	if (scope.phase < 0) return;
+	current.phaseMicros[scope.phase] += sceKernelGetSystemTimeLow() - scope.start;
+}
+
+void profileEndScope(ProfileScope* scope)
+{
+	profileEnd(*scope);
+}
+
+void profileCount(int counter, unsigned int amount)
+{
+	current.counters[counter] += amount;
+}
+
+void profileEndFrame()
+{
+	unsigned int now = sceKernelGetSystemTimeLow();
+	unsigned int number = current.number + 1;
+	// the first frame starts with the first flip, what came before it is initialization
+	current.frameMicros = started ? now - frameStart : 0;
+	history[historyNext] = current;
+	historyNext = (historyNext + 1) % PROFILE_HISTORY;
+	if (historyFrames < PROFILE_HISTORY) historyFrames++;
+	memset(&current, 0, sizeof(current));
+	current.number = number;
+	frameStart = now;
+	started = 1;
+}
+
+const ProfileFrame* profileGetFrame(int age)
+{
+	if (age < 0 || age >= historyFrames) return NULL;
+	return &history[(historyNext - 1 - age + PROFILE_HISTORY) % PROFILE_HISTORY];
+}
+
+int profilePhaseCount()
+{
+	return phaseCount;
+}
+
+const char* profilePhaseName(int phase)
+{
+	return phaseNames[phase];
+}
+
+const char* profileCounterName(int counter)
+{
+	return counterNames[counter];
+}
+
+void profileReset()
+{
+	unsigned int number = current.number;
+	memset(&current, 0, sizeof(current));
+	current.number = number;
+	historyFrames = 0;
+	historyNext = 0;
+	frameStart = sceKernelGetSystemTimeLow();
+}
+
+int profileDumpCsv(const char* filename)
+{
+	FILE* fp = filename ? fopen(filename, "w") : stdout;
+	int i, age;
+	if (!fp) return 0;
+	fprintf(fp, "frame,frame_us");
+	for (i = 0; i < phaseCount; i++) fprintf(fp, ",%s_us", phaseNames[i]);
+	for (i = 0; i < PROFILE_COUNTERS; i++) fprintf(fp, ",%s", counterNames[i]);
+	fprintf(fp, "\n");
+	for (age = historyFrames - 1; age >= 0; age--) {
+		const ProfileFrame* frame = profileGetFrame(age);
+		fprintf(fp, "%u,%u", frame->number, frame->frameMicros);
+		for (i = 0; i < phaseCount; i++) fprintf(fp, ",%u", frame->phaseMicros[i]);
+		for (i = 0; i < PROFILE_COUNTERS; i++) fprintf(fp, ",%u", frame->counters[i]);
+		fprintf(fp, "\n");
+	}
+	if (fp == stdout) return fflush(fp) == 0;
+	return fclose(fp) == 0;
+}
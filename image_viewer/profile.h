@@ -0,0 +1,131 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#define PROFILE_MAX_PHASES 12
+#define PROFILE_HISTORY 120  // frames kept for the overlay and the CSV dump, two seconds at 60 Hz
+
+#ifdef HOST_BUILD
+#define PROFILE_CSV_FILE NULL  // stdout
+#else
+#define PROFILE_CSV_FILE "ms0:/profile.csv"
+#endif
+
+/* Counters, added to by the graphics code and by profileCount. */
+#define PROFILE_DRAW_CALLS 0  // sceGuDrawArray calls
+#define PROFILE_VERTICES 1  // vertices drawn
+#define PROFILE_TEXTURE_BINDS 2  // texture changes sent to the GE
+#define PROFILE_DCACHE_BYTES 3  // bytes written back from the data cache for the GE
+#define PROFILE_GU_SYNC_MICROS 4  // time spent in sceGuSync
+#define PROFILE_BINDS_SAVED 5  // texture changes atlas sprites saved, see atlas.h
+#define PROFILE_COUNTERS 6
+
+/** A running phase timer, returned by profileBegin. */
+typedef struct
+{
+	int phase;
+	unsigned int start;
+} ProfileScope;
+
+/** What one frame spent its time on, from one profileEndFrame() to the next. */
+typedef struct
+{
+	unsigned int number;  // frames ended before this one
+	unsigned int frameMicros;
+	unsigned int phaseMicros[PROFILE_MAX_PHASES];  // by phase index, see profilePhaseName
+	unsigned int counters[PROFILE_COUNTERS];
+} ProfileFrame;
+
+/**
+ * Make the calling thread the one whose phases are timed, initGraphics() calls it.
+ */
+extern void profileSetFrameThread();
+
+/**
+ * Start timing a phase. Phases are told apart by name and are inclusive, a phase
+ * running inside another one counts for both.
+ *
+ * @param name - name of the phase, a string that stays valid, usually a literal
+ * @return the timer to pass to profileEnd, not timing anything if PROFILE_MAX_PHASES
+ *         other phases exist or if called by another thread than the one set with
+ *         profileSetFrameThread(), or before it was set
+ */
+extern ProfileScope profileBegin(const char* name);
+
+/**
+ * Stop a phase timer and add its time to the current frame.
+ *
+ * @param scope - timer returned by profileBegin
+ */
+extern void profileEnd(ProfileScope scope);
+
+/**
+ * profileEnd for the cleanup of PROFILE_SCOPE.
+ *
+ * @param scope - timer to stop
+ */
+extern void profileEndScope(ProfileScope* scope);
+
+#define PROFILE_JOIN(a, b) a##b
+#define PROFILE_SCOPE_NAME(line) PROFILE_JOIN(profileScope, line)
+
+/**
+ * Time a phase until the end of the enclosing block, however it is left.
+ *
+ * @param name - name of the phase, see profileBegin
+ */
+#define PROFILE_SCOPE(name) \
+	ProfileScope PROFILE_SCOPE_NAME(__LINE__) __attribute__((cleanup(profileEndScope))) = profileBegin(name)
+
+/**
+ * Add to a counter of the current frame.
+ *
+ * @param counter - one of the PROFILE_* counters
+ * @param amount - value to add
+ */
+extern void profileCount(int counter, unsigned int amount);
+
+/**
+ * End the current frame and keep it in the history, called by flipScreen().
+ */
+extern void profileEndFrame();
+
+/**
+ * Get a frame from the history.
+ *
+ * @param age - 0 for the last ended frame, 1 for the one before, ...
+ * @return the frame, NULL if age is not less than the number of frames kept
+ */
+extern const ProfileFrame* profileGetFrame(int age);
+
+/**
+ * @return number of phases seen so far
+ */
+extern int profilePhaseCount();
+
+/**
+ * @param phase - index of a phase, less than profilePhaseCount()
+ * @return name of the phase
+ */
+extern const char* profilePhaseName(int phase);
+
+/**
+ * @param counter - one of the PROFILE_* counters
+ * @return name of the counter, as used in the CSV header
+ */
+extern const char* profileCounterName(int counter);
+
+/**
+ * Drop the history and the current frame. Phases stay known.
+ */
+extern void profileReset();
+
+/**
+ * Write the history as CSV, oldest frame first, one line per frame with its number, its
+ * time, the time of every phase and the counters, all times in microseconds.
+ *
+ * @param filename - file to write, NULL for stdout, see PROFILE_CSV_FILE
+ * @return 1 on success, 0 if the file could not be written
+ */
+extern int profileDumpCsv(const char* filename);
+
+#endif
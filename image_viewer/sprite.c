@@ -0,0 +1,39 @@
+#include <math.h>
+
+#include "sprite.h"
+
+/*
+ * A corner (cx, cy) of the source rectangle lands at
+ *
+ *   (x, y) + R(angle) * S(scale, flips) * ((cx, cy) - origin)
+ *
+ * built as one 3x3 matrix applied to (cx, cy, 1).
+ */
+
+void transformSprite(float corners[16], const SpriteTransform* transform, int width, int height)
+{
+	int i;
+	float scaleX = transform->scaleX / (float) FIXED_ONE;
+	float scaleY = transform->scaleY / (float) FIXED_ONE;
+	float angle = transform->angle * (2.0f * (float) M_PI / SPRITE_TURN);
+	float c = cosf(angle);
+	float s = sinf(angle);
+	float m00, m01, m10, m11, tx, ty;
+	float ox = transform->originX / (float) FIXED_ONE;
+	float oy = transform->originY / (float) FIXED_ONE;
+
+	if (transform->flags & SPRITE_FLIP_X) scaleX = -scaleX;
+	if (transform->flags & SPRITE_FLIP_Y) scaleY = -scaleY;
+	m00 = c * scaleX;
+	m10 = s * scaleX;
+	m01 = -s * scaleY;
+	m11 = c * scaleY;
+	tx = transform->x / (float) FIXED_ONE - (m00 * ox + m01 * oy);
+	ty = transform->y / (float) FIXED_ONE - (m10 * ox + m11 * oy);
+	for (i = 0; i < 4; i++) {
+		float cx = (i == 1 || i == 2) ? width : 0;
+		float cy = (i >= 2) ? height : 0;
+		corners[4 * i] = m00 * cx + m01 * cy + tx;
+		corners[4 * i + 1] = m10 * cx + m11 * cy + ty;
+	}
+}
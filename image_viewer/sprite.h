@@ -0,0 +1,39 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <psptypes.h>
+
+/** 16.16 fixed point number. */
+typedef int Fixed;
+
+#define FIXED_ONE 0x10000
+#define FIXED(x) ((Fixed) ((x) * FIXED_ONE))  // e.g. FIXED(1.5), meant for constants
+#define SPRITE_TURN 0x10000  // angle of a full turn
+
+#define SPRITE_FLIP_X 0x01  // mirror the sprite horizontally around its origin
+#define SPRITE_FLIP_Y 0x02  // mirror the sprite vertically around its origin
+
+/** Placement of a sprite on screen. */
+typedef struct
+{
+	Fixed x, y;  // screen position the origin is drawn at
+	Fixed originX, originY;  // pivot of rotation and scaling, in pixels from the top left of the source rectangle
+	Fixed scaleX, scaleY;  // FIXED_ONE draws the source rectangle at its size
+	int angle;  // clockwise rotation, SPRITE_TURN is a full turn
+	int flags;  // SPRITE_FLIP_X, SPRITE_FLIP_Y
+	u32 color;  // tint multiplied with the texels, 0xffffffff draws them as they are
+} SpriteTransform;
+
+/**
+ * Compute the screen positions of the corners of a transformed sprite.
+ *
+ * @pre transform != NULL
+ * @param corners - x and y of the top left, top right, bottom right and bottom left corner
+ *                  at corners[4 * i] and corners[4 * i + 1]
+ * @param transform - placement of the sprite
+ * @param width - width of the source rectangle
+ * @param height - height of the source rectangle
+ */
+extern void transformSprite(float corners[16], const SpriteTransform* transform, int width, int height);
+
+#endif
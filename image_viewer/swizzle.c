@@ -0,0 +1,13 @@
+#include <string.h>
+
+#include "swizzle.h"
+
+void swizzleRow(u8* out, int widthBytes, int y, const u8* row, int rowBytes)
+{
+	int x;
+	u8* dst = out + SWIZZLE_OFFSET(widthBytes, 0, y);
+	for (x = 0; x + SWIZZLE_BLOCK_WIDTH <= rowBytes; x += SWIZZLE_BLOCK_WIDTH, dst += 128) {
+		memcpy(dst, row + x, SWIZZLE_BLOCK_WIDTH);
+	}
+	if (x < rowBytes) memcpy(dst, row + x, rowBytes - x);
+}
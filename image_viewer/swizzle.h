@@ -0,0 +1,32 @@
+#ifndef SWIZZLE_H
+#define SWIZZLE_H
+
+#include <psptypes.h>
+
+#define SWIZZLE_BLOCK_WIDTH 16  // bytes
+#define SWIZZLE_BLOCK_HEIGHT 8  // rows
+
+/**
+ * Byte offset of a texel in a swizzled texture. The GE stores swizzled textures as
+ * 16 byte x 8 row blocks, left to right, top to bottom, each block 128 contiguous bytes.
+ *
+ * @param widthBytes - texture row size in bytes, a multiple of 16
+ * @param xBytes - byte offset of the texel in its row
+ * @param y - row of the texel
+ */
+#define SWIZZLE_OFFSET(widthBytes, xBytes, y) \
+	((((y) >> 3) * ((widthBytes) >> 4) + ((xBytes) >> 4)) * 128 + (((y) & 7) << 4) + ((xBytes) & 15))
+
+/**
+ * Store one linear row into a swizzled texture.
+ *
+ * @pre widthBytes % 16 == 0 && rowBytes <= widthBytes
+ * @param out - swizzled texture
+ * @param widthBytes - row size of the texture in bytes
+ * @param y - row to store
+ * @param row - linear row data, 4 byte aligned
+ * @param rowBytes - bytes of row to store, the rest of the texture row is left untouched
+ */
+extern void swizzleRow(u8* out, int widthBytes, int y, const u8* row, int rowBytes);
+
+#endif
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <pspkernel.h>
+
+#include "graphics.h"
+#include "blend.h"
+
+#define PIXELS (16 * 1024 * 1024)  // blitted per measurement
+
+/* The loops blitImageToImage() and blitAlphaImageToImage() had before the row kernels. */
+static void copyLoop(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination)
+{
+	Color* destinationData = (Color*) destination->data + destination->stride * dy + dx;
+	Color* sourceData = (Color*) source->data + source->stride * sy + sx;
+	int x, y;
+	for (y = 0; y < height; y++, destinationData += destination->stride - width, sourceData += source->stride - width) {
+		for (x = 0; x < width; x++, destinationData++, sourceData++) *destinationData = *sourceData;
+	}
+}
+
+static void alphaTestLoop(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination)
+{
+	Color* destinationData = (Color*) destination->data + destination->stride * dy + dx;
+	Color* sourceData = (Color*) source->data + source->stride * sy + sx;
+	int x, y;
+	for (y = 0; y < height; y++, destinationData += destination->stride - width, sourceData += source->stride - width) {
+		for (x = 0; x < width; x++, destinationData++, sourceData++) {
+			if ((*sourceData & 0xff000000) == 0xff000000) *destinationData = *sourceData;
+		}
+	}
+}
+
+/* The per-pixel kernel the target uses, for comparison with the host's vector rows. */
+static void blendLoop(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination)
+{
+	int x, y;
+	for (y = 0; y < height; y++) {
+		Color* out = (Color*) destination->data + destination->stride * (dy + y) + dx;
+		const Color* in = (const Color*) source->data + source->stride * (sy + y) + sx;
+		for (x = 0; x < width; x++) out[x] = blendColor(out[x], in[x]);
+	}
+}
+
+typedef void (*Blit)(int sx, int sy, int width, int height, Image* source, int dx, int dy, Image* destination);
+
+/* Megapixels per second of blits of a size x size sprite spread over the destination. */
+static double measure(Blit blit, Image* sprite, Image* destination, int size)
+{
+	int count = PIXELS / (size * size);
+	unsigned int start = sceKernelGetSystemTimeLow();
+	int i;
+	for (i = 0; i < count; i++) blit(0, 0, size, size, sprite, (i * 37) % (512 - size), (i * 91) % (512 - size), destination);
+	return (double) count * size * size / (sceKernelGetSystemTimeLow() - start + 1);
+}
+
+int main()
+{
+	static const int sizes[] = { 16, 32, 64, 128 };
+	Image* sprite;
+	Image* destination;
+	int i, x, y;
+	initGraphics();
+	sprite = createImage(128, 128);
+	destination = createImage(512, 512);
+	clearImage(0xff402010, destination);
+	// a round sprite, transparent corners, an antialiased edge and an opaque middle
+	for (y = 0; y < 128; y++) {
+		for (x = 0; x < 128; x++) {
+			int distance = (x - 64) * (x - 64) + (y - 64) * (y - 64);
+			u32 alpha = distance < 48 * 48 ? 255 : distance < 64 * 64 ? 255 * (64 * 64 - distance) / (64 * 64 - 48 * 48) : 0;
+			putPixelImage((alpha << 24) | (x * 2) | (y * 2) << 8 | 0x800000, x, y, sprite);
+		}
+	}
+	printf("bench_blend: megapixels per second, old loop vs new path\n");
+	for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		int size = sizes[i];
+		printf("bench_blend: %3dx%-3d copy %6.0f -> %6.0f, alpha test %6.0f -> blend %6.0f (scalar kernel %6.0f), premultiplied %6.0f\n",
+			size, size, measure(copyLoop, sprite, destination, size), measure(blitImageToImage, sprite, destination, size),
+			measure(alphaTestLoop, sprite, destination, size), measure(blitAlphaImageToImage, sprite, destination, size),
+			measure(blendLoop, sprite, destination, size), measure(blitPremultipliedImageToImage, sprite, destination, size));
+	}
+	freeImage(sprite);
+	freeImage(destination);
+	return 0;
+}
@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <string.h>
+#include <pspkernel.h>
+
+#include "graphics.h"
+#include "swizzle.h"
+
+#define WIDTH_BYTES 2048  // a 512 pixel 8888 texture
+#define ROWS 512
+#define PASSES 50
+#define LOADS 20
+
+static u8 __attribute__((aligned(16))) linear[WIDTH_BYTES * ROWS];
+static u8 __attribute__((aligned(16))) texture[WIDTH_BYTES * ROWS];
+
+/* Megabytes per second of PASSES copies of the texture, swizzled or linear. */
+static double rowThroughput(int swizzled)
+{
+	unsigned int start = sceKernelGetSystemTimeLow();
+	int pass, y;
+	for (pass = 0; pass < PASSES; pass++) {
+		for (y = 0; y < ROWS; y++) {
+			if (swizzled) swizzleRow(texture, WIDTH_BYTES, y, linear + y * WIDTH_BYTES, WIDTH_BYTES);
+			else memcpy(texture + y * WIDTH_BYTES, linear + y * WIDTH_BYTES, WIDTH_BYTES);
+		}
+	}
+	return (double) PASSES * sizeof(texture) / (sceKernelGetSystemTimeLow() - start + 1);
+}
+
+/* Milliseconds to load Background.png with the flags. */
+static double loadMillis(int flags)
+{
+	unsigned int start = sceKernelGetSystemTimeLow();
+	int i;
+	for (i = 0; i < LOADS; i++) freeImage(loadImageEx("Background.png", flags));
+	return (sceKernelGetSystemTimeLow() - start) / 1000.0 / LOADS;
+}
+
+int main()
+{
+	initGraphics();
+	memset(linear, 0x5a, sizeof(linear));
+	printf("bench_swizzle: rows linear %.0f MB/s, swizzled %.0f MB/s\n", rowThroughput(0), rowThroughput(1));
+	printf("bench_swizzle: Background.png linear %.2f ms, swizzled %.2f ms\n", loadMillis(0), loadMillis(IMAGE_SWIZZLE));
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+#include <pspkernel.h>
+
+#include "graphics.h"
+
+#define FRAMES 200
+#define LINES 24  // strings per frame, a text heavy HUD
+
+extern u8 msx[];
+
+/* printTextScreen() before the glyph atlas, font bits plotted into VRAM one pixel at a time. */
+static void printTextPlotted(int x, int y, const char* text, u32 color)
+{
+	int c, i, j;
+	u8* font;
+	Color* vram_ptr;
+	Color* vram;
+	for (c = 0; c < (int) strlen(text); c++) {
+		if (x < 0 || x + 8 > SCREEN_WIDTH || y < 0 || y + 8 > SCREEN_HEIGHT) break;
+		vram = getVramDrawBuffer() + x + y * PSP_LINE_SIZE;
+		font = &msx[(int) text[c] * 8];
+		for (i = 0; i < 8; i++, font++) {
+			vram_ptr = vram;
+			for (j = 0; j < 8; j++) {
+				if ((*font & (128 >> j))) *vram_ptr = color;
+				vram_ptr++;
+			}
+			vram += PSP_LINE_SIZE;
+		}
+		x += 8;
+	}
+}
+
+/*
+ * Characters per millisecond of CPU time in the text calls of FRAMES frames of LINES strings.
+ * Flips are left out, they wait for vblank and, on the host, run the software GE.
+ */
+static double measure(int plotted, int changing, int synced)
+{
+	char text[LINES][64];
+	unsigned int micros = 0;
+	unsigned int start;
+	int characters = 0;
+	int frame, line;
+	for (frame = 0; frame < FRAMES; frame++) {
+		for (line = 0; line < LINES; line++) {
+			// changing text misses the text cache, like a running counter
+			snprintf(text[line], sizeof(text[line]), "line %2d score %08d lives 3", line, changing ? frame * LINES + line : line);
+			characters += strlen(text[line]);
+		}
+		clearScreen(0xff000000);
+		// the first getVramDrawBuffer() of a frame waits for the GE and the swap
+		if (synced) getVramDrawBuffer();
+		start = sceKernelGetSystemTimeLow();
+		for (line = 0; line < LINES; line++) {
+			if (plotted) printTextPlotted(8, 8 + line * 10, text[line], 0xffffffff);
+			else printTextScreen(8, 8 + line * 10, text[line], 0xffffffff);
+		}
+		micros += sceKernelGetSystemTimeLow() - start;
+		flipScreen();
+	}
+	return characters / (micros / 1000.0);
+}
+
+int main()
+{
+	initGraphics();
+	printf("bench_text: characters per millisecond, %d strings per frame\n", LINES);
+	printf("bench_text: plotted %.0f, plotted after the GE wait %.0f, atlas %.0f, atlas with unchanged text %.0f\n",
+		measure(1, 1, 0), measure(1, 1, 1), measure(0, 1, 0), measure(0, 0, 0));
+	printf("bench_text: text cache hits %d misses %d\n", getTextCacheStats()->hits, getTextCacheStats()->misses);
+	return 0;
+}
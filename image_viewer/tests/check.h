@@ -0,0 +1,37 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+/* Checks of the host tests, a failed check is printed and the test goes on. */
+
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { \
+		long long expectedValue = (expected); \
+		long long actualValue = (actual); \
+		if (expectedValue != actualValue) { \
+			printf("%s:%d: check failed: %s == %s, %lld != %lld\n", __FILE__, __LINE__, #expected, #actual, \
+				expectedValue, actualValue); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+/* Print the outcome of a test, the return value is its exit status. */
+static int checkResult(const char* test)
+{
+	if (checkFailures) printf("%s: %d checks failed\n", test, checkFailures);
+	else printf("%s: passed\n", test);
+	return checkFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "atlas.h"
+#include "check.h"
+
+#define WORK_DIR "host/build/tests/"  // the tests run from the image_viewer directory
+#define SPRITE_DIR WORK_DIR "sprites"
+#define ATLAS_FILE WORK_DIR "test.atlas"
+#define SPRITE_COUNT 3
+
+static const char* names[SPRITE_COUNT] = { "bush", "coin", "player" };
+
+/* Write one PNG per sprite, each of its own size and color, and pack them with atlaspack. */
+static int buildAtlas()
+{
+	char path[256];
+	int i;
+	mkdir(SPRITE_DIR, 0755);
+	for (i = 0; i < SPRITE_COUNT; i++) {
+		Image* image = createImage(8 + 4 * i, 6 + i);
+		if (!image) return 0;
+		clearImage(0xff000000 | (0x40 << (8 * i)), image);
+		snprintf(path, sizeof(path), SPRITE_DIR "/%s.png", names[i]);
+		saveImageFile(path, image, 1);
+		freeImage(image);
+	}
+	return system("./atlaspack " SPRITE_DIR " " ATLAS_FILE " > /dev/null") == 0;
+}
+
+static void testLookup()
+{
+	Atlas* atlas = loadAtlas(ATLAS_FILE);
+	int i;
+	CHECK(atlas != NULL);
+	if (!atlas) return;
+	CHECK_EQUAL(SPRITE_COUNT, atlas->entryCount);
+	for (i = 0; i < SPRITE_COUNT; i++) {
+		const AtlasEntry* entry = findAtlasEntry(atlas, names[i]);
+		CHECK(entry != NULL);
+		if (!entry) continue;
+		CHECK_EQUAL(8 + 4 * i, entry->width);
+		CHECK_EQUAL(6 + i, entry->height);
+		CHECK_EQUAL(0xff000000 | (0x40 << (8 * i)), getPixelImage(entry->x, entry->y, atlas->pages[entry->page]));
+	}
+	CHECK(findAtlasEntry(atlas, "coins") == NULL);
+	CHECK(findAtlasEntry(atlas, "") == NULL);
+	freeAtlas(atlas);
+}
+
+/* Whether loadAtlas() rejects the index with two entries changed as given. */
+static int rejects(const u8* index, int size, int first, int second, int duplicate)
+{
+	u8* copy = (u8*) malloc(size);
+	AtlasEntry* entries = (AtlasEntry*) (copy + sizeof(AtlasHeader));
+	AtlasEntry entry;
+	Atlas* atlas;
+	FILE* fp;
+	memcpy(copy, index, size);
+	entry = entries[first];
+	entries[first] = entries[second];
+	entries[second] = duplicate ? entries[first] : entry;
+	fp = fopen(ATLAS_FILE, "wb");
+	fwrite(copy, 1, size, fp);
+	fclose(fp);
+	free(copy);
+	atlas = loadAtlas(ATLAS_FILE);
+	if (atlas) freeAtlas(atlas);
+	return atlas == NULL;
+}
+
+static void testUnsorted()
+{
+	FILE* fp = fopen(ATLAS_FILE, "rb");
+	u8* index;
+	int size;
+	CHECK(fp != NULL);
+	if (!fp) return;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	index = (u8*) malloc(size);
+	CHECK(fread(index, 1, size, fp) == (size_t) size);
+	fclose(fp);
+	CHECK(!rejects(index, size, 0, 0, 0));
+	CHECK(rejects(index, size, 0, 1, 0));
+	CHECK(rejects(index, size, 0, 2, 0));
+	CHECK(rejects(index, size, 1, 2, 1));
+	// the original index loads again
+	CHECK(!rejects(index, size, 0, 0, 0));
+	free(index);
+}
+
+int main()
+{
+	initGraphics();
+	CHECK(buildAtlas());
+	testLookup();
+	testUnsorted();
+	return checkResult("test_atlas");
+}
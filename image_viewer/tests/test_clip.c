@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+
+#include "clip.h"
+#include "check.h"
+
+#define LEFT 0
+#define TOP 0
+#define RIGHT 479
+#define BOTTOM 271
+
+/* Clip a line to the screen and check the result against the expected end points. */
+static int clipsTo(int x0, int y0, int x1, int y1, int ex0, int ey0, int ex1, int ey1)
+{
+	if (!clipLine(&x0, &y0, &x1, &y1, LEFT, TOP, RIGHT, BOTTOM)) return 0;
+	return x0 == ex0 && y0 == ey0 && x1 == ex1 && y1 == ey1;
+}
+
+static int misses(int x0, int y0, int x1, int y1)
+{
+	return !clipLine(&x0, &y0, &x1, &y1, LEFT, TOP, RIGHT, BOTTOM);
+}
+
+static void testInsideOutside()
+{
+	CHECK(clipsTo(10, 20, 300, 200, 10, 20, 300, 200));
+	CHECK(clipsTo(0, 0, 479, 271, 0, 0, 479, 271));
+	CHECK(misses(-10, -10, -1, 500));
+	CHECK(misses(480, 0, 600, 271));
+	CHECK(misses(0, -5, 479, -1));
+	CHECK(misses(0, 272, 479, 300));
+	// outside on different sides, passing by the top left corner
+	CHECK(misses(-10, 5, 5, -10));
+	CHECK(misses(-100, 50, 50, -101));
+}
+
+static void testAxisAligned()
+{
+	CHECK(clipsTo(-50, 100, 600, 100, 0, 100, 479, 100));
+	CHECK(clipsTo(600, 100, -50, 100, 479, 100, 0, 100));
+	CHECK(clipsTo(200, -30, 200, 400, 200, 0, 200, 271));
+	CHECK(clipsTo(200, 400, 200, -30, 200, 271, 200, 0));
+	CHECK(clipsTo(0, -1, 0, 0, 0, 0, 0, 0));
+	CHECK(misses(-1, -10, -1, 400));
+	CHECK(misses(-10, 272, 500, 272));
+}
+
+static void testCorners()
+{
+	// diagonals through the corners
+	CHECK(clipsTo(-10, -10, 500, 500, 0, 0, 271, 271));
+	CHECK(clipsTo(489, -10, 200, 279, 479, 0, 208, 271));
+	// a line touching only the corner pixel
+	CHECK(clipsTo(-1, 1, 1, -1, 0, 0, 0, 0));
+	CHECK(clipsTo(478, -1, 480, 1, 479, 0, 479, 0));
+	// outside two borders at each end, cutting off a corner
+	CHECK(clipsTo(-20, 30, 30, -20, 0, 10, 10, 0));
+	CHECK(clipsTo(440, 300, 500, 240, 469, 271, 479, 261));
+}
+
+static void testHuge()
+{
+	CHECK(clipsTo(INT_MIN, 100, INT_MAX, 100, 0, 100, 479, 100));
+	CHECK(clipsTo(240, INT_MIN, 240, INT_MAX, 240, 0, 240, 271));
+	CHECK(misses(INT_MIN, INT_MIN, INT_MIN, INT_MAX));
+	CHECK(misses(INT_MAX, INT_MIN, INT_MAX, INT_MAX));
+	CHECK(!misses(INT_MIN, INT_MIN, INT_MAX, INT_MAX));
+	CHECK(!misses(-1000000000, 136, 1000000000, 136));
+}
+
+/* Distance of a point from the line through two others. */
+static double lineDistance(double x, double y, double x0, double y0, double x1, double y1)
+{
+	double dx = x1 - x0, dy = y1 - y0;
+	double length = sqrt(dx * dx + dy * dy);
+	if (length == 0) return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0));
+	return fabs(dy * (x - x0) - dx * (y - y0)) / length;
+}
+
+/* Clipped end points are inside, near the original line and within its bounds. */
+static void testRandom()
+{
+	int i, outside = 0, offLine = 0, outOfBounds = 0, lost = 0;
+	srand(1);
+	for (i = 0; i < 100000; i++) {
+		int x0 = rand() % 2000 - 760, y0 = rand() % 1200 - 464;
+		int x1 = rand() % 2000 - 760, y1 = rand() % 1200 - 464;
+		int cx0 = x0, cy0 = y0, cx1 = x1, cy1 = y1;
+		int inside0 = x0 >= LEFT && x0 <= RIGHT && y0 >= TOP && y0 <= BOTTOM;
+		int inside1 = x1 >= LEFT && x1 <= RIGHT && y1 >= TOP && y1 <= BOTTOM;
+		if (!clipLine(&cx0, &cy0, &cx1, &cy1, LEFT, TOP, RIGHT, BOTTOM)) {
+			if (inside0 || inside1) lost++;
+			continue;
+		}
+		if (cx0 < LEFT || cx0 > RIGHT || cy0 < TOP || cy0 > BOTTOM) outside++;
+		if (cx1 < LEFT || cx1 > RIGHT || cy1 < TOP || cy1 > BOTTOM) outside++;
+		// one rounding per move, a point moves at most twice
+		if (lineDistance(cx0, cy0, x0, y0, x1, y1) > 1.5 || lineDistance(cx1, cy1, x0, y0, x1, y1) > 1.5) offLine++;
+		if (cx0 < (x0 < x1 ? x0 : x1) || cx0 > (x0 > x1 ? x0 : x1) || cy0 < (y0 < y1 ? y0 : y1) || cy0 > (y0 > y1 ? y0 : y1)) outOfBounds++;
+		// an end point inside stays where it is
+		if ((inside0 && (cx0 != x0 || cy0 != y0)) || (inside1 && (cx1 != x1 || cy1 != y1))) outOfBounds++;
+	}
+	CHECK_EQUAL(0, lost);
+	CHECK_EQUAL(0, outside);
+	CHECK_EQUAL(0, offLine);
+	CHECK_EQUAL(0, outOfBounds);
+}
+
+int main()
+{
+	testInsideOutside();
+	testAxisAligned();
+	testCorners();
+	testHuge();
+	testRandom();
+	return checkResult("test_clip");
+}
@@ -0,0 +1,118 @@
+#include "imagealloc.h"
+#include "check.h"
+
+#define LARGE_SIZE 100000
+#define LARGE_BYTES (104 * 1024)  // LARGE_SIZE and its header, rounded up to 8 KB steps
+
+static const ImageAllocStats* stats()
+{
+	return getImageAllocStats();
+}
+
+static void testClassReuse()
+{
+	void* a = allocImageMemory(100);
+	void* b;
+	void* c;
+	CHECK(a != NULL && ((unsigned long) a & 15) == 0);
+	CHECK_EQUAL(128, stats()->liveBytes);
+	CHECK_EQUAL(128 - 100, stats()->wasteBytes);
+	freeImageMemory(a);
+	CHECK_EQUAL(0, stats()->liveBytes);
+	CHECK_EQUAL(0, stats()->wasteBytes);
+	// the freed block is the first one of its class again
+	b = allocImageMemory(120);
+	CHECK(b == a);
+	// 90 bytes fit the 96 byte class, another page
+	c = allocImageMemory(90);
+	CHECK(c != NULL && c != b);
+	CHECK_EQUAL(2, stats()->slabPages);
+	CHECK_EQUAL(128 - 120 + 96 - 90 + IMAGE_SLAB_PAGE_SIZE % 96, stats()->wasteBytes);
+	freeImageMemory(b);
+	freeImageMemory(c);
+	CHECK_EQUAL(0, stats()->wasteBytes);
+}
+
+static void testPageReturn()
+{
+	int perPage = IMAGE_SLAB_PAGE_SIZE / 4096;
+	void* blocks[IMAGE_SLAB_PAGE_SIZE / 4096 * 3];
+	int heapBytes = stats()->heapBytes;
+	int i;
+	CHECK_EQUAL(0, stats()->slabPages);
+	for (i = 0; i < perPage * 3; i++) blocks[i] = allocImageMemory(4096);
+	CHECK_EQUAL(3, stats()->slabPages);
+	CHECK_EQUAL(0, stats()->slabFreeBytes);
+	CHECK_EQUAL(0, stats()->fragmentation);
+	for (i = 0; i < perPage * 3; i += 2) freeImageMemory(blocks[i]);
+	CHECK_EQUAL(3 * IMAGE_SLAB_PAGE_SIZE / 2, stats()->slabFreeBytes);
+	CHECK_EQUAL(50, stats()->fragmentation);
+	for (i = 1; i < perPage * 3; i += 2) freeImageMemory(blocks[i]);
+	CHECK_EQUAL(0, stats()->slabPages);
+	CHECK_EQUAL(0, stats()->slabFreeBytes);
+	CHECK_EQUAL(0, stats()->liveBytes);
+	// one empty page stays as the spare, the others went back to the heap
+	CHECK_EQUAL(heapBytes, stats()->heapBytes);
+}
+
+static void testLargePool()
+{
+	void* a = allocImageMemory(LARGE_SIZE);
+	void* b;
+	int heapBytes;
+	CHECK(a != NULL && ((unsigned long) a & 15) == 0);
+	CHECK_EQUAL(LARGE_BYTES, stats()->largeBytes);
+	CHECK_EQUAL(LARGE_BYTES - 16 - LARGE_SIZE, stats()->wasteBytes);
+	heapBytes = stats()->heapBytes;
+	freeImageMemory(a);
+	CHECK_EQUAL(0, stats()->largeBytes);
+	CHECK_EQUAL(LARGE_BYTES, stats()->largePoolBytes);
+	CHECK_EQUAL(heapBytes, stats()->heapBytes);
+	// a slightly smaller block rounds to the same size and takes the pooled one
+	b = allocImageMemory(LARGE_SIZE - 1000);
+	CHECK(b == a);
+	CHECK_EQUAL(0, stats()->largePoolBytes);
+	CHECK_EQUAL(heapBytes, stats()->heapBytes);
+	freeImageMemory(b);
+}
+
+static void testArenaReset()
+{
+	ImageArena* arena = createImageArena(1024);
+	void* a;
+	void* b;
+	int liveBytes = stats()->liveBytes;
+	int failures;
+	CHECK(arena != NULL);
+	a = allocArenaMemory(arena, 100);
+	b = allocArenaMemory(arena, 200);
+	CHECK(a != NULL && b != NULL && findImageArena(b) == arena);
+	CHECK_EQUAL(16 + 112 + 16 + 208, arena->used);
+	CHECK_EQUAL(arena->used, stats()->arenaBytes);
+	CHECK_EQUAL(liveBytes + arena->used, stats()->liveBytes);
+	freeImageMemory(a);
+	CHECK_EQUAL(16 + 112, arena->deadBytes);
+	CHECK_EQUAL(16 + 112, stats()->arenaDeadBytes);
+	CHECK_EQUAL(liveBytes + 16 + 208, stats()->liveBytes);
+	failures = stats()->failures;
+	CHECK(allocArenaMemory(arena, 1024) == NULL);
+	CHECK_EQUAL(failures + 1, stats()->failures);
+	clearImageArena(arena);
+	CHECK_EQUAL(0, arena->used);
+	CHECK_EQUAL(0, stats()->arenaBytes);
+	CHECK_EQUAL(0, stats()->arenaDeadBytes);
+	CHECK_EQUAL(liveBytes, stats()->liveBytes);
+	CHECK(allocArenaMemory(arena, 1024 - 16) != NULL);
+	destroyImageArena(arena);
+	CHECK_EQUAL(liveBytes, stats()->liveBytes);
+}
+
+int main()
+{
+	initImageAllocator();
+	testClassReuse();
+	testPageReturn();
+	testLargePool();
+	testArenaReset();
+	return checkResult("test_imagealloc");
+}
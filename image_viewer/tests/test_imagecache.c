@@ -0,0 +1,71 @@
+#include "imagecache.h"
+#include "imagealloc.h"
+#include "check.h"
+
+#define IMAGE_FILE "Background.png"
+
+static void testDeferredFree(int images)
+{
+	Image* image = acquireImage(IMAGE_FILE, 0);
+	int bytes;
+	CHECK(image != NULL);
+	bytes = getImageBytes(image);
+	setImageCacheBudget(0);
+	// the frame drawing the image is still recorded, eviction must not free it
+	blitAlphaImageToScreen(0, 0, image->imageWidth, image->imageHeight, image, 0, 0);
+	releaseImage(image);
+	CHECK_EQUAL(0, getImageCacheStats()->entries);
+	CHECK_EQUAL(bytes, getImageCacheStats()->retiredBytes);
+	CHECK_EQUAL(images + 1, getImageMemoryStats()->images);
+	flushImageCache();
+	CHECK_EQUAL(images + 1, getImageMemoryStats()->images);
+	// once the GE drew the frame the next cache call frees the image
+	flipScreen();
+	waitFrameFence(getFrameFence());
+	flushImageCache();
+	CHECK_EQUAL(0, getImageCacheStats()->retiredBytes);
+	CHECK_EQUAL(images, getImageMemoryStats()->images);
+	setImageCacheBudget(IMAGE_CACHE_DEFAULT_BUDGET);
+}
+
+static void testUndrawnFree(int images)
+{
+	Image* image = acquireImage(IMAGE_FILE, 0);
+	CHECK(image != NULL);
+	releaseImage(image);
+	CHECK_EQUAL(1, flushImageCache());
+	CHECK_EQUAL(0, getImageCacheStats()->retiredBytes);
+	CHECK_EQUAL(images, getImageMemoryStats()->images);
+}
+
+static void testNoArena(int images)
+{
+	ImageArena* arena = createImageArena(1024 * 1024);
+	Image* cached;
+	Image* level;
+	CHECK(arena != NULL);
+	setImageArena(arena);
+	cached = acquireImage(IMAGE_FILE, IMAGE_FORMAT_4444);
+	level = loadImageEx(IMAGE_FILE, IMAGE_FORMAT_4444);
+	CHECK(cached != NULL && level != NULL);
+	CHECK(findImageArena(cached->data) == NULL);
+	CHECK(findImageArena(level->data) == arena);
+	CHECK(getImageArena() == arena);
+	setImageArena(NULL);
+	resetImageArena(arena);
+	destroyImageArena(arena);
+	releaseImage(cached);
+	CHECK_EQUAL(1, flushImageCache());
+	CHECK_EQUAL(images, getImageMemoryStats()->images);
+}
+
+int main()
+{
+	int images;
+	initGraphics();
+	images = getImageMemoryStats()->images;
+	testDeferredFree(images);
+	testUndrawnFree(images);
+	testNoArena(images);
+	return checkResult("test_imagecache");
+}
@@ -0,0 +1,95 @@
+#include <pspkernel.h>
+
+#include "loader.h"
+#include "check.h"
+
+#define WAIT_MICROS 1000
+#define WAIT_LIMIT 5000  // waits before a test gives up, five seconds
+
+static int delivered;
+static int deliveredImages;
+
+static void done(LoadRequest request, Image* image, void* user)
+{
+	delivered++;
+	if (image) {
+		deliveredImages++;
+		freeImage(image);
+	}
+}
+
+/* Poll until no request is pending and the images of cancelled ones are freed. */
+static void pollUntilIdle(int images)
+{
+	int waits = 0;
+	for (;;) {
+		pollLoader();
+		if ((getLoaderProgress().pending == 0 && getImageMemoryStats()->images == images) || ++waits == WAIT_LIMIT) break;
+		sceKernelDelayThread(WAIT_MICROS);
+	}
+	CHECK(waits < WAIT_LIMIT);
+}
+
+static void testDeliver(int images)
+{
+	LoaderProgress progress;
+	int i;
+	resetLoaderProgress();
+	delivered = deliveredImages = 0;
+	for (i = 0; i < 4; i++) CHECK(requestImageLoad("Background.png", 0, i, done, NULL) != 0);
+	CHECK(requestImageLoad("missing.png", 0, 0, done, NULL) != 0);
+	pollUntilIdle(images);
+	progress = getLoaderProgress();
+	CHECK_EQUAL(5, progress.requested);
+	CHECK_EQUAL(4, progress.loaded);
+	CHECK_EQUAL(1, progress.failed);
+	CHECK_EQUAL(0, progress.pending);
+	CHECK_EQUAL(5, delivered);
+	CHECK_EQUAL(4, deliveredImages);
+}
+
+static void testCancelAll(int images)
+{
+	LoaderProgress progress;
+	int i;
+	resetLoaderProgress();
+	delivered = 0;
+	for (i = 0; i < 8; i++) requestImageLoad("Background.png", 0, 0, done, NULL);
+	cancelAllLoads();
+	// the image being loaded was freed on this thread before cancelAllLoads() returned
+	CHECK_EQUAL(images, getImageMemoryStats()->images);
+	progress = getLoaderProgress();
+	CHECK_EQUAL(8, progress.cancelled);
+	CHECK_EQUAL(0, progress.pending);
+	CHECK_EQUAL(0, pollLoader());
+	CHECK_EQUAL(0, delivered);
+}
+
+static void testCancelLoading(int images)
+{
+	LoadRequest request;
+	int state, waits = 0;
+	resetLoaderProgress();
+	delivered = 0;
+	request = requestImageLoad("Background.png", 0, 0, done, NULL);
+	while ((state = getLoadState(request)) == LOAD_QUEUED && ++waits < WAIT_LIMIT) sceKernelDelayThread(WAIT_MICROS);
+	CHECK(state == LOAD_LOADING || state == LOAD_DONE);
+	CHECK_EQUAL(1, cancelLoad(request));
+	CHECK_EQUAL(0, cancelLoad(request));
+	CHECK_EQUAL(LOAD_FREE, getLoadState(request));
+	pollUntilIdle(images);
+	CHECK_EQUAL(0, delivered);
+	CHECK_EQUAL(1, getLoaderProgress().cancelled);
+}
+
+int main()
+{
+	int images;
+	initGraphics();
+	images = getImageMemoryStats()->images;
+	testDeliver(images);
+	testCancelAll(images);
+	testCancelLoading(images);
+	CHECK_EQUAL(images, getImageMemoryStats()->images);
+	return checkResult("test_loader");
+}
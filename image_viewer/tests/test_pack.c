@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "pack.h"
+#include "check.h"
+
+#define WORK_DIR "host/build/tests/"  // the tests run from the image_viewer directory
+#define PACK_DIR WORK_DIR "pack"
+#define PACK_FILE WORK_DIR "test.pak"
+#define CORRUPT_FILE WORK_DIR "corrupt.pak"
+#define FILE_COUNT 4
+#define NAME_SIZE 32
+#define BUCKETS 4  // assetpack's bucket count for FILE_COUNT files
+
+static char names[FILE_COUNT][NAME_SIZE];
+static char contents[FILE_COUNT][4096];
+static int sizes[FILE_COUNT];
+
+static int writeFile(const char* path, const void* data, int size)
+{
+	FILE* fp = fopen(path, "wb");
+	if (!fp) return 0;
+	fwrite(data, 1, size, fp);
+	return fclose(fp) == 0;
+}
+
+static u8* readFile(const char* path, int* size)
+{
+	FILE* fp = fopen(path, "rb");
+	u8* data;
+	if (!fp) return NULL;
+	fseek(fp, 0, SEEK_END);
+	*size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	data = (u8*) malloc(*size);
+	if (data && fread(data, 1, *size, fp) != (size_t) *size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(fp);
+	return data;
+}
+
+/*
+ * Write the files and pack them with assetpack. "a.txt" and a second name share a
+ * bucket, the text file deflates, the random one is stored.
+ */
+static int buildPack()
+{
+	char path[256];
+	u32 bucket = hashPackName("a.txt") & (BUCKETS - 1);
+	int i, n;
+	strcpy(names[0], "a.txt");
+	for (n = 0;; n++) {
+		sprintf(names[1], "b%d.txt", n);
+		if ((hashPackName(names[1]) & (BUCKETS - 1)) == bucket) break;
+	}
+	strcpy(names[2], "sub/random.bin");
+	strcpy(names[3], "sub/empty");
+	for (i = 0; i < 4000; i++) contents[0][i] = "pack "[i % 5];
+	sizes[0] = 4000;
+	sizes[1] = sprintf(contents[1], "the other file of bucket %u", bucket);
+	for (i = 0; i < 3000; i++) contents[2][i] = rand();
+	sizes[2] = 3000;
+	sizes[3] = 0;
+	mkdir(PACK_DIR, 0755);
+	mkdir(PACK_DIR "/sub", 0755);
+	for (i = 0; i < FILE_COUNT; i++) {
+		snprintf(path, sizeof(path), PACK_DIR "/%s", names[i]);
+		if (!writeFile(path, contents[i], sizes[i])) return 0;
+	}
+	return system("./assetpack " PACK_DIR " " PACK_FILE " > /dev/null") == 0;
+}
+
+static void testLookup(Pack* pack)
+{
+	const PackEntry* first;
+	const PackEntry* second;
+	u32 bucket = hashPackName(names[0]) & (BUCKETS - 1);
+	PackStats stats;
+	int i, size;
+	CHECK_EQUAL(FILE_COUNT, pack->entryCount);
+	CHECK_EQUAL(BUCKETS, pack->bucketCount);
+	resetPackStats(pack);
+	for (i = 0; i < FILE_COUNT; i++) {
+		void* data = loadPackEntry(pack, names[i], &size);
+		CHECK(data != NULL);
+		if (!data) continue;
+		CHECK_EQUAL(sizes[i], size);
+		CHECK(memcmp(data, contents[i], size) == 0);
+		CHECK(strcmp(getPackEntryName(pack, findPackEntry(pack, names[i])), names[i]) == 0);
+		free(data);
+	}
+	// both names of the shared bucket are found, each only compared with itself
+	first = findPackEntry(pack, names[0]);
+	second = findPackEntry(pack, names[1]);
+	CHECK(first && second && first != second);
+	CHECK(pack->buckets[bucket + 1] - pack->buckets[bucket] >= 2);
+	CHECK(findPackEntry(pack, "missing.txt") == NULL);
+	CHECK(findPackEntry(pack, "sub") == NULL);
+	CHECK(loadPackEntry(pack, "A.TXT", &size) == NULL);
+	stats = getPackStats(pack);
+	CHECK_EQUAL(2 * FILE_COUNT + 5, stats.lookups);
+	CHECK_EQUAL(3, stats.misses);
+	CHECK_EQUAL(2 * FILE_COUNT + 2, stats.compares);
+	CHECK_EQUAL(FILE_COUNT, stats.reads);
+}
+
+static void testDeflate(Pack* pack)
+{
+	const PackEntry* text = findPackEntry(pack, names[0]);
+	const PackEntry* random = findPackEntry(pack, names[2]);
+	CHECK(text && text->compression == PACK_COMPRESSION_DEFLATE && text->storedSize < text->size);
+	CHECK(random && random->compression == PACK_COMPRESSION_NONE && random->storedSize == random->size);
+	CHECK(text && text->offset % 64 == 0);
+	CHECK_EQUAL(sizes[0], getPackStats(pack).bytesInflated);
+}
+
+/* Whether openPack() rejects the pack with some bytes changed or cut. */
+static int rejects(const u8* pack, int size, int offset, const void* bytes, int count, int keep)
+{
+	u8* copy = (u8*) malloc(size);
+	Pack* opened;
+	memcpy(copy, pack, size);
+	memcpy(copy + offset, bytes, count);
+	writeFile(CORRUPT_FILE, copy, keep);
+	free(copy);
+	opened = openPack(CORRUPT_FILE);
+	if (opened) closePack(opened);
+	return opened == NULL;
+}
+
+static void testCorrupt()
+{
+	int size, header = sizeof(PackHeader), entries = FILE_COUNT * sizeof(PackEntry);
+	int buckets = header + entries, namesStart = buckets + (BUCKETS + 1) * sizeof(u32);
+	u8* pack = readFile(PACK_FILE, &size);
+	PackHeader* h = (PackHeader*) pack;
+	PackEntry entry;
+	u32 value;
+	CHECK(pack != NULL);
+	if (!pack) return;
+	CHECK(!rejects(pack, size, 0, pack, 0, size));
+	// cut in the index and in the data
+	CHECK(rejects(pack, size, 0, pack, 0, namesStart));
+	CHECK(rejects(pack, size, 0, pack, 0, size - 1));
+	value = 0;
+	CHECK(rejects(pack, size, 0, &value, 4, size));
+	value = 3;
+	CHECK(rejects(pack, size, 12, &value, 4, size));
+	value = h->indexSize + 1000000;
+	CHECK(rejects(pack, size, 16, &value, 4, size));
+	// buckets out of order or not ending at the entry count
+	value = FILE_COUNT + 1;
+	CHECK(rejects(pack, size, buckets + sizeof(u32), &value, 4, size));
+	CHECK(rejects(pack, size, buckets + BUCKETS * sizeof(u32), &value, 4, size));
+	// an entry in the wrong bucket, past the names or the file, or of an unknown compression
+	memcpy(&entry, pack + header, sizeof(entry));
+	entry.hash++;
+	CHECK(rejects(pack, size, header, &entry, sizeof(entry), size));
+	memcpy(&entry, pack + header, sizeof(entry));
+	entry.name = h->indexSize;
+	CHECK(rejects(pack, size, header, &entry, sizeof(entry), size));
+	memcpy(&entry, pack + header, sizeof(entry));
+	entry.storedSize = size;
+	CHECK(rejects(pack, size, header, &entry, sizeof(entry), size));
+	memcpy(&entry, pack + header, sizeof(entry));
+	entry.compression = 7;
+	CHECK(rejects(pack, size, header, &entry, sizeof(entry), size));
+	// names not terminated
+	CHECK(rejects(pack, size, header + h->indexSize - 1, "x", 1, size));
+	free(pack);
+}
+
+int main()
+{
+	Pack* pack;
+	CHECK(buildPack());
+	pack = openPack(PACK_FILE);
+	CHECK(pack != NULL);
+	if (pack) {
+		testLookup(pack);
+		testDeflate(pack);
+		closePack(pack);
+	}
+	testCorrupt();
+	return checkResult("test_pack");
+}
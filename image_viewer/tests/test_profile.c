@@ -0,0 +1,60 @@
+#include <pspkernel.h>
+
+#include "profile.h"
+#include "check.h"
+
+static volatile int otherPhase;
+static volatile int otherDone;
+
+static int otherThread(SceSize args, void* argp)
+{
+	ProfileScope scope = profileBegin("other");
+	otherPhase = scope.phase;
+	profileEnd(scope);
+	otherDone = 1;
+	return 0;
+}
+
+static void testBeforeFrameThread()
+{
+	ProfileScope scope = profileBegin("early");
+	CHECK_EQUAL(-1, scope.phase);
+	profileEnd(scope);
+	CHECK_EQUAL(0, profilePhaseCount());
+}
+
+static void testOtherThread()
+{
+	SceUID thread = sceKernelCreateThread("other", otherThread, 0x20, 0x1000, 0, NULL);
+	CHECK(thread >= 0);
+	otherPhase = 0;
+	CHECK_EQUAL(0, sceKernelStartThread(thread, 0, NULL));
+	while (!otherDone) sceKernelDelayThread(1000);
+	CHECK_EQUAL(-1, otherPhase);
+}
+
+static void testFrameThread()
+{
+	ProfileScope outer = profileBegin("frame");
+	ProfileScope inner = profileBegin("inner");
+	CHECK_EQUAL(0, outer.phase);
+	CHECK_EQUAL(1, inner.phase);
+	// a phase begun again is found by name
+	CHECK_EQUAL(0, profileBegin("frame").phase);
+	profileEnd(inner);
+	profileEnd(outer);
+	profileEndFrame();
+	CHECK_EQUAL(2, profilePhaseCount());
+	CHECK(profileGetFrame(0) != NULL && profileGetFrame(0)->number == 0);
+}
+
+int main()
+{
+	testBeforeFrameThread();
+	profileSetFrameThread();
+	testFrameThread();
+	testOtherThread();
+	// the other thread added no phase
+	CHECK_EQUAL(2, profilePhaseCount());
+	return checkResult("test_profile");
+}
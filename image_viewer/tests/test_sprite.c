@@ -0,0 +1,107 @@
+#include <math.h>
+
+#include "sprite.h"
+#include "check.h"
+
+#define TOLERANCE (1.0f / 64)  // pixels, well below what the GE's subpixel positions resolve
+
+static SpriteTransform placement(float x, float y, float originX, float originY)
+{
+	SpriteTransform transform = { FIXED(x), FIXED(y), FIXED(originX), FIXED(originY), FIXED_ONE, FIXED_ONE, 0, 0, 0xffffffff };
+	return transform;
+}
+
+/* Whether the corners are the expected ones, top left first, clockwise. */
+static int cornersAre(const SpriteTransform* transform, int width, int height, const float expected[8])
+{
+	float corners[16];
+	int i, same = 1;
+	transformSprite(corners, transform, width, height);
+	for (i = 0; i < 8; i++) {
+		if (fabsf(corners[4 * (i / 2) + i % 2] - expected[i]) > TOLERANCE) same = 0;
+	}
+	return same;
+}
+
+static void testPlacements()
+{
+	static const float moved[8] = { 10, 20, 42, 20, 42, 36, 10, 36 };
+	static const float centered[8] = { 84, 42, 116, 42, 116, 58, 84, 58 };
+	static const float turned[8] = { 0, 0, 0, 32, -16, 32, -16, 0 };
+	static const float flipped[8] = { 116, 58, 84, 58, 84, 42, 116, 42 };
+	static const float scaled[8] = { 68, 34, 132, 34, 132, 66, 68, 66 };
+	SpriteTransform transform = placement(10, 20, 0, 0);
+	CHECK(cornersAre(&transform, 32, 16, moved));
+	transform = placement(100, 50, 16, 8);
+	CHECK(cornersAre(&transform, 32, 16, centered));
+	// a quarter turn is clockwise on screen, y points down
+	transform = placement(0, 0, 0, 0);
+	transform.angle = SPRITE_TURN / 4;
+	CHECK(cornersAre(&transform, 32, 16, turned));
+	transform = placement(100, 50, 16, 8);
+	transform.flags = SPRITE_FLIP_X | SPRITE_FLIP_Y;
+	CHECK(cornersAre(&transform, 32, 16, flipped));
+	transform = placement(100, 50, 16, 8);
+	transform.scaleX = transform.scaleY = FIXED(2);
+	CHECK(cornersAre(&transform, 32, 16, scaled));
+}
+
+/* The largest error of the corners against what any placement must keep, in pixels. */
+static float placementError(const SpriteTransform* transform, int width, int height)
+{
+	float corners[16];
+	float scaleX = transform->scaleX / (float) FIXED_ONE;
+	float scaleY = transform->scaleY / (float) FIXED_ONE;
+	float angle = transform->angle * (2.0f * (float) M_PI / SPRITE_TURN);
+	float ox = transform->originX / (float) FIXED_ONE / width;
+	float oy = transform->originY / (float) FIXED_ONE / height;
+	float topX, topY, leftX, leftY, error = 0;
+	int flipX = (transform->flags & SPRITE_FLIP_X) != 0;
+	int flipY = (transform->flags & SPRITE_FLIP_Y) != 0;
+	transformSprite(corners, transform, width, height);
+	topX = corners[4] - corners[0];
+	topY = corners[5] - corners[1];
+	leftX = corners[12] - corners[0];
+	leftY = corners[13] - corners[1];
+	// the origin stays at the position
+	error = fmaxf(error, fabsf(corners[0] + ox * topX + oy * leftX - transform->x / (float) FIXED_ONE));
+	error = fmaxf(error, fabsf(corners[1] + ox * topY + oy * leftY - transform->y / (float) FIXED_ONE));
+	// the top edge is the width scaled and turned by the angle, mirrored by a flip
+	error = fmaxf(error, fabsf(topX - (flipX ? -1 : 1) * width * scaleX * cosf(angle)));
+	error = fmaxf(error, fabsf(topY - (flipX ? -1 : 1) * width * scaleX * sinf(angle)));
+	// the left edge is the height turned a quarter further
+	error = fmaxf(error, fabsf(leftX + (flipY ? -1 : 1) * height * scaleY * sinf(angle)));
+	error = fmaxf(error, fabsf(leftY - (flipY ? -1 : 1) * height * scaleY * cosf(angle)));
+	// the fourth corner completes the parallelogram
+	error = fmaxf(error, fabsf(corners[8] - (corners[0] + topX + leftX)));
+	error = fmaxf(error, fabsf(corners[9] - (corners[1] + topY + leftY)));
+	return error;
+}
+
+/* Placements over angles, scales, flips and origins. */
+static void testSweep()
+{
+	float worst = 0;
+	int angle, scale, flags;
+	for (angle = -SPRITE_TURN; angle <= SPRITE_TURN; angle += SPRITE_TURN / 96) {
+		for (scale = 0; scale < 4; scale++) {
+			for (flags = 0; flags < 4; flags++) {
+				SpriteTransform transform = placement(240.5f, 136.25f, 20 + scale, 7.5f);
+				transform.angle = angle;
+				transform.scaleX = FIXED(0.25) + scale * FIXED(1.5);
+				transform.scaleY = FIXED(3) - scale * FIXED(0.5);
+				transform.flags = flags;
+				worst = fmaxf(worst, placementError(&transform, 40 + 8 * scale, 24));
+			}
+		}
+	}
+	CHECK(worst <= TOLERANCE);
+	printf("test_sprite: largest placement error %g pixels\n", worst);
+}
+
+int main()
+{
+	testPlacements();
+	testSweep();
+	return checkResult("test_sprite");
+}
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "graphics.h"
+#include "hostgu.h"
+#include "swizzle.h"
+#include "check.h"
+
+#define WIDTH_BYTES 64
+#define ROWS 24
+
+static void testOffset()
+{
+	// blocks of 16 bytes x 8 rows, each 128 contiguous bytes, left to right
+	CHECK_EQUAL(0, SWIZZLE_OFFSET(32, 0, 0));
+	CHECK_EQUAL(15, SWIZZLE_OFFSET(32, 15, 0));
+	CHECK_EQUAL(128, SWIZZLE_OFFSET(32, 16, 0));
+	CHECK_EQUAL(16, SWIZZLE_OFFSET(32, 0, 1));
+	CHECK_EQUAL(112 + 5, SWIZZLE_OFFSET(32, 5, 7));
+	CHECK_EQUAL(256, SWIZZLE_OFFSET(32, 0, 8));
+	CHECK_EQUAL(256 + 128 + 16 + 1, SWIZZLE_OFFSET(32, 17, 9));
+}
+
+static void testRoundTrip()
+{
+	static u8 linear[WIDTH_BYTES * ROWS];
+	static u8 swizzled[WIDTH_BYTES * ROWS];
+	int i, x, y, misplaced = 0;
+	for (i = 0; i < WIDTH_BYTES * ROWS; i++) linear[i] = rand();
+	memset(swizzled, 0, sizeof(swizzled));
+	for (y = 0; y < ROWS; y++) swizzleRow(swizzled, WIDTH_BYTES, y, linear + y * WIDTH_BYTES, WIDTH_BYTES);
+	for (y = 0; y < ROWS; y++) {
+		for (x = 0; x < WIDTH_BYTES; x++) {
+			if (swizzled[SWIZZLE_OFFSET(WIDTH_BYTES, x, y)] != linear[y * WIDTH_BYTES + x]) misplaced++;
+		}
+	}
+	CHECK_EQUAL(0, misplaced);
+	// the first block holds the first 16 bytes of rows 0 to 7
+	for (y = 0; y < 8; y++) CHECK(memcmp(swizzled + y * 16, linear + y * WIDTH_BYTES, 16) == 0);
+}
+
+static void testPartialRow()
+{
+	static u8 swizzled[WIDTH_BYTES * 8];
+	u8 row[WIDTH_BYTES];
+	int x;
+	memset(row, 0x11, sizeof(row));
+	memset(swizzled, 0xee, sizeof(swizzled));
+	swizzleRow(swizzled, WIDTH_BYTES, 3, row, 20);
+	for (x = 0; x < WIDTH_BYTES; x++) {
+		CHECK_EQUAL(x < 20 ? 0x11 : 0xee, swizzled[SWIZZLE_OFFSET(WIDTH_BYTES, x, 3)]);
+	}
+	CHECK_EQUAL(0xee, swizzled[SWIZZLE_OFFSET(WIDTH_BYTES, 0, 2)]);
+}
+
+/* Count pixels that differ, both images read through the CPU accessors. */
+static int countDifferences(Image* a, Image* b)
+{
+	int x, y, differences = 0;
+	for (y = 0; y < a->imageHeight; y++) {
+		for (x = 0; x < a->imageWidth; x++) {
+			if (getPixelImage(x, y, a) != getPixelImage(x, y, b)) differences++;
+		}
+	}
+	return differences;
+}
+
+static void testLoad(int format)
+{
+	Image* linear = loadImageEx("Background.png", format);
+	Image* swizzled = loadImageEx("Background.png", format | IMAGE_SWIZZLE);
+	CHECK(linear && swizzled);
+	if (!linear || !swizzled) return;
+	CHECK_EQUAL(0, linear->swizzled);
+	CHECK_EQUAL(1, swizzled->swizzled);
+	CHECK_EQUAL(0, countDifferences(linear, swizzled));
+	freeImage(linear);
+	freeImage(swizzled);
+}
+
+static void testDraw()
+{
+	// 37 rows round up to 40 swizzled rows
+	Image* linear = createImageEx(100, 37, 0);
+	Image* swizzled = createImageEx(100, 37, IMAGE_SWIZZLE);
+	CHECK(linear && swizzled && swizzled->swizzled);
+	if (!linear || !swizzled) return;
+	clearImage(0xff102030, linear);
+	clearImage(0xff102030, swizzled);
+	fillImageRect(0xff00ff00, 10, 5, 50, 30, linear);
+	fillImageRect(0xff00ff00, 10, 5, 50, 30, swizzled);
+	drawLineImage(0, 36, 99, 0, 0xffff0000, linear);
+	drawLineImage(0, 36, 99, 0, 0xffff0000, swizzled);
+	putPixelImage(0xff0000ff, 99, 36, linear);
+	putPixelImage(0xff0000ff, 99, 36, swizzled);
+	blitImageToImage(0, 0, 20, 20, linear, 70, 10, linear);
+	blitImageToImage(0, 0, 20, 20, swizzled, 70, 10, swizzled);
+	CHECK_EQUAL(0, countDifferences(linear, swizzled));
+	freeImage(linear);
+	freeImage(swizzled);
+}
+
+/* The bytes written back from the data cache when the image is next drawn. */
+static void checkWriteback(Image* image, int top, int rows)
+{
+	const void* data;
+	int size;
+	blitImageToScreen(0, 0, image->imageWidth, image->imageHeight, image, 0, 0);
+	hostGetLastWriteback(&data, &size);
+	CHECK_EQUAL(top * image->stride * 4, (const u8*) data - (const u8*) image->data);
+	CHECK_EQUAL(rows * image->stride * 4, size);
+}
+
+static void testDirtyWriteback()
+{
+	Image* linear = createImageEx(64, 37, 0);
+	Image* swizzled = createImageEx(64, 37, IMAGE_SWIZZLE);
+	CHECK(linear && swizzled && swizzled->swizzled);
+	if (!linear || !swizzled) return;
+	checkWriteback(linear, 0, 37);
+	checkWriteback(swizzled, 0, 40);
+	// a linear row is contiguous, a swizzled one needs the blocks of rows 8 to 15
+	putPixelImage(0xff0000ff, 5, 11, linear);
+	putPixelImage(0xff0000ff, 5, 11, swizzled);
+	checkWriteback(linear, 11, 1);
+	checkWriteback(swizzled, 8, 8);
+	// rows 15 and 16 fall into two bands
+	fillImageRect(0xff00ff00, 0, 15, 10, 2, swizzled);
+	checkWriteback(swizzled, 8, 16);
+	flipScreen();
+	freeImage(linear);
+	freeImage(swizzled);
+}
+
+int main()
+{
+	initGraphics();
+	testOffset();
+	testRoundTrip();
+	testPartialRow();
+	testLoad(IMAGE_FORMAT_8888);
+	testLoad(IMAGE_FORMAT_5650);
+	testLoad(IMAGE_FORMAT_4444);
+	testDraw();
+	testDirtyWriteback();
+	return checkResult("test_swizzle");
+}
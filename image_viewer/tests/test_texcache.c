@@ -0,0 +1,115 @@
+#include "texcache.h"
+#include "check.h"
+
+#define TEXTURE_SIZE 1024
+
+static int a, b, c, d;  // keys
+
+/* Draw a texture, the offset the GE reads it from. */
+static int use(TextureCache* cache, const void* key, int* upload)
+{
+	return textureCacheUse(cache, key, TEXTURE_SIZE, 0, upload);
+}
+
+static void testThreshold()
+{
+	TextureCache cache;
+	int upload, offset;
+	textureCacheInit(&cache, 4096, 4 * TEXTURE_SIZE);
+	// the first draw reads main RAM, the second one uploads
+	CHECK_EQUAL(-1, use(&cache, &a, &upload));
+	CHECK_EQUAL(0, upload);
+	offset = use(&cache, &a, &upload);
+	CHECK_EQUAL(4096, offset);
+	CHECK_EQUAL(1, upload);
+	CHECK_EQUAL(offset, use(&cache, &a, &upload));
+	CHECK_EQUAL(0, upload);
+	// changed texels are uploaded again to the same VRAM
+	CHECK_EQUAL(offset, textureCacheUse(&cache, &a, TEXTURE_SIZE, 1, &upload));
+	CHECK_EQUAL(1, upload);
+	CHECK_EQUAL(1, cache.stats.uploads);
+	CHECK_EQUAL(1, cache.stats.hits);
+	CHECK_EQUAL(3, cache.stats.misses);
+	CHECK_EQUAL(TEXTURE_SIZE, cache.stats.residentBytes);
+}
+
+static void testEvictionOrder()
+{
+	TextureCache cache;
+	int upload, offsetB;
+	textureCacheInit(&cache, 0, 3 * TEXTURE_SIZE);
+	use(&cache, &a, &upload);
+	use(&cache, &a, &upload);
+	use(&cache, &b, &upload);
+	offsetB = use(&cache, &b, &upload);
+	use(&cache, &c, &upload);
+	use(&cache, &c, &upload);
+	CHECK_EQUAL(3 * TEXTURE_SIZE, cache.stats.residentBytes);
+	textureCacheNextFrame(&cache);
+	// b is the least recently drawn now
+	use(&cache, &c, &upload);
+	use(&cache, &a, &upload);
+	use(&cache, &d, &upload);
+	CHECK_EQUAL(offsetB, use(&cache, &d, &upload));
+	CHECK_EQUAL(1, upload);
+	CHECK_EQUAL(1, cache.stats.evictions);
+	// every resident texture was drawn in this frame, b has to read main RAM
+	CHECK_EQUAL(-1, use(&cache, &b, &upload));
+	CHECK_EQUAL(0, upload);
+	CHECK_EQUAL(1, cache.stats.evictions);
+	textureCacheNextFrame(&cache);
+	// c is the least recently drawn of the resident textures
+	use(&cache, &a, &upload);
+	use(&cache, &d, &upload);
+	CHECK(use(&cache, &b, &upload) >= 0);
+	CHECK_EQUAL(1, upload);
+	CHECK_EQUAL(2, cache.stats.evictions);
+	CHECK_EQUAL(-1, cache.entries[2].offset);
+	CHECK(cache.entries[2].key == &c);
+	CHECK_EQUAL(3 * TEXTURE_SIZE, cache.stats.residentBytes);
+}
+
+static void testFullEntries()
+{
+	TextureCache cache;
+	static char keys[TEXTURE_CACHE_MAX_ENTRIES + 1];
+	int upload, i;
+	textureCacheInit(&cache, 0, 64 * TEXTURE_SIZE);
+	for (i = 0; i < TEXTURE_CACHE_MAX_ENTRIES; i++) use(&cache, &keys[i], &upload);
+	CHECK_EQUAL(TEXTURE_CACHE_MAX_ENTRIES, cache.entryCount);
+	// the least recently drawn entry makes room, resident or not
+	use(&cache, &keys[TEXTURE_CACHE_MAX_ENTRIES], &upload);
+	CHECK_EQUAL(TEXTURE_CACHE_MAX_ENTRIES, cache.entryCount);
+	for (i = 0; i < cache.entryCount; i++) CHECK(cache.entries[i].key != &keys[0]);
+}
+
+static void testRemoveAndResize()
+{
+	TextureCache cache;
+	int upload;
+	textureCacheInit(&cache, 0, 2 * TEXTURE_SIZE);
+	use(&cache, &a, &upload);
+	use(&cache, &a, &upload);
+	use(&cache, &b, &upload);
+	use(&cache, &b, &upload);
+	textureCacheRemove(&cache, &a);
+	CHECK_EQUAL(1, cache.entryCount);
+	CHECK_EQUAL(TEXTURE_SIZE, cache.stats.residentBytes);
+	CHECK_EQUAL(TEXTURE_SIZE, vramFreeBytes(&cache.allocator));
+	textureCacheRemove(&cache, &c);
+	CHECK_EQUAL(1, cache.entryCount);
+	// a resize drops the VRAM but keeps the use counts, the next draw uploads again
+	textureCacheResize(&cache, 8192, 2 * TEXTURE_SIZE);
+	CHECK_EQUAL(0, cache.stats.residentBytes);
+	CHECK_EQUAL(8192, use(&cache, &b, &upload));
+	CHECK_EQUAL(1, upload);
+}
+
+int main()
+{
+	testThreshold();
+	testEvictionOrder();
+	testFullEntries();
+	testRemoveAndResize();
+	return checkResult("test_texcache");
+}
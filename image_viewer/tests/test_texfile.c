@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pspgu.h>
+
+#include "graphics.h"
+#include "pixelformat.h"
+#include "texfile.h"
+#include "check.h"
+
+#define WORK_DIR "host/build/tests/"  // the tests run from the image_viewer directory
+
+/* Whether a cooked texture holds exactly the bytes of the image loaded from the PNG. */
+static int sameImage(Image* a, Image* b)
+{
+	int bits = pixelFormatBits(a->format);
+	int rows = a->swizzled ? (a->imageHeight + 7) & ~7 : a->imageHeight;
+	if (a->imageWidth != b->imageWidth || a->imageHeight != b->imageHeight ||
+		a->textureWidth != b->textureWidth || a->textureHeight != b->textureHeight ||
+		a->stride != b->stride || a->format != b->format || a->swizzled != b->swizzled ||
+		a->paletteEntries != b->paletteEntries) {
+		return 0;
+	}
+	if (a->palette && memcmp(a->palette, b->palette, a->paletteEntries * sizeof(Color)) != 0) return 0;
+	return memcmp(a->data, b->data, a->stride * rows * bits / 8) == 0;
+}
+
+/* Cook a PNG with the texcook tool and compare the texture with loadImageEx(). */
+static void testCook(const char* png, const char* options, int flags, int format)
+{
+	char command[256];
+	Image* image = loadImageEx(png, flags);
+	Image* cooked;
+	snprintf(command, sizeof(command), "./texcook %s %s " WORK_DIR "cooked.tex > /dev/null", options, png);
+	CHECK_EQUAL(0, system(command));
+	cooked = loadTextureFile(WORK_DIR "cooked.tex");
+	CHECK(image && cooked);
+	if (!image || !cooked) return;
+	CHECK_EQUAL(format, cooked->format);
+	CHECK_EQUAL((flags & IMAGE_SWIZZLE) != 0, cooked->swizzled);
+	if (!sameImage(image, cooked)) printf("texcook %s %s differs from loadImageEx()\n", options, png);
+	CHECK(sameImage(image, cooked));
+	freeImage(image);
+	freeImage(cooked);
+}
+
+/* Write an indexed PNG of colors palette entries. */
+static void writeIndexedPng(const char* filename, int format, int colors)
+{
+	Image* image = createImageEx(100, 37, format);
+	int i;
+	for (i = 0; i < image->paletteEntries; i++) image->palette[i] = i < colors ? 0x80000000 | i * 0x010307 : 0;
+	for (i = 0; i < 37; i++) fillImageRect(image->palette[i % colors], i, i, 100 - 2 * i, 1, image);
+	saveImageFile(filename, image, 1);
+	freeImage(image);
+}
+
+static void testCorruptFiles()
+{
+	TexFileHeader header;
+	FILE* file;
+	memset(&header, 0, sizeof(header));
+	header.magic = TEXFILE_MAGIC;
+	header.version = TEXFILE_VERSION;
+	header.imageWidth = 16;
+	header.imageHeight = 16;
+	header.stride = 16;
+	header.rows = 16;
+	header.format = GU_PSM_8888;
+	header.dataOffset = sizeof(header);
+	header.dataSize = 16 * 16 * 4;
+	// the texels are missing
+	file = fopen(WORK_DIR "truncated.tex", "wb");
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	CHECK(loadTextureFile(WORK_DIR "truncated.tex") == NULL);
+	// a layout this build would not give the image
+	header.stride = 32;
+	file = fopen(WORK_DIR "layout.tex", "wb");
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	CHECK(loadTextureFile(WORK_DIR "layout.tex") == NULL);
+	CHECK(loadTextureFile("Background.png") == NULL);
+	CHECK(loadTextureFile(WORK_DIR "missing.tex") == NULL);
+}
+
+int main()
+{
+	initGraphics();
+	testCook("Background.png", "", 0, GU_PSM_8888);
+	testCook("Background.png", "-s", IMAGE_SWIZZLE, GU_PSM_8888);
+	testCook("Background.png", "-f 5650", IMAGE_FORMAT_5650, GU_PSM_5650);
+	testCook("Background.png", "-f 5551 -s", IMAGE_FORMAT_5551 | IMAGE_SWIZZLE, GU_PSM_5551);
+	testCook("Background.png", "-f 4444 -d", IMAGE_FORMAT_4444 | IMAGE_DITHER, GU_PSM_4444);
+	writeIndexedPng(WORK_DIR "t4.png", IMAGE_FORMAT_T4, 16);
+	writeIndexedPng(WORK_DIR "t8.png", IMAGE_FORMAT_T8, 200);
+	testCook(WORK_DIR "t4.png", "", 0, GU_PSM_T4);
+	testCook(WORK_DIR "t4.png", "-s", IMAGE_SWIZZLE, GU_PSM_T4);
+	testCook(WORK_DIR "t8.png", "-s", IMAGE_SWIZZLE, GU_PSM_T8);
+	testCook(WORK_DIR "t8.png", "-e", IMAGE_EXPAND_PALETTE, GU_PSM_8888);
+	testCorruptFiles();
+	return checkResult("test_texfile");
+}
@@ -0,0 +1,90 @@
+#include "vram.h"
+#include "check.h"
+
+static void testAlloc()
+{
+	VramAllocator allocator;
+	vramInit(&allocator, 1024, 4096);
+	CHECK_EQUAL(4096, vramFreeBytes(&allocator));
+	// sizes are rounded up to VRAM_ALIGNMENT, blocks follow each other
+	CHECK_EQUAL(1024, vramAlloc(&allocator, 100));
+	CHECK_EQUAL(1024 + 112, vramAlloc(&allocator, 200));
+	CHECK_EQUAL(1024 + 112 + 208, vramAlloc(&allocator, 16));
+	CHECK_EQUAL(4096 - 112 - 208 - 16, vramFreeBytes(&allocator));
+	CHECK_EQUAL(4096 - 112 - 208 - 16, vramLargestFree(&allocator));
+	CHECK_EQUAL(-1, vramAlloc(&allocator, 4096));
+	// the last free byte range can be taken whole
+	CHECK_EQUAL(1024 + 336, vramAlloc(&allocator, 4096 - 336));
+	CHECK_EQUAL(0, vramFreeBytes(&allocator));
+	CHECK_EQUAL(-1, vramAlloc(&allocator, 16));
+}
+
+static void testFirstFit()
+{
+	VramAllocator allocator;
+	int a, b, c;
+	vramInit(&allocator, 0, 4096);
+	a = vramAlloc(&allocator, 256);
+	b = vramAlloc(&allocator, 256);
+	c = vramAlloc(&allocator, 256);
+	vramFree(&allocator, b);
+	// the hole left by b is the first fit, larger requests go behind c
+	CHECK_EQUAL(b, vramAlloc(&allocator, 128));
+	CHECK_EQUAL(c + 256, vramAlloc(&allocator, 512));
+	CHECK_EQUAL(b + 128, vramAlloc(&allocator, 128));
+	CHECK_EQUAL(0, a);
+}
+
+static void testCoalesce()
+{
+	VramAllocator allocator;
+	int a, b, c, d;
+	vramInit(&allocator, 0, 4096);
+	a = vramAlloc(&allocator, 1024);
+	b = vramAlloc(&allocator, 1024);
+	c = vramAlloc(&allocator, 1024);
+	d = vramAlloc(&allocator, 1024);
+	CHECK_EQUAL(4, allocator.blockCount);
+	vramFree(&allocator, a);
+	vramFree(&allocator, c);
+	CHECK_EQUAL(2048, vramFreeBytes(&allocator));
+	CHECK_EQUAL(1024, vramLargestFree(&allocator));
+	// b merges with both free neighbours
+	vramFree(&allocator, b);
+	CHECK_EQUAL(2, allocator.blockCount);
+	CHECK_EQUAL(3072, vramLargestFree(&allocator));
+	CHECK_EQUAL(0, vramAlloc(&allocator, 3072));
+	vramFree(&allocator, 0);
+	// a freed block merges with the free block behind it
+	vramFree(&allocator, d);
+	CHECK_EQUAL(1, allocator.blockCount);
+	CHECK_EQUAL(4096, vramLargestFree(&allocator));
+	// freeing twice or an unknown offset changes nothing
+	vramFree(&allocator, d);
+	vramFree(&allocator, 123);
+	CHECK_EQUAL(1, allocator.blockCount);
+	CHECK_EQUAL(4096, vramFreeBytes(&allocator));
+}
+
+static void testBlockLimit()
+{
+	VramAllocator allocator;
+	int i;
+	vramInit(&allocator, 0, VRAM_MAX_BLOCKS * 32);
+	for (i = 0; i < VRAM_MAX_BLOCKS - 1; i++) CHECK_EQUAL(i * 16, vramAlloc(&allocator, 16));
+	CHECK_EQUAL(VRAM_MAX_BLOCKS, allocator.blockCount);
+	// no block is left to split the free rest, only an exact fit succeeds
+	CHECK_EQUAL(-1, vramAlloc(&allocator, 16));
+	CHECK_EQUAL((VRAM_MAX_BLOCKS - 1) * 16, vramAlloc(&allocator, VRAM_MAX_BLOCKS * 32 - (VRAM_MAX_BLOCKS - 1) * 16));
+	vramFree(&allocator, 16);
+	CHECK_EQUAL(16, vramAlloc(&allocator, 16));
+}
+
+int main()
+{
+	testAlloc();
+	testFirstFit();
+	testCoalesce();
+	testBlockLimit();
+	return checkResult("test_vram");
+}
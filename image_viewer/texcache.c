@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "texcache.h"
+
+void textureCacheInit(TextureCache* cache, int start, int size)
+{
+	vramInit(&cache->allocator, start, size);
+	cache->entryCount = 0;
+	cache->clock = 0;
+	cache->frame = 0;
+	memset(&cache->stats, 0, sizeof(cache->stats));
+}
+
+static void release(TextureCache* cache, TextureCacheEntry* entry)
+{
+	if (entry->offset < 0) return;
+	vramFree(&cache->allocator, entry->offset);
+	cache->stats.residentBytes -= entry->size;
+	entry->offset = -1;
+}
+
+static void removeEntry(TextureCache* cache, int i)
+{
+	release(cache, &cache->entries[i]);
+	cache->entries[i] = cache->entries[--cache->entryCount];
+}
+
+/*
+ * Least recently drawn entry other than keep. Evicting VRAM only considers resident
+ * textures not drawn in the current frame, anything else would just thrash.
+ */
+static int findVictim(TextureCache* cache, const TextureCacheEntry* keep, int resident)
+{
+	int i;
+	int victim = -1;
+	for (i = 0; i < cache->entryCount; i++) {
+		TextureCacheEntry* entry = &cache->entries[i];
+		if (entry == keep) continue;
+		if (resident && (entry->offset < 0 || entry->lastFrame == cache->frame)) continue;
+		if (victim < 0 || entry->lastUsed < cache->entries[victim].lastUsed) victim = i;
+	}
+	return victim;
+}
+
+static TextureCacheEntry* findEntry(TextureCache* cache, const void* key)
+{
+	int i;
+	for (i = 0; i < cache->entryCount; i++) {
+		if (cache->entries[i].key == key) return &cache->entries[i];
+	}
+	return NULL;
+}
+
+int textureCacheUse(TextureCache* cache, const void* key, int size, int changed, int* upload)
+{
+	TextureCacheEntry* entry = findEntry(cache, key);
+	*upload = 0;
+
+	if (!entry) {
+		if (cache->entryCount == TEXTURE_CACHE_MAX_ENTRIES) {
+			int victim = findVictim(cache, NULL, 0);
+			if (cache->entries[victim].offset >= 0) cache->stats.evictions++;
+			removeEntry(cache, victim);
+		}
+		entry = &cache->entries[cache->entryCount++];
+		entry->key = key;
+		entry->offset = -1;
+		entry->size = size;
+		entry->uses = 0;
+	}
+	entry->uses++;
+	entry->lastUsed = ++cache->clock;
+	entry->lastFrame = cache->frame;
+
+	if (entry->offset >= 0) {
+		if (changed) {
+			cache->stats.misses++;
+			*upload = 1;
+		} else {
+			cache->stats.hits++;
+		}
+		return entry->offset;
+	}
+
+	cache->stats.misses++;
+	if (entry->uses < TEXTURE_CACHE_UPLOAD_THRESHOLD) return -1;
+	while ((entry->offset = vramAlloc(&cache->allocator, size)) < 0) {
+		int victim = findVictim(cache, entry, 1);
+		if (victim < 0) return -1;
+		release(cache, &cache->entries[victim]);
+		cache->stats.evictions++;
+	}
+	cache->stats.residentBytes += size;
+	cache->stats.uploads++;
+	*upload = 1;
+	return entry->offset;
+}
+
+void textureCacheNextFrame(TextureCache* cache)
+{
+	cache->frame++;
+}
+
+void textureCacheResize(TextureCache* cache, int start, int size)
+{
+	int i;
+	for (i = 0; i < cache->entryCount; i++) release(cache, &cache->entries[i]);
+	vramInit(&cache->allocator, start, size);
+}
+
+void textureCacheRemove(TextureCache* cache, const void* key)
+{
+	TextureCacheEntry* entry = findEntry(cache, key);
+	if (entry) removeEntry(cache, entry - cache->entries);
+}
@@ -0,0 +1,98 @@
+#ifndef TEXCACHE_H
+#define TEXCACHE_H
+
+#include "vram.h"
+
+#define TEXTURE_CACHE_MAX_ENTRIES 64
+#define TEXTURE_CACHE_UPLOAD_THRESHOLD 2  // draws before a texture is worth copying to VRAM
+
+typedef struct
+{
+	int hits;  // draws served from VRAM without an upload
+	int misses;  // draws that had to read main RAM or upload first
+	int uploads;  // textures copied to VRAM
+	int evictions;  // resident textures dropped to make room
+	int residentBytes;  // VRAM currently held by textures
+} TextureCacheStats;
+
+typedef struct
+{
+	const void* key;  // identity of the texture, usually its Image
+	int offset;  // VRAM offset, -1 if the texture is not resident
+	int size;  // bytes the texture needs in VRAM
+	int uses;  // draws since the texture was first seen
+	unsigned int lastUsed;  // value of the cache clock at the last draw
+	unsigned int lastFrame;  // frame of the last draw
+} TextureCacheEntry;
+
+/**
+ * LRU cache deciding which textures live in VRAM. Only bookkeeping is done here,
+ * copying the texels is left to the caller, so the eviction logic runs unchanged on the host.
+ */
+typedef struct
+{
+	VramAllocator allocator;
+	TextureCacheEntry entries[TEXTURE_CACHE_MAX_ENTRIES];
+	int entryCount;
+	unsigned int clock;
+	unsigned int frame;
+	TextureCacheStats stats;
+} TextureCache;
+
+/**
+ * Initialize a texture cache over the VRAM bytes [start, start + size).
+ *
+ * @pre cache != NULL && start >= 0 && size > 0
+ * @param cache - the cache to initialize
+ * @param start - first VRAM offset available for textures
+ * @param size - number of VRAM bytes available for textures
+ */
+extern void textureCacheInit(TextureCache* cache, int start, int size);
+
+/**
+ * Record a draw of a texture and find where the GE should read it from.
+ *
+ * Textures drawn at least TEXTURE_CACHE_UPLOAD_THRESHOLD times are given VRAM,
+ * evicting the least recently drawn resident textures not drawn in the current frame.
+ *
+ * @pre cache != NULL && key != NULL && size > 0 && upload != NULL
+ * @param cache - the cache
+ * @param key - identity of the texture
+ * @param size - bytes the texture needs in VRAM
+ * @param changed - nonzero if the texels changed since the last call for this key
+ * @param upload - set to 1 if the caller must copy the texels to the returned offset, 0 otherwise
+ * @return VRAM offset of the texture, or -1 if it should be read from main RAM
+ */
+extern int textureCacheUse(TextureCache* cache, const void* key, int size, int changed, int* upload);
+
+/**
+ * Start a new frame, textures drawn before it become candidates for eviction.
+ *
+ * @pre cache != NULL
+ * @param cache - the cache
+ */
+extern void textureCacheNextFrame(TextureCache* cache);
+
+/**
+ * Forget a texture, releasing its VRAM.
+ *
+ * @pre cache != NULL
+ * @param cache - the cache
+ * @param key - identity of the texture, unknown keys are ignored
+ */
+extern void textureCacheRemove(TextureCache* cache, const void* key);
+
+/**
+ * Move the cache to other VRAM bytes, e.g. when a frame buffer takes part of it.
+ *
+ * All textures lose their VRAM and are uploaded again on their next draw, their use
+ * counts and the statistics are kept. The GE must not read any cached texture anymore.
+ *
+ * @pre cache != NULL && start >= 0 && size > 0
+ * @param cache - the cache
+ * @param start - first VRAM offset available for textures
+ * @param size - number of VRAM bytes available for textures
+ */
+extern void textureCacheResize(TextureCache* cache, int start, int size);
+
+#endif
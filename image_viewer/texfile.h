@@ -0,0 +1,35 @@
+#ifndef TEXFILE_H
+#define TEXFILE_H
+
+#include <psptypes.h>
+
+#define TEXFILE_MAGIC 0x58545547  // "GUTX"
+#define TEXFILE_VERSION 1
+#define TEXFILE_ALIGNMENT 64  // file offset alignment of the palette and the texels
+
+/**
+ * Header of a cooked texture, written by saveTextureFile() and the texcook tool.
+ *
+ * The header is followed by the palette of indexed formats and the texels, each at a
+ * TEXFILE_ALIGNMENT aligned offset and stored exactly as an Image keeps them in memory:
+ * converted to the format, rows padded to the stride and, if swizzled, to whole blocks.
+ * All fields are little endian, like both the PSP and the hosts the tool runs on.
+ */
+typedef struct
+{
+	u32 magic;  // TEXFILE_MAGIC
+	u32 version;  // TEXFILE_VERSION
+	u32 imageWidth;
+	u32 imageHeight;
+	u32 stride;  // pixels per row of the texels
+	u32 rows;  // rows of the texels, imageHeight rounded up to 8 if swizzled
+	u32 format;  // GU_PSM_8888, GU_PSM_5650, GU_PSM_5551, GU_PSM_4444, GU_PSM_T4 or GU_PSM_T8
+	u32 swizzled;  // 1 if the texels are in the GE's block layout
+	u32 paletteEntries;  // 16 for GU_PSM_T4, 256 for GU_PSM_T8, 0 otherwise
+	u32 paletteOffset;  // file offset of the 8888 palette, 0 without palette
+	u32 dataOffset;  // file offset of the texels
+	u32 dataSize;  // bytes of texels, stride * rows pixels
+	u32 reserved[4];  // 0, pads the header to TEXFILE_ALIGNMENT bytes
+} TexFileHeader;
+
+#endif
@@ -0,0 +1,90 @@
+#include <string.h>
+
+#include "text.h"
+
+void layoutText(TextVertex* vertices, const char* text, int length, int x, int y, u32 color)
+{
+	int i;
+	for (i = 0; i < length; i++, vertices += 2, x += GLYPH_SIZE) {
+		int glyph = (u8) text[i];
+		int u = (glyph % GLYPH_ATLAS_COLUMNS) * GLYPH_SIZE;
+		int v = (glyph / GLYPH_ATLAS_COLUMNS) * GLYPH_SIZE;
+		vertices[0].u = u;
+		vertices[0].v = v;
+		vertices[0].color = color;
+		vertices[0].x = x;
+		vertices[0].y = y;
+		vertices[0].z = 0;
+		vertices[1].u = u + GLYPH_SIZE;
+		vertices[1].v = v + GLYPH_SIZE;
+		vertices[1].color = color;
+		vertices[1].x = x + GLYPH_SIZE;
+		vertices[1].y = y + GLYPH_SIZE;
+		vertices[1].z = 0;
+	}
+}
+
+void textCacheInit(TextCache* cache)
+{
+	memset(cache, 0, sizeof(TextCache));
+}
+
+void textCacheNextFrame(TextCache* cache)
+{
+	cache->frame++;
+}
+
+/* FNV-1a over the characters and where and how they are drawn. */
+static u32 hashText(const char* text, int length, int x, int y, u32 color)
+{
+	u32 hash = 2166136261u;
+	int i;
+	for (i = 0; i < length; i++) hash = (hash ^ (u8) text[i]) * 16777619u;
+	hash = (hash ^ (u32) x) * 16777619u;
+	hash = (hash ^ (u32) y) * 16777619u;
+	return (hash ^ color) * 16777619u;
+}
+
+const TextVertex* textCacheLayout(TextCache* cache, const char* text, int length, int x, int y, u32 color)
+{
+	int i;
+	u32 hash;
+	TextCacheEntry* entry;
+	TextCacheEntry* oldest;
+
+	if (length > TEXT_CACHE_MAX_LENGTH) {
+		cache->stats.uncached++;
+		return NULL;
+	}
+	hash = hashText(text, length, x, y, color);
+	cache->clock++;
+	oldest = &cache->entries[0];
+	for (i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+		entry = &cache->entries[i];
+		if (entry->length == length && entry->hash == hash && entry->x == x && entry->y == y &&
+			entry->color == color && memcmp(entry->text, text, length) == 0) {
+			entry->lastUsed = cache->clock;
+			entry->lastFrame = cache->frame;
+			cache->stats.hits++;
+			return entry->vertices;
+		}
+		if (entry->lastUsed < oldest->lastUsed) oldest = entry;
+	}
+
+	if (oldest->length && oldest->lastFrame == cache->frame) {
+		cache->stats.uncached++;
+		return NULL;
+	}
+	entry = oldest;
+	entry->hash = hash;
+	entry->length = length;
+	entry->x = x;
+	entry->y = y;
+	entry->color = color;
+	entry->lastUsed = cache->clock;
+	entry->lastFrame = cache->frame;
+	memcpy(entry->text, text, length);
+	layoutText(entry->vertices, text, length, x, y, color);
+	cache->stats.misses++;
+	return entry->vertices;
+}
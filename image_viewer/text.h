@@ -0,0 +1,91 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <psptypes.h>
+
+#define GLYPH_SIZE 8  // the msx font has 8x8 pixel glyphs
+#define GLYPH_ATLAS_COLUMNS 16  // glyphs per atlas row, 256 glyphs make a 128x128 atlas
+#define TEXT_CACHE_ENTRIES 32
+#define TEXT_CACHE_MAX_LENGTH 48  // longer strings are laid out every time
+
+/** Vertex of a glyph sprite, textured from the atlas and tinted by its color. */
+typedef struct
+{
+	unsigned short u, v;
+	u32 color;
+	short x, y, z;
+} TextVertex;
+
+typedef struct
+{
+	int hits;  // strings submitted from the cache
+	int misses;  // strings laid out
+	int uncached;  // strings laid out without being remembered, too long or the cache full of this frame's strings
+} TextCacheStats;
+
+typedef struct
+{
+	u32 hash;
+	int length;  // 0 if the entry is unused
+	int x, y;
+	u32 color;
+	unsigned int lastUsed;
+	unsigned int lastFrame;
+	char text[TEXT_CACHE_MAX_LENGTH];
+	TextVertex vertices[TEXT_CACHE_MAX_LENGTH * 2];
+} TextCacheEntry;
+
+/**
+ * Laid-out strings, so HUD text drawn at the same place every frame is copied into
+ * the display list as it is. The least recently drawn string is replaced first, strings
+ * of the current frame are never replaced so a HUD larger than the cache does not thrash.
+ */
+typedef struct
+{
+	TextCacheEntry entries[TEXT_CACHE_ENTRIES];
+	unsigned int clock;
+	unsigned int frame;
+	TextCacheStats stats;
+} TextCache;
+
+/**
+ * Lay out a string as one sprite per character, two vertices each.
+ *
+ * @pre vertices has room for length * 2 vertices
+ * @param vertices - destination
+ * @param text - characters, any byte value is a glyph
+ * @param length - number of characters
+ * @param x - left position of the first character
+ * @param y - top position of the characters
+ * @param color - 8888 color the glyphs are tinted with
+ */
+extern void layoutText(TextVertex* vertices, const char* text, int length, int x, int y, u32 color);
+
+/**
+ * Empty a text cache.
+ *
+ * @param cache - the cache
+ */
+extern void textCacheInit(TextCache* cache);
+
+/**
+ * Start a new frame, strings of earlier frames may be replaced again.
+ *
+ * @param cache - the cache
+ */
+extern void textCacheNextFrame(TextCache* cache);
+
+/**
+ * Find the vertices of a string laid out earlier, or lay it out and remember it.
+ *
+ * @param cache - the cache
+ * @param text - characters
+ * @param length - number of characters, larger than TEXT_CACHE_MAX_LENGTH is not cached
+ * @param x - left position of the first character
+ * @param y - top position of the characters
+ * @param color - 8888 color the glyphs are tinted with
+ * @return length * 2 vertices, or NULL if the string could not be cached
+ */
+extern const TextVertex* textCacheLayout(TextCache* cache, const char* text, int length, int x, int y, u32 color);
+
+#endif
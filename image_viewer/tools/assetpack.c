@@ -0,0 +1,276 @@
+/*
+ * assetpack: pack the files of a directory tree into one asset pack for openPack().
+ *
+ *   assetpack [-a alignment] [-n] directory output.pak
+ *
+ *   -a  file offset alignment of every entry, a power of two, 64 by default so cooked
+ *       textures keep the alignment they have in their own files
+ *   -n  store every file as is, by default files are deflated if that saves an eighth
+ *
+ * Entries are named by their path below the directory, with '/' separators, e.g.
+ * "sprites/player.png". The pack is read back through openPack() and every entry is
+ * compared with its file.
+ *
+ * Built by Makefile.host.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "../pack.h"
+
+#define MAX_FILES 4096
+#define MAX_PATH 1024
+
+typedef struct
+{
+	char* name;
+	u8* data;  // the bytes as stored in the pack
+	PackEntry entry;
+} File;
+
+static File files[MAX_FILES];
+static int fileCount;
+
+static int usage()
+{
+	fprintf(stderr, "usage: assetpack [-a alignment] [-n] directory output.pak\n");
+	return 2;
+}
+
+static u8* readFile(const char* path, int* size)
+{
+	FILE* fp = fopen(path, "rb");
+	u8* data;
+	long length;
+	if (!fp) return NULL;
+	fseek(fp, 0, SEEK_END);
+	length = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	data = (u8*) malloc(length + 1);
+	if (data && fread(data, 1, length, fp) != (size_t) length) {
+		free(data);
+		data = NULL;
+	}
+	fclose(fp);
+	*size = length;
+	return data;
+}
+
+/* Deflate the file if that saves at least an eighth, PNGs are deflated already and rarely do. */
+static void compressFile(File* file)
+{
+	uLongf size = compressBound(file->entry.size);
+	u8* compressed = (u8*) malloc(size);
+	if (compressed && compress2(compressed, &size, file->data, file->entry.size, Z_BEST_COMPRESSION) == Z_OK &&
+		size <= file->entry.size - file->entry.size / 8) {
+		free(file->data);
+		file->data = compressed;
+		file->entry.storedSize = size;
+		file->entry.compression = PACK_COMPRESSION_DEFLATE;
+	} else {
+		free(compressed);
+	}
+}
+
+/* Add the regular files below directory, named by their path below the root. */
+static int addFiles(const char* directory, const char* prefix, int compress)
+{
+	DIR* dir = opendir(directory);
+	struct dirent* item;
+	char path[MAX_PATH], name[MAX_PATH];
+	if (!dir) {
+		fprintf(stderr, "assetpack: cannot open %s\n", directory);
+		return 0;
+	}
+	while ((item = readdir(dir)) != NULL) {
+		struct stat status;
+		File* file;
+		int size;
+		if (item->d_name[0] == '.') continue;
+		snprintf(path, sizeof(path), "%s/%s", directory, item->d_name);
+		snprintf(name, sizeof(name), "%s%s", prefix, item->d_name);
+		if (stat(path, &status) != 0) continue;
+		if (S_ISDIR(status.st_mode)) {
+			strcat(name, "/");
+			if (!addFiles(path, name, compress)) {
+				closedir(dir);
+				return 0;
+			}
+			continue;
+		}
+		if (!S_ISREG(status.st_mode)) continue;
+		if (fileCount == MAX_FILES) {
+			fprintf(stderr, "assetpack: more than %d files\n", MAX_FILES);
+			closedir(dir);
+			return 0;
+		}
+		file = &files[fileCount];
+		file->data = readFile(path, &size);
+		if (!file->data) {
+			fprintf(stderr, "assetpack: cannot read %s\n", path);
+			closedir(dir);
+			return 0;
+		}
+		file->name = strdup(name);
+		memset(&file->entry, 0, sizeof(PackEntry));
+		file->entry.hash = hashPackName(name);
+		file->entry.size = size;
+		file->entry.storedSize = size;
+		file->entry.compression = PACK_COMPRESSION_NONE;
+		if (compress) compressFile(file);
+		fileCount++;
+	}
+	closedir(dir);
+	return 1;
+}
+
+static int bucketCount;
+
+/* Directory order: by bucket, then by hash and name, so lookups are repeatable. */
+static int byBucket(const void* a, const void* b)
+{
+	const File* p = (const File*) a;
+	const File* q = (const File*) b;
+	u32 bucketP = p->entry.hash & (bucketCount - 1);
+	u32 bucketQ = q->entry.hash & (bucketCount - 1);
+	if (bucketP != bucketQ) return bucketP < bucketQ ? -1 : 1;
+	if (p->entry.hash != q->entry.hash) return p->entry.hash < q->entry.hash ? -1 : 1;
+	return strcmp(p->name, q->name);
+}
+
+static u32 alignUp(u32 offset, int alignment)
+{
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static int writePack(const char* output, int alignment)
+{
+	PackHeader header;
+	u32* buckets = (u32*) calloc(bucketCount + 1, sizeof(u32));
+	u32 namesSize = 0, offset;
+	int i, bucket;
+	FILE* fp;
+	if (!buckets) return 0;
+
+	// buckets[b] is the first entry of bucket b, the entries being sorted by bucket
+	for (i = 0; i < fileCount; i++) buckets[(files[i].entry.hash & (bucketCount - 1)) + 1]++;
+	for (bucket = 0; bucket < bucketCount; bucket++) buckets[bucket + 1] += buckets[bucket];
+	for (i = 0; i < fileCount; i++) {
+		files[i].entry.name = namesSize;
+		namesSize += strlen(files[i].name) + 1;
+	}
+	memset(&header, 0, sizeof(header));
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	header.entryCount = fileCount;
+	header.bucketCount = bucketCount;
+	header.indexSize = fileCount * sizeof(PackEntry) + (bucketCount + 1) * sizeof(u32) + namesSize;
+	offset = sizeof(header) + header.indexSize;
+	for (i = 0; i < fileCount; i++) {
+		offset = alignUp(offset, alignment);
+		files[i].entry.offset = offset;
+		files[i].entry.alignment = alignment;
+		offset += files[i].entry.storedSize;
+	}
+
+	if ((fp = fopen(output, "wb")) == NULL) {
+		free(buckets);
+		return 0;
+	}
+	fwrite(&header, sizeof(header), 1, fp);
+	for (i = 0; i < fileCount; i++) fwrite(&files[i].entry, sizeof(PackEntry), 1, fp);
+	fwrite(buckets, sizeof(u32), bucketCount + 1, fp);
+	for (i = 0; i < fileCount; i++) fwrite(files[i].name, strlen(files[i].name) + 1, 1, fp);
+	for (i = 0; i < fileCount; i++) {
+		while (ftell(fp) < (long) files[i].entry.offset) fputc(0, fp);
+		fwrite(files[i].data, files[i].entry.storedSize, 1, fp);
+	}
+	free(buckets);
+	return fclose(fp) == 0;
+}
+
+/* Read every entry back by name, the way the game will, and compare it with the file. */
+static int verify(const char* output, const char* directory)
+{
+	Pack* pack = openPack(output);
+	char path[MAX_PATH];
+	int i;
+	if (!pack) {
+		fprintf(stderr, "assetpack: %s does not load\n", output);
+		return 0;
+	}
+	for (i = 0; i < fileCount; i++) {
+		int size, expectedSize;
+		u8* data = (u8*) loadPackEntry(pack, files[i].name, &size);
+		u8* expected;
+		snprintf(path, sizeof(path), "%s/%s", directory, files[i].name);
+		expected = readFile(path, &expectedSize);
+		if (!data || !expected || size != expectedSize || memcmp(data, expected, size) != 0) {
+			fprintf(stderr, "assetpack: %s differs in %s\n", files[i].name, output);
+			free(data);
+			free(expected);
+			closePack(pack);
+			return 0;
+		}
+		free(data);
+		free(expected);
+	}
+	closePack(pack);
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	int alignment = 64;
+	int compress = 1;
+	const char* directory = NULL;
+	const char* output = NULL;
+	long size = 0, stored = 0;
+	int compressed = 0, largestBucket = 0, i, run;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			alignment = atoi(argv[++i]);
+			if (alignment <= 0 || alignment > 0x8000 || (alignment & (alignment - 1)) != 0) return usage();
+		} else if (strcmp(argv[i], "-n") == 0) {
+			compress = 0;
+		} else if (argv[i][0] == '-') {
+			return usage();
+		} else if (!directory) {
+			directory = argv[i];
+		} else if (!output) {
+			output = argv[i];
+		} else {
+			return usage();
+		}
+	}
+	if (!directory || !output) return usage();
+	if (!addFiles(directory, "", compress)) return 1;
+	if (fileCount == 0) {
+		fprintf(stderr, "assetpack: no files in %s\n", directory);
+		return 1;
+	}
+
+	for (bucketCount = 1; bucketCount < fileCount; bucketCount *= 2);
+	qsort(files, fileCount, sizeof(File), byBucket);
+	if (!writePack(output, alignment) || !verify(output, directory)) {
+		fprintf(stderr, "assetpack: cannot write %s\n", output);
+		return 1;
+	}
+
+	for (i = 0, run = 0; i < fileCount; i++) {
+		size += files[i].entry.size;
+		stored += files[i].entry.storedSize;
+		if (files[i].entry.compression != PACK_COMPRESSION_NONE) compressed++;
+		// entries of a bucket are adjacent, count the longest run
+		run = i > 0 && ((files[i].entry.hash ^ files[i - 1].entry.hash) & (bucketCount - 1)) == 0 ? run + 1 : 1;
+		if (run > largestBucket) largestBucket = run;
+	}
+	printf("%s: %d files in %d buckets, at most %d per bucket\n", output, fileCount, bucketCount, largestBucket);
+	printf("%ld bytes stored as %ld, %d files deflated\n", size, stored, compressed);
+	return 0;
+}
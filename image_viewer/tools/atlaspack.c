@@ -0,0 +1,347 @@
+/*
+ * atlaspack: pack the PNGs of a directory into atlas pages for loadAtlas().
+ *
+ *   atlaspack [-m size] [-p padding] [-f 8888|5650|5551|4444] [-s] directory output.atlas
+ *
+ *   -m  largest page width and height, 512 by default, the most the GE can sample
+ *   -p  transparent pixels between sprites, 1 by default, so scaled or rotated draws
+ *       do not sample their neighbours
+ *   -f  pixel format of the pages, 8888 by default
+ *   -s  swizzle the pages
+ *
+ * The sprites are placed bottom-left on a skyline, tallest first, filling a page before
+ * the next one is started. The pages are written next to the index as cooked textures,
+ * output.0.tex, output.1.tex, ..., named without the directory in the index.
+ *
+ * Built by Makefile.host.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pspgu.h>
+
+#include "../atlas.h"
+#include "../pixelformat.h"
+
+#define MAX_SPRITES 1024
+#define MAX_SKYLINE 1024
+#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
+
+typedef struct
+{
+	char name[ATLAS_NAME_SIZE];
+	Image* image;
+	int page, x, y;
+} Sprite;
+
+/* Segment of the skyline, the top of what is placed below [x, x + width). */
+typedef struct
+{
+	int x, y, width;
+} Segment;
+
+typedef struct
+{
+	Segment segments[MAX_SKYLINE];
+	int count;
+	int usedWidth, usedHeight;
+} Page;
+
+static Sprite sprites[MAX_SPRITES];
+static int spriteCount;
+static Page pages[ATLAS_MAX_PAGES];
+static int pageCount;
+static int pageSize = TILE_SIZE;
+
+static int usage()
+{
+	fprintf(stderr, "usage: atlaspack [-m size] [-p padding] [-f 8888|5650|5551|4444] [-s] directory output.atlas\n");
+	return 2;
+}
+
+static int byName(const void* a, const void* b)
+{
+	return strcmp(((const Sprite*) a)->name, ((const Sprite*) b)->name);
+}
+
+static int bySize(const void* a, const void* b)
+{
+	const Image* p = ((const Sprite*) a)->image;
+	const Image* q = ((const Sprite*) b)->image;
+	if (p->imageHeight != q->imageHeight) return q->imageHeight - p->imageHeight;
+	if (p->imageWidth != q->imageWidth) return q->imageWidth - p->imageWidth;
+	return byName(a, b);
+}
+
+static int loadSprites(const char* directory)
+{
+	DIR* dir = opendir(directory);
+	struct dirent* file;
+	char path[1024];
+	if (!dir) {
+		fprintf(stderr, "atlaspack: cannot open %s\n", directory);
+		return 0;
+	}
+	while ((file = readdir(dir)) != NULL) {
+		int length = strlen(file->d_name);
+		Sprite* sprite;
+		if (length < 5 || strcmp(file->d_name + length - 4, ".png") != 0) continue;
+		if (length - 4 >= ATLAS_NAME_SIZE || spriteCount == MAX_SPRITES) {
+			fprintf(stderr, "atlaspack: skipping %s, name too long or too many sprites\n", file->d_name);
+			continue;
+		}
+		sprite = &sprites[spriteCount];
+		memset(sprite->name, 0, ATLAS_NAME_SIZE);
+		memcpy(sprite->name, file->d_name, length - 4);
+		snprintf(path, sizeof(path), "%s/%s", directory, file->d_name);
+		sprite->image = loadImageEx(path, IMAGE_EXPAND_PALETTE);
+		if (!sprite->image) {
+			fprintf(stderr, "atlaspack: skipping %s, larger than %d pixels or not a PNG\n", file->d_name, TILE_SIZE);
+			continue;
+		}
+		spriteCount++;
+	}
+	closedir(dir);
+	return spriteCount > 0;
+}
+
+/*
+ * Lowest y a sprite can rest at with its left edge on segment i, -1 if it does not fit.
+ * The padding right and below the sprite may reach past the page edges.
+ */
+static int fitAt(const Page* page, int i, int width, int height, int padding)
+{
+	int x = page->segments[i].x;
+	int y = 0;
+	int remaining = MIN(width + padding, pageSize - x);
+	if (x + width > pageSize) return -1;
+	for (; remaining > 0; i++) {
+		if (page->segments[i].y > y) y = page->segments[i].y;
+		if (y + height > pageSize) return -1;
+		remaining -= page->segments[i].width;
+	}
+	return y;
+}
+
+/* Raise the skyline over [x, x + width) to y, segment i starting at x. */
+static int raise(Page* page, int i, int width, int y)
+{
+	Segment* segments = page->segments;
+	int x = segments[i].x;
+	int j;
+	if (page->count == MAX_SKYLINE) return 0;
+	memmove(&segments[i + 1], &segments[i], (page->count - i) * sizeof(Segment));
+	page->count++;
+	segments[i].y = y;
+	segments[i].width = width;
+	// cut the segments now below the new one
+	while (i + 1 < page->count && segments[i + 1].x < x + width) {
+		int cut = x + width - segments[i + 1].x;
+		if (cut >= segments[i + 1].width) {
+			memmove(&segments[i + 1], &segments[i + 2], (page->count - i - 2) * sizeof(Segment));
+			page->count--;
+		} else {
+			segments[i + 1].x += cut;
+			segments[i + 1].width -= cut;
+			break;
+		}
+	}
+	for (j = 0; j + 1 < page->count; j++) {
+		if (segments[j].y == segments[j + 1].y) {
+			segments[j].width += segments[j + 1].width;
+			memmove(&segments[j + 1], &segments[j + 2], (page->count - j - 2) * sizeof(Segment));
+			page->count--;
+			j--;
+		}
+	}
+	return 1;
+}
+
+static int place(Page* page, Sprite* sprite, int padding)
+{
+	int width = sprite->image->imageWidth;
+	int height = sprite->image->imageHeight;
+	int best = -1, bestY = pageSize, i;
+	for (i = 0; i < page->count; i++) {
+		int y = fitAt(page, i, width, height, padding);
+		if (y >= 0 && y < bestY) {
+			best = i;
+			bestY = y;
+		}
+	}
+	if (best < 0) return 0;
+	sprite->x = page->segments[best].x;
+	sprite->y = bestY;
+	if (!raise(page, best, MIN(width + padding, pageSize - sprite->x), bestY + height + padding)) return 0;
+	if (sprite->x + sprite->image->imageWidth > page->usedWidth) page->usedWidth = sprite->x + sprite->image->imageWidth;
+	if (sprite->y + sprite->image->imageHeight > page->usedHeight) page->usedHeight = sprite->y + sprite->image->imageHeight;
+	return 1;
+}
+
+static int pack(int padding)
+{
+	int s, p;
+	qsort(sprites, spriteCount, sizeof(Sprite), bySize);
+	for (s = 0; s < spriteCount; s++) {
+		for (p = 0; p < pageCount; p++) {
+			if (place(&pages[p], &sprites[s], padding)) break;
+		}
+		if (p == pageCount) {
+			if (pageCount == ATLAS_MAX_PAGES) {
+				fprintf(stderr, "atlaspack: more than %d pages needed\n", ATLAS_MAX_PAGES);
+				return 0;
+			}
+			pages[p].segments[0].x = 0;
+			pages[p].segments[0].y = 0;
+			pages[p].segments[0].width = pageSize;
+			pages[p].count = 1;
+			pageCount++;
+			if (!place(&pages[p], &sprites[s], padding)) {
+				fprintf(stderr, "atlaspack: %s is larger than a page\n", sprites[s].name);
+				return 0;
+			}
+		}
+		sprites[s].page = p;
+	}
+	return 1;
+}
+
+static int writeAtlas(const char* output, int flags, AtlasHeader* header)
+{
+	const char* slash = strrchr(output, '/');
+	const char* base = slash ? slash + 1 : output;
+	char path[1024];
+	AtlasEntry entry;
+	FILE* fp;
+	int p, s;
+
+	memset(header, 0, sizeof(AtlasHeader));
+	header->magic = ATLAS_MAGIC;
+	header->version = ATLAS_VERSION;
+	header->pageCount = pageCount;
+	header->entryCount = spriteCount;
+	for (p = 0; p < pageCount; p++) {
+		Image* image;
+		if (snprintf(header->pages[p], ATLAS_NAME_SIZE, "%s.%d.tex", base, p) >= ATLAS_NAME_SIZE) {
+			fprintf(stderr, "atlaspack: page names of %s are longer than %d characters\n", base, ATLAS_NAME_SIZE - 1);
+			return 0;
+		}
+		image = createImageEx(pages[p].usedWidth, pages[p].usedHeight, flags);
+		if (!image) return 0;
+		for (s = 0; s < spriteCount; s++) {
+			Image* sprite = sprites[s].image;
+			if (sprites[s].page != p) continue;
+			blitImageToImage(0, 0, sprite->imageWidth, sprite->imageHeight, sprite, sprites[s].x, sprites[s].y, image);
+		}
+		snprintf(path, sizeof(path), "%.*s%s", (int) (base - output), output, header->pages[p]);
+		if (!saveTextureFile(path, image)) {
+			fprintf(stderr, "atlaspack: cannot write %s\n", path);
+			return 0;
+		}
+		printf("%s: %dx%d, texture %dx%d\n", path, image->imageWidth, image->imageHeight,
+			image->textureWidth, image->textureHeight);
+		freeImage(image);
+	}
+
+	qsort(sprites, spriteCount, sizeof(Sprite), byName);
+	if ((fp = fopen(output, "wb")) == NULL) return 0;
+	fwrite(header, sizeof(AtlasHeader), 1, fp);
+	for (s = 0; s < spriteCount; s++) {
+		memset(&entry, 0, sizeof(entry));
+		memcpy(entry.name, sprites[s].name, ATLAS_NAME_SIZE);
+		entry.page = sprites[s].page;
+		entry.x = sprites[s].x;
+		entry.y = sprites[s].y;
+		entry.width = sprites[s].image->imageWidth;
+		entry.height = sprites[s].image->imageHeight;
+		fwrite(&entry, sizeof(entry), 1, fp);
+	}
+	return fclose(fp) == 0;
+}
+
+static int power2(int n)
+{
+	int p = 1;
+	while (p < n) p <<= 1;
+	return p;
+}
+
+/* Compare the atlas as loaded at runtime with the sprites, before any format conversion. */
+static int verify(const char* output, int format)
+{
+	Atlas* atlas = loadAtlas(output);
+	int s, x, y;
+	if (!atlas) return 0;
+	for (s = 0; s < spriteCount; s++) {
+		const AtlasEntry* entry = findAtlasEntry(atlas, sprites[s].name);
+		Image* sprite = sprites[s].image;
+		if (!entry || entry->page != sprites[s].page || entry->x != sprites[s].x || entry->y != sprites[s].y) return 0;
+		for (y = 0; y < sprite->imageHeight; y++) {
+			for (x = 0; x < sprite->imageWidth; x++) {
+				u32 expected = pixelToColor(colorToPixel(getPixelImage(x, y, sprite), format), format);
+				if (getPixelImage(entry->x + x, entry->y + y, atlas->pages[entry->page]) != expected) return 0;
+			}
+		}
+	}
+	freeAtlas(atlas);
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	static const char* formatNames[] = { "5650", "5551", "4444", "8888" };
+	static const int formatFlags[] = { IMAGE_FORMAT_5650, IMAGE_FORMAT_5551, IMAGE_FORMAT_4444, IMAGE_FORMAT_8888 };
+	int padding = 1;
+	int format = GU_PSM_8888;
+	int swizzle = 0;
+	const char* directory = NULL;
+	const char* output = NULL;
+	AtlasHeader header;
+	long spritePixels = 0, separatePixels = 0, pagePixels = 0, texturePixels = 0;
+	int i, s, p;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			pageSize = atoi(argv[++i]);
+			if (pageSize <= 0 || pageSize > TILE_SIZE) return usage();
+		} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			padding = atoi(argv[++i]);
+			if (padding < 0) return usage();
+		} else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			i++;
+			for (format = 0; format < 4 && strcmp(argv[i], formatNames[format]) != 0; format++);
+			if (format == 4) return usage();
+		} else if (strcmp(argv[i], "-s") == 0) {
+			swizzle = 1;
+		} else if (!directory) {
+			directory = argv[i];
+		} else if (!output) {
+			output = argv[i];
+		} else {
+			return usage();
+		}
+	}
+	if (!directory || !output) return usage();
+
+	if (!loadSprites(directory) || !pack(padding)) return 1;
+	if (!writeAtlas(output, formatFlags[format] | (swizzle ? IMAGE_SWIZZLE : 0), &header) || !verify(output, format)) {
+		fprintf(stderr, "atlaspack: cannot write %s\n", output);
+		return 1;
+	}
+
+	for (s = 0; s < spriteCount; s++) {
+		Image* image = sprites[s].image;
+		spritePixels += image->imageWidth * image->imageHeight;
+		separatePixels += image->textureWidth * image->textureHeight;
+	}
+	for (p = 0; p < pageCount; p++) {
+		pagePixels += pages[p].usedWidth * pages[p].usedHeight;
+		texturePixels += power2(pages[p].usedWidth) * power2(pages[p].usedHeight);
+	}
+	printf("%s: %d sprites on %d page%s\n", output, spriteCount, pageCount, pageCount == 1 ? "" : "s");
+	printf("packing efficiency %.1f%% of the pages, %.1f%% of their 2^n textures, %.1f%% as separate images\n",
+		100.0 * spritePixels / pagePixels, 100.0 * spritePixels / texturePixels, 100.0 * spritePixels / separatePixels);
+	for (s = 0; s < spriteCount; s++) freeImage(sprites[s].image);
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * texcook: convert a PNG into a cooked texture for loadTextureFile().
+ *
+ *   texcook [-f 8888|5650|5551|4444|t4|t8] [-s] [-d] [-e] input.png output.tex
+ *
+ *   -f  pixel format, 8888 by default, t4 and t8 keep the palette of paletted PNGs
+ *   -s  swizzle the texels
+ *   -d  dither to 16-bit formats
+ *   -e  expand paletted PNGs to direct colors
+ *
+ * The PNG is loaded with loadImageEx(), the same code the PSP runs, and the cooked file is
+ * read back and compared with it, so a written file always loads bit-exactly.
+ *
+ * Built by Makefile.host.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../graphics.h"
+#include "../pixelformat.h"
+
+static const struct
+{
+	const char* name;
+	int flags;
+} formats[] = {
+	{ "8888", IMAGE_FORMAT_8888 },
+	{ "5650", IMAGE_FORMAT_5650 },
+	{ "5551", IMAGE_FORMAT_5551 },
+	{ "4444", IMAGE_FORMAT_4444 },
+	{ "t4", IMAGE_FORMAT_T4 },
+	{ "t8", IMAGE_FORMAT_T8 }
+};
+
+static const char* formatName(int format)
+{
+	static const char* names[] = { "5650", "5551", "4444", "8888", "t4", "t8" };
+	return format >= 0 && format < 6 ? names[format] : "?";
+}
+
+static long fileSize(const char* filename)
+{
+	struct stat info;
+	return stat(filename, &info) == 0 ? (long) info.st_size : -1;
+}
+
+static int usage()
+{
+	fprintf(stderr, "usage: texcook [-f 8888|5650|5551|4444|t4|t8] [-s] [-d] [-e] input.png output.tex\n");
+	return 2;
+}
+
+/* The cooked image must be the loaded image, field by field and byte by byte. */
+static int sameImage(Image* a, Image* b)
+{
+	int bytes = a->stride * pixelFormatBits(a->format) / 8 * (a->swizzled ? (a->imageHeight + 7) & ~7 : a->imageHeight);
+	if (a->imageWidth != b->imageWidth || a->imageHeight != b->imageHeight ||
+		a->textureWidth != b->textureWidth || a->textureHeight != b->textureHeight ||
+		a->stride != b->stride || a->format != b->format || a->swizzled != b->swizzled ||
+		a->paletteEntries != b->paletteEntries) {
+		return 0;
+	}
+	if (a->palette && memcmp(a->palette, b->palette, a->paletteEntries * sizeof(Color)) != 0) return 0;
+	return memcmp(a->data, b->data, bytes) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	int flags = 0;
+	int i, f;
+	const char* input = NULL;
+	const char* output = NULL;
+	Image* image;
+	Image* cooked;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			i++;
+			for (f = 0; f < (int) (sizeof(formats) / sizeof(formats[0])); f++) {
+				if (strcmp(argv[i], formats[f].name) == 0) break;
+			}
+			if (f == (int) (sizeof(formats) / sizeof(formats[0]))) return usage();
+			flags = (flags & ~IMAGE_FORMAT_MASK) | formats[f].flags;
+		} else if (strcmp(argv[i], "-s") == 0) {
+			flags |= IMAGE_SWIZZLE;
+		} else if (strcmp(argv[i], "-d") == 0) {
+			flags |= IMAGE_DITHER;
+		} else if (strcmp(argv[i], "-e") == 0) {
+			flags |= IMAGE_EXPAND_PALETTE;
+		} else if (!input) {
+			input = argv[i];
+		} else if (!output) {
+			output = argv[i];
+		} else {
+			return usage();
+		}
+	}
+	if (!input || !output) return usage();
+
+	image = loadImageEx(input, flags);
+	if (!image) {
+		fprintf(stderr, "texcook: cannot load %s (larger than %d pixels or not a PNG)\n", input, TILE_SIZE);
+		return 1;
+	}
+	if (!saveTextureFile(output, image)) {
+		fprintf(stderr, "texcook: cannot write %s\n", output);
+		return 1;
+	}
+	cooked = loadTextureFile(output);
+	if (!cooked || !sameImage(image, cooked)) {
+		fprintf(stderr, "texcook: %s does not load back as %s\n", output, input);
+		remove(output);
+		return 1;
+	}
+	printf("%s: %dx%d %s%s, texture %dx%d, stride %d, %ld bytes PNG, %ld bytes cooked\n",
+		output, image->imageWidth, image->imageHeight, formatName(image->format), image->swizzled ? " swizzled" : "",
+		image->textureWidth, image->textureHeight, image->stride, fileSize(input), fileSize(output));
+	freeImage(cooked);
+	freeImage(image);
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include <string.h>
+
+#include "vram.h"
+
+void vramInit(VramAllocator* allocator, int start, int size)
+{
+	allocator->start = start;
+	allocator->size = size & ~(VRAM_ALIGNMENT - 1);
+	allocator->blockCount = 1;
+	allocator->blocks[0].offset = start;
+	allocator->blocks[0].size = allocator->size;
+	allocator->blocks[0].used = 0;
+}
+
+int vramAlloc(VramAllocator* allocator, int size)
+{
+	int i;
+	size = (size + VRAM_ALIGNMENT - 1) & ~(VRAM_ALIGNMENT - 1);
+	for (i = 0; i < allocator->blockCount; i++) {
+		VramBlock* block = &allocator->blocks[i];
+		if (block->used || block->size < size) continue;
+		if (block->size > size) {
+			// split, the remainder stays free behind the new block
+			if (allocator->blockCount == VRAM_MAX_BLOCKS) continue;
+			memmove(block + 2, block + 1, (allocator->blockCount - i - 1) * sizeof(VramBlock));
+			allocator->blockCount++;
+			block[1].offset = block->offset + size;
+			block[1].size = block->size - size;
+			block[1].used = 0;
+			block->size = size;
+		}
+		block->used = 1;
+		return block->offset;
+	}
+	return -1;
+}
+
+static void removeBlock(VramAllocator* allocator, int i)
+{
+	memmove(&allocator->blocks[i], &allocator->blocks[i + 1], (allocator->blockCount - i - 1) * sizeof(VramBlock));
+	allocator->blockCount--;
+}
+
+void vramFree(VramAllocator* allocator, int offset)
+{
+	int i;
+	for (i = 0; i < allocator->blockCount; i++) {
+		if (allocator->blocks[i].offset == offset) break;
+	}
+	if (i == allocator->blockCount || !allocator->blocks[i].used) return;
+	allocator->blocks[i].used = 0;
+	if (i + 1 < allocator->blockCount && !allocator->blocks[i + 1].used) {
+		allocator->blocks[i].size += allocator->blocks[i + 1].size;
+		removeBlock(allocator, i + 1);
+	}
+	if (i > 0 && !allocator->blocks[i - 1].used) {
+		allocator->blocks[i - 1].size += allocator->blocks[i].size;
+		removeBlock(allocator, i);
+	}
+}
+
+int vramLargestFree(const VramAllocator* allocator)
+{
+	int i;
+	int largest = 0;
+	for (i = 0; i < allocator->blockCount; i++) {
+		if (!allocator->blocks[i].used && allocator->blocks[i].size > largest) largest = allocator->blocks[i].size;
+	}
+	return largest;
+}
+
+int vramFreeBytes(const VramAllocator* allocator)
+{
+	int i;
+	int total = 0;
+	for (i = 0; i < allocator->blockCount; i++) {
+		if (!allocator->blocks[i].used) total += allocator->blocks[i].size;
+	}
+	return total;
+}
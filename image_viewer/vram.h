@@ -0,0 +1,73 @@
+#ifndef VRAM_H
+#define VRAM_H
+
+#define VRAM_MAX_BLOCKS 128
+#define VRAM_ALIGNMENT 16
+
+typedef struct
+{
+	int offset;  // offset from the start of VRAM in bytes
+	int size;  // size in bytes, a multiple of VRAM_ALIGNMENT
+	int used;
+} VramBlock;
+
+/**
+ * First-fit allocator for a range of VRAM. Works on offsets only and never touches
+ * the memory itself, so it runs unchanged on the host.
+ */
+typedef struct
+{
+	VramBlock blocks[VRAM_MAX_BLOCKS];  // sorted by offset, covering the whole range
+	int blockCount;
+	int start;
+	int size;
+} VramAllocator;
+
+/**
+ * Initialize an allocator managing the VRAM bytes [start, start + size).
+ *
+ * @pre allocator != NULL && start >= 0 && size > 0
+ * @param allocator - the allocator to initialize
+ * @param start - first managed VRAM offset
+ * @param size - number of managed bytes
+ */
+extern void vramInit(VramAllocator* allocator, int start, int size);
+
+/**
+ * Allocate a block of VRAM.
+ *
+ * @pre allocator != NULL && size > 0
+ * @param allocator - the allocator
+ * @param size - number of bytes, rounded up to VRAM_ALIGNMENT
+ * @return VRAM offset of the block, or -1 if there is no free range large enough
+ */
+extern int vramAlloc(VramAllocator* allocator, int size);
+
+/**
+ * Free a block returned by vramAlloc, merging it with free neighbours.
+ *
+ * @pre allocator != NULL && offset was returned by vramAlloc and not freed yet
+ * @param allocator - the allocator
+ * @param offset - VRAM offset of the block
+ */
+extern void vramFree(VramAllocator* allocator, int offset);
+
+/**
+ * Get the size of the largest free block.
+ *
+ * @pre allocator != NULL
+ * @param allocator - the allocator
+ * @return size in bytes of the largest block vramAlloc can currently return
+ */
+extern int vramLargestFree(const VramAllocator* allocator);
+
+/**
+ * Get the number of free bytes.
+ *
+ * @pre allocator != NULL
+ * @param allocator - the allocator
+ * @return sum of the sizes of all free blocks
+ */
+extern int vramFreeBytes(const VramAllocator* allocator);
+
+#endif